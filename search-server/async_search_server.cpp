@@ -0,0 +1,121 @@
+#include "async_search_server.h"
+
+#include <memory>
+#include <stdexcept>
+
+#include "request_stats.h"
+
+AsyncSearchServer::AsyncSearchServer(const SearchServer& search_server, const AsyncSearchOptions& options)
+    : server_(search_server)
+    , options_(options)
+    , pool_(options.thread_count)
+{
+    if (options.queue_capacity == 0) {
+        throw std::invalid_argument("Queue capacity must be positive");
+    }
+}
+
+std::future<QueryResponse> AsyncSearchServer::Submit(QueryRequest request) {
+    auto promise = std::make_shared<std::promise<QueryResponse>>();
+    auto result = promise->get_future();
+    Submit(std::move(request), [promise](QueryResponse response) { promise->set_value(std::move(response)); });
+    return result;
+}
+
+void AsyncSearchServer::Submit(QueryRequest request, Callback callback) {
+    submitted_.fetch_add(1, std::memory_order_relaxed);
+    Admit(true);
+    Dispatch(std::move(request), std::move(callback));
+}
+
+std::future<QueryResponse> AsyncSearchServer::TrySubmit(QueryRequest request) {
+    auto promise = std::make_shared<std::promise<QueryResponse>>();
+    auto result = promise->get_future();
+    TrySubmit(std::move(request), [promise](QueryResponse response) { promise->set_value(std::move(response)); });
+    return result;
+}
+
+bool AsyncSearchServer::TrySubmit(QueryRequest request, Callback callback) {
+    using namespace std::string_literals;
+    submitted_.fetch_add(1, std::memory_order_relaxed);
+    if (!Admit(false)) {
+        rejected_.fetch_add(1, std::memory_order_relaxed);
+        if (options_.request_stats != nullptr) {
+            options_.request_stats->Record(0, QueryStatus::REJECTED);
+        }
+        callback({ QueryStatus::REJECTED, {}, "Request queue is full"s });
+        return false;
+    }
+    Dispatch(std::move(request), std::move(callback));
+    return true;
+}
+
+AsyncSearchStats AsyncSearchServer::GetStats() const {
+    AsyncSearchStats stats;
+    stats.submitted = submitted_.load(std::memory_order_relaxed);
+    stats.completed = completed_.load(std::memory_order_relaxed);
+    stats.timed_out = timed_out_.load(std::memory_order_relaxed);
+    stats.rejected = rejected_.load(std::memory_order_relaxed);
+    stats.failed = failed_.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> guard(admission_mutex_);
+    stats.in_flight = in_flight_;
+    return stats;
+}
+
+bool AsyncSearchServer::Admit(bool wait) {
+    std::unique_lock<std::mutex> lock(admission_mutex_);
+    if (wait) {
+        slot_released_.wait(lock, [this]() { return in_flight_ < options_.queue_capacity; });
+    }
+    else if (in_flight_ >= options_.queue_capacity) {
+        return false;
+    }
+    ++in_flight_;
+    return true;
+}
+
+void AsyncSearchServer::Release() {
+    {
+        std::lock_guard<std::mutex> guard(admission_mutex_);
+        --in_flight_;
+    }
+    slot_released_.notify_one();
+}
+
+void AsyncSearchServer::Dispatch(QueryRequest request, Callback callback) {
+    const auto deadline = Clock::now() + request.time_budget;
+    pool_.Submit([this, request = std::move(request), callback = std::move(callback), deadline]() {
+        QueryResponse response = Execute(request, deadline);
+        Release();
+        if (options_.request_stats != nullptr) {
+            options_.request_stats->Record(response.documents.size(), response.status);
+        }
+        // An exception leaving the task would terminate the worker thread.
+        try {
+            callback(std::move(response));
+        }
+        catch (...) {
+        }
+    });
+}
+
+QueryResponse AsyncSearchServer::Execute(const QueryRequest& request, Clock::time_point deadline) {
+    using namespace std::string_literals;
+    if (Clock::now() >= deadline) {
+        timed_out_.fetch_add(1, std::memory_order_relaxed);
+        return { QueryStatus::TIMEOUT, {}, "Time budget expired in queue"s };
+    }
+    try {
+        auto documents = server_.FindTopDocuments(request.raw_query, request.status);
+        if (Clock::now() >= deadline) {
+            timed_out_.fetch_add(1, std::memory_order_relaxed);
+            return { QueryStatus::TIMEOUT, std::move(documents), "Time budget expired during search"s };
+        }
+        completed_.fetch_add(1, std::memory_order_relaxed);
+        return { QueryStatus::OK, std::move(documents), {} };
+    }
+    catch (const std::exception& e) {
+        failed_.fetch_add(1, std::memory_order_relaxed);
+        return { QueryStatus::FAILED, {}, e.what() };
+    }
+}
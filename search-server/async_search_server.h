@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+#include "thread_pool.h"
+
+enum class QueryStatus {
+    OK,
+    TIMEOUT,
+    REJECTED,
+    FAILED,
+};
+
+struct QueryRequest {
+    std::string raw_query;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::chrono::steady_clock::duration time_budget = std::chrono::milliseconds(100);
+};
+
+struct QueryResponse {
+    QueryStatus status = QueryStatus::OK;
+    std::vector<Document> documents;
+    std::string error;
+};
+
+class RequestStats;
+
+struct AsyncSearchOptions {
+    size_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+    size_t queue_capacity = 1024;
+    RequestStats* request_stats = nullptr;
+};
+
+struct AsyncSearchStats {
+    uint64_t submitted = 0;
+    uint64_t completed = 0;
+    uint64_t timed_out = 0;
+    uint64_t rejected = 0;
+    uint64_t failed = 0;
+    size_t in_flight = 0;
+};
+
+// Serves queries of a SearchServer on its own work-stealing pool. At most
+// queue_capacity requests are admitted at once: Submit waits for a free slot
+// (backpressure), TrySubmit answers REJECTED at once (load shedding). A request
+// that is still queued when its time budget runs out is answered with TIMEOUT.
+// A search that has started is not interrupted: if it overruns the budget its
+// complete result is returned with TIMEOUT, which only marks it as late.
+// Callbacks run on the pool; an exception thrown by a callback is discarded.
+// queue_capacity must be positive.
+class AsyncSearchServer {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Callback = std::function<void(QueryResponse)>;
+
+    explicit AsyncSearchServer(const SearchServer&, const AsyncSearchOptions& = {});
+
+    std::future<QueryResponse> Submit(QueryRequest);
+    void Submit(QueryRequest, Callback);
+    std::future<QueryResponse> TrySubmit(QueryRequest);
+    bool TrySubmit(QueryRequest, Callback);
+    AsyncSearchStats GetStats() const;
+
+private:
+    const SearchServer& server_;
+    const AsyncSearchOptions options_;
+    mutable std::mutex admission_mutex_;
+    std::condition_variable slot_released_;
+    size_t in_flight_ = 0;
+    std::atomic<uint64_t> submitted_{0};
+    std::atomic<uint64_t> completed_{0};
+    std::atomic<uint64_t> timed_out_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> failed_{0};
+    ThreadPool pool_;
+
+    bool Admit(bool);
+    void Release();
+    void Dispatch(QueryRequest, Callback);
+    QueryResponse Execute(const QueryRequest&, Clock::time_point);
+};
@@ -0,0 +1,714 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <execution>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <map>
+#include <memory_resource>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#include "async_search_server.h"
+#include "corpus_generator.h"
+#include "corpus_ingestion.h"
+#include "load_generator.h"
+#include "mutation_log.h"
+#include "process_queries.h"
+#include "remove_duplicates.h"
+#include "scoring_kernel.h"
+#include "search_server.h"
+#include "shard_aggregator.h"
+#include "shard_server.h"
+#include "sharded_search_server.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+struct BenchmarkOptions {
+    std::vector<size_t> sizes = { 1000, 10000, 50000 };
+    std::vector<size_t> threads = { 1, 2, 4 };
+    std::vector<std::string> suites = { "core"s };
+    CorpusOptions corpus;
+    QueryOptions queries;
+    std::string output;
+};
+
+struct BenchmarkResult {
+    std::string name;
+    size_t documents;
+    size_t threads;
+    size_t operations;
+    int64_t total_ns;
+    std::map<std::string, double> extra;
+};
+
+class BenchmarkReport {
+public:
+    explicit BenchmarkReport(const BenchmarkOptions& options)
+        : options_(options) {
+    }
+
+    void Add(const std::string& name, size_t documents, size_t threads, size_t operations, int64_t total_ns,
+             std::map<std::string, double> extra = {}) {
+        results_.push_back({ name, documents, threads, operations, total_ns, std::move(extra) });
+        std::cerr << name << " documents="s << documents << " threads="s << threads
+                  << " ns/op="s << (operations == 0 ? 0 : total_ns / static_cast<int64_t>(operations)) << std::endl;
+    }
+
+    void Print(std::ostream& os) const {
+        const auto& corpus = options_.corpus;
+        const auto& queries = options_.queries;
+        os << "{\n  \"config\": {\"seed\": "s << corpus.seed
+           << ", \"vocabulary_size\": "s << corpus.vocabulary_size
+           << ", \"min_document_length\": "s << corpus.min_document_length
+           << ", \"max_document_length\": "s << corpus.max_document_length
+           << ", \"zipf_exponent\": "s << corpus.zipf_exponent
+           << ", \"stop_word_ratio\": "s << corpus.stop_word_ratio
+           << ", \"query_count\": "s << queries.query_count
+           << ", \"minus_word_rate\": "s << queries.minus_word_rate
+           << ", \"hardware_threads\": "s << std::thread::hardware_concurrency() << "},\n  \"results\": [\n"s;
+        for (size_t i = 0; i < results_.size(); ++i) {
+            const auto& result = results_[i];
+            const double ns_per_op = result.operations == 0 ? 0.0 : static_cast<double>(result.total_ns) / result.operations;
+            os << "    {\"name\": \""s << result.name
+               << "\", \"documents\": "s << result.documents
+               << ", \"threads\": "s << result.threads
+               << ", \"operations\": "s << result.operations
+               << ", \"total_ns\": "s << result.total_ns
+               << ", \"ns_per_op\": "s << ns_per_op
+               << ", \"ops_per_sec\": "s << (ns_per_op == 0.0 ? 0.0 : 1e9 / ns_per_op);
+            for (const auto& [key, value] : result.extra) {
+                os << ", \""s << key << "\": "s << value;
+            }
+            os << "}"s
+               << (i + 1 == results_.size() ? "\n"s : ",\n"s);
+        }
+        os << "  ]\n}\n"s;
+    }
+
+    double GetLastNanosecondsPerOperation() const {
+        const auto& result = results_.back();
+        return result.operations == 0 ? 0.0 : static_cast<double>(result.total_ns) / result.operations;
+    }
+
+private:
+    const BenchmarkOptions& options_;
+    std::vector<BenchmarkResult> results_;
+};
+
+size_t benchmark_checksum = 0;
+
+template <typename Func>
+int64_t MeasureNanoseconds(Func func) {
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename Func>
+int64_t MeasureConcurrently(size_t thread_count, size_t operation_count, Func func) {
+    return MeasureNanoseconds([&]() {
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < thread_count; ++t) {
+            workers.emplace_back([&, t]() {
+                for (size_t i = t; i < operation_count; i += thread_count) {
+                    func(i);
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    });
+}
+
+std::unique_ptr<SearchServer> BuildServer(const CorpusGenerator& generator, const std::vector<GeneratedDocument>& documents) {
+    auto server = std::make_unique<SearchServer>(generator.GetStopWordsText());
+    for (const auto& document : documents) {
+        server->AddDocument(document.id, document.text, document.status, document.ratings);
+    }
+    return server;
+}
+
+// Sums the relevances of one term over postings of several lengths into an
+// accumulator of size documents: with the map the term-at-a-time loop used
+// before, and with each scoring kernel. A random eighth of the postings fail the
+// predicate.
+void RunScoringKernelBenchmarks(size_t size, BenchmarkReport& report) {
+    const size_t MIN_POSTING_VISITS = 1 << 22;
+    std::mt19937 random_engine(size);
+    std::vector<ScoringKernel> kernels = { ScoringKernel::SCALAR };
+    if (GetScoringKernel() != ScoringKernel::SCALAR) {
+        kernels.push_back(GetScoringKernel());
+    }
+    for (const size_t divisor : { 64, 8, 1 }) {
+        const uint32_t count = static_cast<uint32_t>(std::max<size_t>(size / divisor, 1));
+        std::vector<uint32_t> documents(size);
+        std::iota(documents.begin(), documents.end(), 0u);
+        std::shuffle(documents.begin(), documents.end(), random_engine);
+        documents.resize(count);
+        std::sort(documents.begin(), documents.end());
+        std::vector<double> term_freqs(count);
+        std::vector<uint8_t> mask(count);
+        std::uniform_real_distribution<double> term_freq_distribution(0.01, 0.5);
+        for (uint32_t i = 0; i < count; ++i) {
+            term_freqs[i] = term_freq_distribution(random_engine);
+            mask[i] = random_engine() % 8 != 0;
+        }
+        const size_t repeat_count = std::max<size_t>(MIN_POSTING_VISITS / count, 1);
+        const std::string suffix = "/"s + std::to_string(count);
+        report.Add("ScoringKernel/map"s + suffix, size, 1, repeat_count * count, MeasureNanoseconds([&]() {
+            for (size_t repeat = 0; repeat < repeat_count; ++repeat) {
+                std::map<int, double> key_to_relevance;
+                for (uint32_t i = 0; i < count; ++i) {
+                    if (mask[i]) {
+                        key_to_relevance[static_cast<int>(documents[i])] += term_freqs[i] * 1.5;
+                    }
+                }
+                benchmark_checksum += key_to_relevance.size();
+            }
+        }));
+        std::vector<double> relevances(size);
+        std::vector<uint8_t> matched(size);
+        for (const ScoringKernel kernel : kernels) {
+            const std::string name = kernel == ScoringKernel::SCALAR ? "scalar"s : "avx2"s;
+            report.Add("ScoringKernel/"s + name + suffix, size, 1, repeat_count * count, MeasureNanoseconds([&]() {
+                for (size_t repeat = 0; repeat < repeat_count; ++repeat) {
+                    std::fill(relevances.begin(), relevances.end(), 0.0);
+                    std::fill(matched.begin(), matched.end(), 0);
+                    AccumulateRelevance(kernel, documents.data(), term_freqs.data(), mask.data(), count, 1.5,
+                                        relevances.data(), matched.data());
+                    benchmark_checksum += matched.front();
+                }
+            }));
+        }
+    }
+}
+
+void RunCoreBenchmarks(const BenchmarkOptions& options, BenchmarkReport& report) {
+    for (const size_t size : options.sizes) {
+        CorpusOptions corpus_options = options.corpus;
+        corpus_options.document_count = size;
+        const CorpusGenerator generator(corpus_options);
+        const auto documents = generator.GenerateDocuments();
+        const auto queries = generator.GenerateQueries(options.queries);
+
+        std::unique_ptr<SearchServer> server;
+        report.Add("AddDocument"s, size, 1, size, MeasureNanoseconds([&]() {
+            server = BuildServer(generator, documents);
+        }));
+        {
+            std::ostringstream corpus;
+            WriteCorpus(corpus, documents);
+            const std::string corpus_text = corpus.str();
+            report.Add("IngestCorpus"s, size, 0, size, MeasureNanoseconds([&]() {
+                SearchServer ingested_server(generator.GetStopWordsText());
+                std::istringstream input(corpus_text);
+                benchmark_checksum += IngestCorpus(ingested_server, input).document_count;
+            }));
+        }
+        {
+            std::pmr::monotonic_buffer_resource index_arena;
+            report.Add("AddDocument/monotonic_arena"s, size, 1, size, MeasureNanoseconds([&]() {
+                SearchServer arena_server(generator.GetStopWordsText(), &index_arena);
+                for (const auto& document : documents) {
+                    arena_server.AddDocument(document.id, document.text, document.status, document.ratings);
+                }
+                benchmark_checksum += arena_server.GetDocumentCount();
+            }));
+        }
+
+        report.Add("FindTopDocuments/seq"s, size, 1, queries.size(), MeasureNanoseconds([&]() {
+            for (const auto& query : queries) {
+                benchmark_checksum += server->FindTopDocuments(query).size();
+            }
+        }));
+        std::vector<CompiledQuery> compiled_queries;
+        compiled_queries.reserve(queries.size());
+        report.Add("CompileQuery"s, size, 1, queries.size(), MeasureNanoseconds([&]() {
+            for (const auto& query : queries) {
+                compiled_queries.push_back(server->CompileQuery(query));
+            }
+        }));
+        report.Add("FindTopDocuments/compiled"s, size, 1, queries.size(), MeasureNanoseconds([&]() {
+            for (const auto& query : compiled_queries) {
+                benchmark_checksum += server->FindTopDocuments(query).size();
+            }
+        }));
+        const auto frozen_server = BuildServer(generator, documents);
+        report.Add("Freeze"s, size, 1, 1, MeasureNanoseconds([&]() { frozen_server->Freeze(); }));
+        report.Add("FindTopDocuments/frozen"s, size, 1, queries.size(), MeasureNanoseconds([&]() {
+            for (const auto& query : queries) {
+                benchmark_checksum += frozen_server->FindTopDocuments(query).size();
+            }
+        }));
+        report.Add("FindTopDocuments/all"s, size, 1, queries.size(), MeasureNanoseconds([&]() {
+            for (const auto& query : queries) {
+                benchmark_checksum += server->FindTopDocuments(server->CompileQuery(query, QueryMode::ALL)).size();
+            }
+        }));
+        report.Add("FindTopDocuments/all_post_filter"s, size, 1, queries.size(), MeasureNanoseconds([&]() {
+            for (const auto& query : queries) {
+                const auto any_query = server->CompileQuery(query);
+                benchmark_checksum += server->FindTopDocuments(any_query, [&](int document_id, DocumentStatus status, int) {
+                    return status == DocumentStatus::ACTUAL
+                        && std::get<0>(server->MatchDocument(any_query, document_id)).size() == any_query.GetPlusTermCount();
+                }).size();
+            }
+        }));
+        report.Add("FindTopDocuments/all_frozen"s, size, 1, queries.size(), MeasureNanoseconds([&]() {
+            for (const auto& query : queries) {
+                benchmark_checksum += frozen_server->FindTopDocuments(frozen_server->CompileQuery(query, QueryMode::ALL)).size();
+            }
+        }));
+        for (const auto& [name, order] : { std::pair{ "rating"s, DocumentOrder::RATING },
+                                            std::pair{ "similarity"s, DocumentOrder::SIMILARITY } }) {
+            const auto reordered_server = BuildServer(generator, documents);
+            reordered_server->Freeze(TermFreqPrecision::DOUBLE, order);
+            report.Add("FindTopDocuments/frozen_order/"s + name, size, 1, queries.size(), MeasureNanoseconds([&]() {
+                for (const auto& query : queries) {
+                    benchmark_checksum += reordered_server->FindTopDocuments(query).size();
+                }
+            }));
+        }
+        report.Add("CountMatches/exact"s, size, 1, queries.size(), MeasureNanoseconds([&]() {
+            for (const auto& query : queries) {
+                benchmark_checksum += server->CountMatches(query);
+            }
+        }));
+        report.Add("CountMatches/exact_frozen"s, size, 1, queries.size(), MeasureNanoseconds([&]() {
+            for (const auto& query : queries) {
+                benchmark_checksum += frozen_server->CountMatches(query);
+            }
+        }));
+        report.Add("CountMatches/approximate"s, size, 1, queries.size(), MeasureNanoseconds([&]() {
+            for (const auto& query : queries) {
+                benchmark_checksum += server->CountMatches(query, DocumentStatus::ACTUAL, CountMode::APPROXIMATE);
+            }
+        }));
+        server->SetCommonWordRatio(0.1);
+        report.Add("FindTopDocuments/common_words"s, size, 1, queries.size(), MeasureNanoseconds([&]() {
+            for (const auto& query : queries) {
+                benchmark_checksum += server->FindTopDocuments(query).size();
+            }
+        }));
+        server->SetCommonWordRatio(1.0);
+        for (const auto& [name, precision] : { std::pair{ "float"s, TermFreqPrecision::FLOAT },
+                                                std::pair{ "uint16"s, TermFreqPrecision::UINT16 },
+                                                std::pair{ "uint8"s, TermFreqPrecision::UINT8 } }) {
+            const auto quantized_server = BuildServer(generator, documents);
+            quantized_server->Freeze(precision);
+            report.Add("FindTopDocuments/frozen/"s + name, size, 1, queries.size(), MeasureNanoseconds([&]() {
+                for (const auto& query : queries) {
+                    benchmark_checksum += quantized_server->FindTopDocuments(query).size();
+                }
+            }));
+        }
+        RunScoringKernelBenchmarks(size, report);
+        report.Add("FindTopDocuments/par"s, size, 0, queries.size(), MeasureNanoseconds([&]() {
+            for (const auto& query : queries) {
+                benchmark_checksum += server->FindTopDocuments(std::execution::par, query).size();
+            }
+        }));
+        for (const size_t thread_count : options.threads) {
+            report.Add("FindTopDocuments/concurrent"s, size, thread_count, queries.size(),
+                MeasureConcurrently(thread_count, queries.size(), [&](size_t i) {
+                    benchmark_checksum += server->FindTopDocuments(queries[i]).size();
+                }));
+        }
+
+        // Short prefixes of frequent words fan out to the expansion limit.
+        for (const size_t prefix_size : { 1, 2, 3 }) {
+            std::vector<std::string> prefix_queries;
+            for (const auto& query : queries) {
+                const auto word = query.substr(0, query.find(' '));
+                if (!word.empty() && word[0] != '-') {
+                    prefix_queries.push_back(word.substr(0, prefix_size) + "*"s);
+                }
+            }
+            report.Add("FindTopDocuments/prefix"s + std::to_string(prefix_size), size, 1, prefix_queries.size(), MeasureNanoseconds([&]() {
+                for (const auto& query : prefix_queries) {
+                    benchmark_checksum += server->FindTopDocuments(query).size();
+                }
+            }));
+        }
+
+        for (const size_t page : { 0, 50 }) {
+            report.Add("FindTopDocuments/page"s + std::to_string(page), size, 1, queries.size(), MeasureNanoseconds([&]() {
+                for (const auto& query : queries) {
+                    benchmark_checksum += server->FindTopDocuments(query, page, 10).size();
+                }
+            }));
+        }
+
+        report.Add("MatchDocument/seq"s, size, 1, queries.size(), MeasureNanoseconds([&]() {
+            for (size_t i = 0; i < queries.size(); ++i) {
+                const auto [words, status] = server->MatchDocument(queries[i], static_cast<int>(i * 7919 % size));
+                benchmark_checksum += words.size();
+            }
+        }));
+        report.Add("MatchDocument/compiled"s, size, 1, queries.size(), MeasureNanoseconds([&]() {
+            for (size_t i = 0; i < compiled_queries.size(); ++i) {
+                const auto [words, status] = server->MatchDocument(compiled_queries[i], static_cast<int>(i * 7919 % size));
+                benchmark_checksum += words.size();
+            }
+        }));
+        report.Add("MatchDocument/frozen"s, size, 1, queries.size(), MeasureNanoseconds([&]() {
+            for (size_t i = 0; i < queries.size(); ++i) {
+                const auto [words, status] = frozen_server->MatchDocument(queries[i], static_cast<int>(i * 7919 % size));
+                benchmark_checksum += words.size();
+            }
+        }));
+        report.Add("MatchDocument/par"s, size, 0, queries.size(), MeasureNanoseconds([&]() {
+            for (size_t i = 0; i < queries.size(); ++i) {
+                const auto [words, status] = server->MatchDocument(std::execution::par, queries[i], static_cast<int>(i * 7919 % size));
+                benchmark_checksum += words.size();
+            }
+        }));
+
+        const size_t batch_size = std::min<size_t>(20, size);
+        std::vector<int> batch_ids(batch_size);
+        for (size_t i = 0; i < batch_size; ++i) {
+            batch_ids[i] = static_cast<int>(i * 7919 % size);
+        }
+        report.Add("MatchDocuments/seq"s, size, 1, queries.size() * batch_size, MeasureNanoseconds([&]() {
+            for (const auto& query : queries) {
+                benchmark_checksum += server->MatchDocuments(query, batch_ids).size();
+            }
+        }));
+        report.Add("MatchDocuments/par"s, size, 0, queries.size() * batch_size, MeasureNanoseconds([&]() {
+            for (const auto& query : queries) {
+                benchmark_checksum += server->MatchDocuments(std::execution::par, query, batch_ids).size();
+            }
+        }));
+
+        report.Add("ProcessQueries"s, size, 0, queries.size(), MeasureNanoseconds([&]() {
+            benchmark_checksum += ProcessQueries(*server, queries).size();
+        }));
+        report.Add("ProcessQueriesJoined"s, size, 0, queries.size(), MeasureNanoseconds([&]() {
+            benchmark_checksum += ProcessQueriesJoined(*server, queries).size();
+        }));
+
+        const size_t removal_count = std::max<size_t>(1, size / 10);
+        report.Add("RemoveDocument/seq"s, size, 1, removal_count, MeasureNanoseconds([&]() {
+            for (size_t i = 0; i < removal_count; ++i) {
+                server->RemoveDocument(std::execution::seq, static_cast<int>(i));
+            }
+        }));
+        server = BuildServer(generator, documents);
+        report.Add("RemoveDocument/par"s, size, 0, removal_count, MeasureNanoseconds([&]() {
+            for (size_t i = 0; i < removal_count; ++i) {
+                server->RemoveDocument(std::execution::par, static_cast<int>(i));
+            }
+        }));
+
+        server = BuildServer(generator, documents);
+        for (size_t i = 0; i < removal_count; ++i) {
+            const auto& original = documents[i * 7919 % size];
+            server->AddDocument(static_cast<int>(size + i), original.text, original.status, original.ratings);
+        }
+        std::ostringstream discarded;
+        auto* const cout_buffer = std::cout.rdbuf(discarded.rdbuf());
+        report.Add("RemoveDuplicates"s, size, 1, size + removal_count, MeasureNanoseconds([&]() {
+            RemoveDuplicates(*server);
+        }));
+        std::cout.rdbuf(cout_buffer);
+    }
+}
+
+void RunAsyncBenchmarks(const BenchmarkOptions& options, BenchmarkReport& report) {
+    for (const size_t size : options.sizes) {
+        CorpusOptions corpus_options = options.corpus;
+        corpus_options.document_count = size;
+        const CorpusGenerator generator(corpus_options);
+        const auto queries = generator.GenerateQueries(options.queries);
+        const auto server = BuildServer(generator, generator.GenerateDocuments());
+        for (const size_t thread_count : options.threads) {
+            AsyncSearchServer async_server(*server, { thread_count, 256 });
+            report.Add("AsyncSearchServer/closed_loop"s, size, thread_count, queries.size(), MeasureNanoseconds([&]() {
+                std::vector<std::future<QueryResponse>> responses;
+                responses.reserve(queries.size());
+                for (const auto& query : queries) {
+                    responses.push_back(async_server.Submit({ query, DocumentStatus::ACTUAL, std::chrono::seconds(10) }));
+                }
+                for (auto& response : responses) {
+                    benchmark_checksum += response.get().documents.size();
+                }
+            }));
+            const double capacity_qps = 1e9 / std::max<double>(1.0, report.GetLastNanosecondsPerOperation());
+            for (const auto& [load_name, load_factor] : { std::pair{ "half"s, 0.5 }, std::pair{ "overload"s, 2.0 } }) {
+                LoadOptions load_options;
+                load_options.target_qps = capacity_qps * load_factor;
+                load_options.duration = std::chrono::milliseconds(500);
+                const auto load = GenerateLoad(async_server, queries, load_options);
+                report.Add("AsyncSearchServer/open_loop_"s + load_name, size, thread_count, load.sent,
+                           static_cast<int64_t>(load.elapsed_seconds * 1e9),
+                           { { "target_qps"s, load_options.target_qps }, { "achieved_qps"s, load.GetAchievedQps() },
+                             { "ok"s, static_cast<double>(load.ok) }, { "timed_out"s, static_cast<double>(load.timed_out) },
+                             { "rejected"s, static_cast<double>(load.rejected) },
+                             { "p50_latency_ns"s, static_cast<double>(load.p50_latency_ns) },
+                             { "p99_latency_ns"s, static_cast<double>(load.p99_latency_ns) } });
+            }
+        }
+    }
+}
+
+void RunShardedBenchmarks(const BenchmarkOptions& options, BenchmarkReport& report) {
+    for (const size_t size : options.sizes) {
+        CorpusOptions corpus_options = options.corpus;
+        corpus_options.document_count = size;
+        const CorpusGenerator generator(corpus_options);
+        const auto documents = generator.GenerateDocuments();
+        const auto queries = generator.GenerateQueries(options.queries);
+        for (const size_t thread_count : options.threads) {
+            ShardedSearchServer server(thread_count, generator.GetStopWordsText());
+            report.Add("ShardedSearchServer/AddDocument"s, size, thread_count, documents.size(),
+                       MeasureConcurrently(thread_count, documents.size(), [&](size_t i) {
+                           const auto& document = documents[i];
+                           server.AddDocument(document.id, document.text, document.status, document.ratings);
+                       }));
+            report.Add("ShardedSearchServer/FindTopDocuments"s, size, thread_count, queries.size(), MeasureNanoseconds([&]() {
+                for (const auto& query : queries) {
+                    benchmark_checksum += server.FindTopDocuments(query).size();
+                }
+            }));
+            report.Add("ShardedSearchServer/FindTopDocuments_concurrent"s, size, thread_count, queries.size(),
+                       MeasureConcurrently(thread_count, queries.size(), [&](size_t i) {
+                           benchmark_checksum += server.FindTopDocuments(queries[i]).size();
+                       }));
+        }
+    }
+}
+
+// Shard servers run on threads of this process, but talk to the aggregator over
+// real Unix sockets, so the numbers include the whole IPC path.
+void RunIpcBenchmarks(const BenchmarkOptions& options, BenchmarkReport& report) {
+    for (const size_t size : options.sizes) {
+        CorpusOptions corpus_options = options.corpus;
+        corpus_options.document_count = size;
+        const CorpusGenerator generator(corpus_options);
+        const auto documents = generator.GenerateDocuments();
+        const auto queries = generator.GenerateQueries(options.queries);
+        for (const size_t shard_count : options.threads) {
+            std::vector<std::unique_ptr<SearchServer>> shards;
+            std::vector<std::unique_ptr<ShardServer>> shard_servers;
+            std::vector<std::thread> serving;
+            std::vector<std::string> socket_paths;
+            for (size_t i = 0; i < shard_count; ++i) {
+                socket_paths.push_back("/tmp/search_server_benchmark_"s + std::to_string(::getpid()) + "_"s
+                                       + std::to_string(i) + ".sock"s);
+                shards.push_back(std::make_unique<SearchServer>(generator.GetStopWordsText()));
+                shard_servers.push_back(std::make_unique<ShardServer>(*shards.back(), socket_paths.back()));
+                serving.emplace_back([&shard_server = *shard_servers.back()]() { shard_server.Serve(); });
+            }
+            {
+                ShardAggregator aggregator(socket_paths);
+                report.Add("ShardAggregator/AddDocument"s, size, shard_count, documents.size(), MeasureNanoseconds([&]() {
+                    for (const auto& document : documents) {
+                        aggregator.AddDocument(document.id, document.text, document.status, document.ratings);
+                    }
+                }));
+                report.Add("ShardAggregator/FindTopDocuments"s, size, shard_count, queries.size(), MeasureNanoseconds([&]() {
+                    for (const auto& query : queries) {
+                        benchmark_checksum += aggregator.FindTopDocuments(query).size();
+                    }
+                }));
+                report.Add("ShardAggregator/FindTopDocuments_pipelined"s, size, shard_count, queries.size(), MeasureNanoseconds([&]() {
+                    for (const auto& result : aggregator.FindTopDocuments(queries)) {
+                        benchmark_checksum += result.size();
+                    }
+                }));
+            }
+            for (size_t i = 0; i < shard_count; ++i) {
+                shard_servers[i]->Stop();
+                serving[i].join();
+            }
+            ShardedSearchServer in_process(shard_count, generator.GetStopWordsText());
+            for (const auto& document : documents) {
+                in_process.AddDocument(document.id, document.text, document.status, document.ratings);
+            }
+            report.Add("ShardAggregator/FindTopDocuments_in_process"s, size, shard_count, queries.size(), MeasureNanoseconds([&]() {
+                for (const auto& query : queries) {
+                    benchmark_checksum += in_process.FindTopDocuments(query).size();
+                }
+            }));
+        }
+    }
+}
+
+// Compares rebuilding a server from its mutation log with re-ingesting the corpus.
+void RunDurabilityBenchmarks(const BenchmarkOptions& options, BenchmarkReport& report) {
+    for (const size_t size : options.sizes) {
+        CorpusOptions corpus_options = options.corpus;
+        corpus_options.document_count = size;
+        const CorpusGenerator generator(corpus_options);
+        const auto documents = generator.GenerateDocuments();
+        std::ostringstream corpus;
+        WriteCorpus(corpus, documents);
+        const std::string corpus_text = corpus.str();
+        const std::string log_path = "/tmp/search_server_benchmark_"s + std::to_string(::getpid()) + ".log"s;
+        for (const size_t thread_count : options.threads) {
+            ::unlink(log_path.c_str());
+            MutationLog log(log_path);
+            report.Add("MutationLog/LogAddDocument"s, size, thread_count, documents.size(),
+                       MeasureConcurrently(thread_count, documents.size(), [&](size_t i) {
+                           const auto& document = documents[i];
+                           log.LogAddDocument(document.id, document.text, document.status, document.ratings);
+                       }));
+            benchmark_checksum += log.GetStats().sync_count;
+        }
+        report.Add("MutationLog/Recover"s, size, 0, documents.size(), MeasureNanoseconds([&]() {
+            SearchServer server(generator.GetStopWordsText());
+            benchmark_checksum += MutationLog::Recover(server, log_path).record_count;
+        }));
+        report.Add("MutationLog/reingest_AddDocument"s, size, 1, documents.size(), MeasureNanoseconds([&]() {
+            benchmark_checksum += BuildServer(generator, documents)->GetDocumentCount();
+        }));
+        report.Add("MutationLog/reingest_IngestCorpus"s, size, 0, documents.size(), MeasureNanoseconds([&]() {
+            SearchServer server(generator.GetStopWordsText());
+            std::istringstream input(corpus_text);
+            benchmark_checksum += IngestCorpus(server, input).document_count;
+        }));
+        ::unlink(log_path.c_str());
+
+        // About a tenth of the postings stay in memory.
+        const auto queries = generator.GenerateQueries(options.queries);
+        const std::string postings_path = "/tmp/search_server_benchmark_"s + std::to_string(::getpid()) + ".postings"s;
+        TieringOptions tiering_options;
+        tiering_options.resident_posting_count = 3 * size;
+        tiering_options.cache_byte_count = 1 << 20;
+        for (const bool is_warm : { false, true }) {
+            const auto tiered_server = BuildServer(generator, documents);
+            tiered_server->Freeze();
+            tiered_server->MovePostingsToDisk(postings_path, tiering_options);
+            if (is_warm) {
+                tiered_server->WarmUp(queries);
+            }
+            report.Add(is_warm ? "FindTopDocuments/tiered_warm"s : "FindTopDocuments/tiered_cold"s, size, 1, queries.size(),
+                       MeasureNanoseconds([&]() {
+                           for (const auto& query : queries) {
+                               benchmark_checksum += tiered_server->FindTopDocuments(query).size();
+                           }
+                       }));
+            benchmark_checksum += tiered_server->GetPostingCacheStats().miss_count;
+        }
+        ::unlink(postings_path.c_str());
+    }
+}
+
+const std::map<std::string, std::function<void(const BenchmarkOptions&, BenchmarkReport&)>> SUITES = {
+    { "core"s, RunCoreBenchmarks },
+    { "async"s, RunAsyncBenchmarks },
+    { "sharded"s, RunShardedBenchmarks },
+    { "ipc"s, RunIpcBenchmarks },
+    { "durability"s, RunDurabilityBenchmarks },
+};
+
+template <typename Number>
+std::vector<Number> ParseList(const std::string& text) {
+    std::vector<Number> result;
+    std::istringstream input(text);
+    std::string item;
+    while (std::getline(input, item, ',')) {
+        std::istringstream item_input(item);
+        Number value;
+        if (!(item_input >> value)) {
+            throw std::invalid_argument("Invalid list value: "s + item);
+        }
+        result.push_back(value);
+    }
+    return result;
+}
+
+BenchmarkOptions ParseOptions(int argc, char* argv[]) {
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string flag = argv[i];
+        if (i + 1 >= argc) {
+            throw std::invalid_argument("Missing value for "s + flag);
+        }
+        const std::string value = argv[++i];
+        if (flag == "--sizes"s) {
+            options.sizes = ParseList<size_t>(value);
+        }
+        else if (flag == "--threads"s) {
+            options.threads = ParseList<size_t>(value);
+        }
+        else if (flag == "--suites"s) {
+            options.suites = ParseList<std::string>(value);
+        }
+        else if (flag == "--seed"s) {
+            options.corpus.seed = std::stoull(value);
+            options.queries.seed = options.corpus.seed + 1;
+        }
+        else if (flag == "--vocabulary"s) {
+            options.corpus.vocabulary_size = std::stoul(value);
+        }
+        else if (flag == "--min-length"s) {
+            options.corpus.min_document_length = std::stoul(value);
+        }
+        else if (flag == "--max-length"s) {
+            options.corpus.max_document_length = std::stoul(value);
+        }
+        else if (flag == "--zipf"s) {
+            options.corpus.zipf_exponent = std::stod(value);
+        }
+        else if (flag == "--stop-ratio"s) {
+            options.corpus.stop_word_ratio = std::stod(value);
+        }
+        else if (flag == "--queries"s) {
+            options.queries.query_count = std::stoul(value);
+        }
+        else if (flag == "--minus-rate"s) {
+            options.queries.minus_word_rate = std::stod(value);
+        }
+        else if (flag == "--output"s) {
+            options.output = value;
+        }
+        else {
+            throw std::invalid_argument("Unknown option: "s + flag);
+        }
+    }
+    return options;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        const BenchmarkOptions options = ParseOptions(argc, argv);
+        BenchmarkReport report(options);
+        for (const auto& suite : options.suites) {
+            const auto it = SUITES.find(suite);
+            if (it == SUITES.end()) {
+                throw std::invalid_argument("Unknown suite: "s + suite);
+            }
+            it->second(options, report);
+        }
+        if (options.output.empty()) {
+            report.Print(std::cout);
+        }
+        else {
+            std::ofstream output(options.output);
+            report.Print(output);
+        }
+        std::cerr << "checksum: "s << benchmark_checksum << std::endl;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Benchmark failed: "s << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
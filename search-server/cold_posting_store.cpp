@@ -0,0 +1,163 @@
+#include "cold_posting_store.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+void WriteAll(int fd, const void* data, size_t size, const std::string& path) {
+    using namespace std::string_literals;
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        const ssize_t count = ::write(fd, bytes, size);
+        if (count >= 0) {
+            bytes += count;
+            size -= static_cast<size_t>(count);
+        }
+        else if (errno != EINTR) {
+            throw std::runtime_error("Cannot write "s + path + ": "s + std::strerror(errno));
+        }
+    }
+}
+
+void ReadAll(int fd, void* data, size_t size, uint64_t offset, const std::string& path) {
+    using namespace std::string_literals;
+    char* bytes = static_cast<char*>(data);
+    while (size > 0) {
+        const ssize_t count = ::pread(fd, bytes, size, static_cast<off_t>(offset));
+        if (count > 0) {
+            bytes += count;
+            size -= static_cast<size_t>(count);
+            offset += static_cast<uint64_t>(count);
+        }
+        else if (count == 0) {
+            throw std::runtime_error("Unexpected end of "s + path);
+        }
+        else if (errno != EINTR) {
+            throw std::runtime_error("Cannot read "s + path + ": "s + std::strerror(errno));
+        }
+    }
+}
+
+}
+
+ColdPostingStore::ColdPostingStore(const std::string& path, size_t capacity, size_t term_freq_size, Decoder decoder)
+    : fd_(::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644))
+    , path_(path)
+    , term_freq_size_(term_freq_size)
+    , decoder_(decoder)
+    , capacity_(capacity) {
+    using namespace std::string_literals;
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot open "s + path + ": "s + std::strerror(errno));
+    }
+}
+
+ColdPostingStore::~ColdPostingStore() {
+    ::close(fd_);
+}
+
+// A list is stored as its document numbers followed by its frequencies.
+void ColdPostingStore::Append(int term_id, const uint32_t* documents, const void* term_freqs, double scale,
+                              uint32_t count) {
+    WriteAll(fd_, documents, count * sizeof(uint32_t), path_);
+    WriteAll(fd_, term_freqs, count * term_freq_size_, path_);
+    const Extent extent{ file_size_, count, scale };
+    extents_[term_id] = extent;
+    file_size_ += ColdPostingStore::GetByteCount(extent);
+}
+
+// The file is read without the lock; two threads missing the same list may both
+// read it, and the second one keeps the cached copy.
+std::shared_ptr<const ColdPostingStore::Postings> ColdPostingStore::Load(int term_id) const {
+    const auto extent = extents_.find(term_id);
+    if (extent == extents_.end()) {
+        throw std::out_of_range("Postings are not in the store");
+    }
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        const auto it = entries_.find(term_id);
+        if (it != entries_.end()) {
+            ++stats_.hit_count;
+            auto postings = it->second.postings;
+            ColdPostingStore::Promote(term_id, it->second);
+            return postings;
+        }
+        ++stats_.miss_count;
+    }
+    auto postings = ColdPostingStore::Read(extent->second);
+    std::lock_guard<std::mutex> guard(mutex_);
+    stats_.read_byte_count += ColdPostingStore::GetByteCount(extent->second);
+    const auto [it, is_inserted] = entries_.try_emplace(term_id);
+    if (!is_inserted) {
+        return it->second.postings;
+    }
+    probation_.push_front(term_id);
+    it->second = { postings, sizeof(Postings) + extent->second.count * (sizeof(uint32_t) + sizeof(double)), false,
+                   probation_.begin() };
+    probation_byte_count_ += it->second.byte_count;
+    ColdPostingStore::Rebalance();
+    return postings;
+}
+
+PostingCacheStats ColdPostingStore::GetStats() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto stats = stats_;
+    stats.cached_byte_count = probation_byte_count_ + protected_byte_count_;
+    return stats;
+}
+
+size_t ColdPostingStore::GetByteCount(const Extent& extent) const {
+    return extent.count * (sizeof(uint32_t) + term_freq_size_);
+}
+
+std::shared_ptr<const ColdPostingStore::Postings> ColdPostingStore::Read(const Extent& extent) const {
+    auto postings = std::make_shared<Postings>();
+    postings->documents.resize(extent.count);
+    postings->term_freqs.resize(extent.count);
+    std::vector<char> stored_freqs(extent.count * term_freq_size_);
+    ReadAll(fd_, postings->documents.data(), extent.count * sizeof(uint32_t), extent.offset, path_);
+    ReadAll(fd_, stored_freqs.data(), stored_freqs.size(), extent.offset + extent.count * sizeof(uint32_t), path_);
+    decoder_(stored_freqs.data(), extent.count, extent.scale, postings->term_freqs.data());
+    return postings;
+}
+
+void ColdPostingStore::Promote(int term_id, CacheEntry& entry) const {
+    if (entry.is_protected) {
+        protected_.splice(protected_.begin(), protected_, entry.position);
+        return;
+    }
+    probation_.erase(entry.position);
+    probation_byte_count_ -= entry.byte_count;
+    protected_.push_front(term_id);
+    protected_byte_count_ += entry.byte_count;
+    entry.is_protected = true;
+    entry.position = protected_.begin();
+    ++stats_.promotion_count;
+    ColdPostingStore::Rebalance();
+}
+
+void ColdPostingStore::Rebalance() const {
+    while (!protected_.empty() && protected_byte_count_ > capacity_ * PROTECTED_SHARE) {
+        const int term_id = protected_.back();
+        auto& entry = entries_.at(term_id);
+        protected_.pop_back();
+        protected_byte_count_ -= entry.byte_count;
+        probation_.push_front(term_id);
+        probation_byte_count_ += entry.byte_count;
+        entry.is_protected = false;
+        entry.position = probation_.begin();
+        ++stats_.demotion_count;
+    }
+    while (!probation_.empty() && probation_byte_count_ + protected_byte_count_ > capacity_) {
+        const int term_id = probation_.back();
+        probation_.pop_back();
+        probation_byte_count_ -= entries_.at(term_id).byte_count;
+        entries_.erase(term_id);
+        ++stats_.eviction_count;
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct PostingCacheStats {
+    uint64_t hit_count = 0;
+    uint64_t miss_count = 0;
+    uint64_t read_byte_count = 0;
+    uint64_t promotion_count = 0;
+    uint64_t demotion_count = 0;
+    uint64_t eviction_count = 0;
+    size_t cached_byte_count = 0;
+};
+
+// Posting lists written to a file once and read back with pread through a cache
+// bounded in bytes. The cache is a segmented LRU: a list read from disk enters
+// the probation segment and a hit while it is cached promotes it to the
+// protected segment. The protected segment holds at most PROTECTED_SHARE of the
+// capacity and demotes its least recently used lists back to probation; only
+// probation lists are evicted, so a burst of words queried once cannot push out
+// the words queried often. Append must not race with other calls; Load and
+// GetStats may run concurrently.
+// Frequencies are written in the encoding of the index, term_freq_size bytes
+// each, and decoded when a list is read: the decoder receives the stored values,
+// their count and the scale given to Append, and fills the doubles.
+class ColdPostingStore {
+public:
+    struct Postings {
+        std::vector<uint32_t> documents;
+        std::vector<double> term_freqs;
+    };
+    using Decoder = void (*)(const void*, uint32_t, double, double*);
+
+    static constexpr double PROTECTED_SHARE = 0.8;
+
+    ColdPostingStore(const std::string&, size_t, size_t, Decoder);
+    ColdPostingStore(const ColdPostingStore&) = delete;
+    ColdPostingStore& operator=(const ColdPostingStore&) = delete;
+    ~ColdPostingStore();
+
+    void Append(int, const uint32_t*, const void*, double, uint32_t);
+    // The postings stay valid while the pointer is held, even if evicted.
+    std::shared_ptr<const Postings> Load(int) const;
+    PostingCacheStats GetStats() const;
+
+private:
+    struct Extent {
+        uint64_t offset;
+        uint32_t count;
+        double scale;
+    };
+    struct CacheEntry {
+        std::shared_ptr<const Postings> postings;
+        size_t byte_count;
+        bool is_protected;
+        std::list<int>::iterator position;
+    };
+
+    int fd_;
+    std::string path_;
+    size_t term_freq_size_;
+    Decoder decoder_;
+    uint64_t file_size_ = 0;
+    std::unordered_map<int, Extent> extents_;
+    size_t capacity_;
+    mutable std::mutex mutex_;
+    mutable std::unordered_map<int, CacheEntry> entries_;
+    // Most recently used first.
+    mutable std::list<int> probation_;
+    mutable std::list<int> protected_;
+    mutable size_t probation_byte_count_ = 0;
+    mutable size_t protected_byte_count_ = 0;
+    mutable PostingCacheStats stats_;
+
+    size_t GetByteCount(const Extent&) const;
+    std::shared_ptr<const Postings> Read(const Extent&) const;
+    void Promote(int, CacheEntry&) const;
+    void Rebalance() const;
+};
@@ -0,0 +1,21 @@
+#include "compiled_query.h"
+
+CompiledQuery::CompiledQuery(const SearchServer* server, QueryMode mode, std::pmr::memory_resource* resource)
+    : server_(server)
+    , mode_(mode)
+    , plus_terms_(resource)
+    , sorted_plus_terms_(resource)
+    , minus_terms_(resource) {
+}
+
+size_t CompiledQuery::GetPlusTermCount() const {
+    return plus_terms_.size();
+}
+
+size_t CompiledQuery::GetMinusTermCount() const {
+    return minus_terms_.size();
+}
+
+QueryMode CompiledQuery::GetMode() const {
+    return mode_;
+}
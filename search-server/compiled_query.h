@@ -0,0 +1,39 @@
+#pragma once
+
+#include <memory_resource>
+#include <vector>
+
+class SearchServer;
+
+// ANY scores documents with at least one plus word, ALL only documents with
+// every plus word; prefix words are not supported in ALL mode.
+enum class QueryMode {
+    ANY,
+    ALL,
+};
+
+// A query resolved to the term ids of one SearchServer, so that it can be run
+// many times without parsing. Words the dictionary does not know are dropped:
+// the query sees only the terms that existed when it was compiled, so compile
+// it again after adding documents with new words. Plus terms are ordered by
+// their words, the order in which relevance is summed, minus terms by id;
+// a copy of the plus terms sorted by id is intersected with documents.
+// An ALL query with an unknown plus word matches nothing.
+class CompiledQuery {
+    friend class SearchServer;
+
+public:
+    size_t GetPlusTermCount() const;
+    size_t GetMinusTermCount() const;
+    QueryMode GetMode() const;
+
+private:
+    CompiledQuery(const SearchServer*, QueryMode, std::pmr::memory_resource*);
+
+    const SearchServer* server_;
+    QueryMode mode_;
+    bool has_unknown_plus_words_ = false;
+    std::pmr::vector<int> plus_terms_;
+    std::pmr::vector<int> sorted_plus_terms_;
+    std::pmr::vector<int> minus_terms_;
+};
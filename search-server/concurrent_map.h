@@ -39,6 +39,7 @@ public:
 
     void Erase(const Key& key) {
         size_t index = (static_cast<uint64_t>(key) % size_);
+        std::lock_guard<std::mutex> guard(buckets_[index].m);
         buckets_[index].single_bucket.erase(key);
         return;
     }
@@ -0,0 +1,150 @@
+#include "corpus_generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+
+namespace {
+
+const std::string CONSONANTS = "bcdfghjklmnprstvwxz";
+const std::string VOWELS = "aeiou";
+
+std::string MakeWord(size_t index) {
+    const size_t syllable_count = CONSONANTS.size() * VOWELS.size();
+    std::string word;
+    do {
+        const size_t syllable = index % syllable_count;
+        word += CONSONANTS[syllable / VOWELS.size()];
+        word += VOWELS[syllable % VOWELS.size()];
+        index /= syllable_count;
+    } while (index > 0);
+    return word;
+}
+
+double UniformReal(std::mt19937_64& random) {
+    return (random() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+size_t UniformIndex(std::mt19937_64& random, size_t min_value, size_t max_value) {
+    return min_value + static_cast<size_t>(random() % (max_value - min_value + 1));
+}
+
+}
+
+CorpusGenerator::CorpusGenerator(const CorpusOptions& options)
+    : options_(options)
+{
+    using namespace std::string_literals;
+    if (options_.vocabulary_size == 0 || options_.min_document_length == 0
+        || options_.min_document_length > options_.max_document_length) {
+        throw std::invalid_argument("Invalid corpus options"s);
+    }
+    vocabulary_.reserve(options_.vocabulary_size);
+    for (size_t i = 0; i < options_.vocabulary_size; ++i) {
+        vocabulary_.push_back(MakeWord(i));
+    }
+    for (size_t i = 0; i < options_.stop_word_count; ++i) {
+        stop_words_.push_back("q"s + MakeWord(i));
+    }
+    rank_cdf_.reserve(options_.vocabulary_size);
+    double total = 0.0;
+    for (size_t rank = 1; rank <= options_.vocabulary_size; ++rank) {
+        total += 1.0 / std::pow(static_cast<double>(rank), options_.zipf_exponent);
+        rank_cdf_.push_back(total);
+    }
+    for (double& value : rank_cdf_) {
+        value /= total;
+    }
+}
+
+const std::vector<std::string>& CorpusGenerator::GetVocabulary() const {
+    return vocabulary_;
+}
+
+const std::vector<std::string>& CorpusGenerator::GetStopWords() const {
+    return stop_words_;
+}
+
+std::string CorpusGenerator::GetStopWordsText() const {
+    std::string text;
+    for (const auto& word : stop_words_) {
+        if (!text.empty()) text += ' ';
+        text += word;
+    }
+    return text;
+}
+
+template <typename Random>
+const std::string& CorpusGenerator::SampleWord(Random& random) const {
+    const auto it = std::lower_bound(rank_cdf_.begin(), rank_cdf_.end(), UniformReal(random));
+    return vocabulary_[std::min<size_t>(it - rank_cdf_.begin(), vocabulary_.size() - 1)];
+}
+
+std::vector<GeneratedDocument> CorpusGenerator::GenerateDocuments() const {
+    std::mt19937_64 random(options_.seed);
+    std::vector<GeneratedDocument> documents;
+    documents.reserve(options_.document_count);
+    for (size_t i = 0; i < options_.document_count; ++i) {
+        GeneratedDocument document{ static_cast<int>(i), {}, DocumentStatus::ACTUAL, {} };
+        const size_t length = UniformIndex(random, options_.min_document_length, options_.max_document_length);
+        for (size_t j = 0; j < length; ++j) {
+            if (j > 0) document.text += ' ';
+            if (!stop_words_.empty() && UniformReal(random) < options_.stop_word_ratio) {
+                document.text += stop_words_[UniformIndex(random, 0, stop_words_.size() - 1)];
+            }
+            else {
+                document.text += SampleWord(random);
+            }
+        }
+        const double status_roll = UniformReal(random);
+        if (status_roll > 0.9) {
+            document.status = static_cast<DocumentStatus>(1 + UniformIndex(random, 0, 2));
+        }
+        const size_t rating_count = UniformIndex(random, 1, 5);
+        for (size_t j = 0; j < rating_count; ++j) {
+            document.ratings.push_back(static_cast<int>(UniformIndex(random, 0, 15)) - 5);
+        }
+        documents.push_back(std::move(document));
+    }
+    return documents;
+}
+
+std::vector<std::string> CorpusGenerator::GenerateQueries(const QueryOptions& options) const {
+    using namespace std::string_literals;
+    if (options.min_query_length == 0 || options.min_query_length > options.max_query_length) {
+        throw std::invalid_argument("Invalid query options"s);
+    }
+    std::mt19937_64 random(options.seed);
+    std::vector<std::string> queries;
+    queries.reserve(options.query_count);
+    for (size_t i = 0; i < options.query_count; ++i) {
+        std::string query;
+        const size_t length = UniformIndex(random, options.min_query_length, options.max_query_length);
+        for (size_t j = 0; j < length; ++j) {
+            if (j > 0) query += ' ';
+            if (UniformReal(random) < options.minus_word_rate) {
+                query += '-';
+            }
+            if (!stop_words_.empty() && UniformReal(random) < options.stop_word_ratio) {
+                query += stop_words_[UniformIndex(random, 0, stop_words_.size() - 1)];
+            }
+            else {
+                query += SampleWord(random);
+            }
+        }
+        queries.push_back(std::move(query));
+    }
+    return queries;
+}
+
+void WriteCorpus(std::ostream& os, const std::vector<GeneratedDocument>& documents) {
+    static const char* const STATUS_NAMES[] = { "ACTUAL", "IRRELEVANT", "BANNED", "REMOVED" };
+    for (const auto& document : documents) {
+        os << document.id << '\t' << STATUS_NAMES[static_cast<int>(document.status)] << '\t';
+        for (size_t i = 0; i < document.ratings.size(); ++i) {
+            os << (i > 0 ? " " : "") << document.ratings[i];
+        }
+        os << '\t' << document.text << '\n';
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "document.h"
+
+struct CorpusOptions {
+    uint64_t seed = 42;
+    size_t document_count = 10000;
+    size_t vocabulary_size = 20000;
+    size_t min_document_length = 10;
+    size_t max_document_length = 60;
+    double zipf_exponent = 1.0;
+    size_t stop_word_count = 30;
+    double stop_word_ratio = 0.1;
+};
+
+struct QueryOptions {
+    uint64_t seed = 4242;
+    size_t query_count = 1000;
+    size_t min_query_length = 1;
+    size_t max_query_length = 5;
+    double minus_word_rate = 0.1;
+    double stop_word_ratio = 0.05;
+};
+
+struct GeneratedDocument {
+    int id;
+    std::string text;
+    DocumentStatus status;
+    std::vector<int> ratings;
+};
+
+// Deterministic generator: the same options always give the same corpus and queries,
+// because it relies only on std::mt19937_64 and its own distributions.
+class CorpusGenerator {
+public:
+    explicit CorpusGenerator(const CorpusOptions&);
+
+    const std::vector<std::string>& GetVocabulary() const;
+    const std::vector<std::string>& GetStopWords() const;
+    std::string GetStopWordsText() const;
+    std::vector<GeneratedDocument> GenerateDocuments() const;
+    std::vector<std::string> GenerateQueries(const QueryOptions&) const;
+
+private:
+    CorpusOptions options_;
+    std::vector<std::string> vocabulary_;
+    std::vector<std::string> stop_words_;
+    std::vector<double> rank_cdf_;
+
+    template <typename Random>
+    const std::string& SampleWord(Random&) const;
+};
+
+// Writes documents in the line format read by IngestCorpus.
+void WriteCorpus(std::ostream&, const std::vector<GeneratedDocument>&);
@@ -0,0 +1,273 @@
+#include "corpus_ingestion.h"
+
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "bounded_queue.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Block = std::vector<char>;
+using ReadFunction = std::function<size_t(char*, size_t)>;
+
+struct PreparedBlock {
+    Block text;
+    std::vector<PreparedDocument> documents;
+};
+
+[[noreturn]] void ThrowInvalidLine(std::string_view line) {
+    using namespace std::string_literals;
+    const size_t MAX_QUOTED_SIZE = 64;
+    throw std::invalid_argument("Invalid document line: "s + std::string(line.substr(0, MAX_QUOTED_SIZE)));
+}
+
+int ParseNumber(std::string_view text, std::string_view line) {
+    int number = 0;
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), number);
+    if (error != std::errc() || end != text.data() + text.size()) {
+        ThrowInvalidLine(line);
+    }
+    return number;
+}
+
+DocumentStatus ParseStatus(std::string_view text, std::string_view line) {
+    if (text == "ACTUAL") return DocumentStatus::ACTUAL;
+    if (text == "IRRELEVANT") return DocumentStatus::IRRELEVANT;
+    if (text == "BANNED") return DocumentStatus::BANNED;
+    if (text == "REMOVED") return DocumentStatus::REMOVED;
+    ThrowInvalidLine(line);
+}
+
+std::string_view TakeField(std::string_view& rest, std::string_view line) {
+    const auto tab = rest.find('\t');
+    if (tab == rest.npos) {
+        ThrowInvalidLine(line);
+    }
+    const auto field = rest.substr(0, tab);
+    rest.remove_prefix(tab + 1);
+    return field;
+}
+
+void PrepareBlock(const SearchServer& search_server, PreparedBlock& block) {
+    std::vector<int> ratings;
+    std::string_view text(block.text.data(), block.text.size());
+    while (!text.empty()) {
+        const auto newline = text.find('\n');
+        auto line = text.substr(0, newline);
+        text.remove_prefix(newline == text.npos ? text.size() : newline + 1);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.empty()) {
+            continue;
+        }
+        std::string_view rest = line;
+        const int document_id = ParseNumber(TakeField(rest, line), line);
+        const auto status = ParseStatus(TakeField(rest, line), line);
+        ratings.clear();
+        ForEachWord(TakeField(rest, line), [&ratings, line](std::string_view rating) {
+            ratings.push_back(ParseNumber(rating, line));
+        });
+        block.documents.push_back(search_server.PrepareDocument(document_id, rest, status, ratings));
+    }
+}
+
+IngestionStats RunPipeline(SearchServer& search_server, const ReadFunction& read, const IngestionOptions& options) {
+    const auto start_time = Clock::now();
+    const size_t tokenizer_count = std::max<size_t>(options.tokenizer_count, 1);
+    const size_t block_size = std::max<size_t>(options.block_size, 1);
+    const size_t queue_capacity = std::max<size_t>(options.queue_capacity, 1);
+    // Every block is in one stage or queue at a time, so the pool never runs dry.
+    const size_t block_count = 2 * queue_capacity + tokenizer_count + 2;
+    BoundedQueue<Block> free_blocks(block_count);
+    BoundedQueue<Block> text_blocks(queue_capacity);
+    BoundedQueue<PreparedBlock> prepared_blocks(queue_capacity);
+    for (size_t i = 0; i < block_count; ++i) {
+        free_blocks.Push(Block());
+    }
+
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    const auto fail = [&]() {
+        {
+            std::lock_guard<std::mutex> guard(error_mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+        free_blocks.Close();
+        text_blocks.Close();
+        prepared_blocks.Close();
+    };
+
+    IngestionStats stats;
+    stats.tokenize.thread_count = tokenizer_count;
+    std::thread reader([&]() {
+        try {
+            Block carry;
+            bool is_at_end = false;
+            while (!is_at_end) {
+                auto block = free_blocks.Pop();
+                if (!block) {
+                    break;
+                }
+                Block& text = *block;
+                text.assign(carry.begin(), carry.end());
+                const size_t carry_size = text.size();
+                text.resize(carry_size + block_size);
+                const auto read_start = Clock::now();
+                const size_t read_count = read(text.data() + carry_size, block_size);
+                stats.read.busy_time += Clock::now() - read_start;
+                stats.byte_count += read_count;
+                text.resize(carry_size + read_count);
+                is_at_end = read_count == 0;
+                const size_t end = is_at_end ? text.size()
+                                             : text.rend() - std::find(text.rbegin(), text.rend(), '\n');
+                carry.assign(text.begin() + end, text.end());
+                text.resize(end);
+                if (text.empty()) {
+                    free_blocks.Push(std::move(text));
+                    continue;
+                }
+                ++stats.block_count;
+                if (!text_blocks.Push(std::move(text))) {
+                    break;
+                }
+            }
+            text_blocks.Close();
+        }
+        catch (...) {
+            fail();
+        }
+    });
+
+    std::vector<std::chrono::nanoseconds> tokenize_times(tokenizer_count);
+    std::atomic<size_t> running_tokenizers{tokenizer_count};
+    std::vector<std::thread> tokenizers;
+    tokenizers.reserve(tokenizer_count);
+    for (size_t i = 0; i < tokenizer_count; ++i) {
+        tokenizers.emplace_back([&, i]() {
+            try {
+                while (auto text = text_blocks.Pop()) {
+                    const auto tokenize_start = Clock::now();
+                    PreparedBlock block{ std::move(*text), {} };
+                    PrepareBlock(search_server, block);
+                    tokenize_times[i] += Clock::now() - tokenize_start;
+                    if (!prepared_blocks.Push(std::move(block))) {
+                        break;
+                    }
+                }
+            }
+            catch (...) {
+                fail();
+            }
+            if (--running_tokenizers == 0) {
+                prepared_blocks.Close();
+            }
+        });
+    }
+
+    try {
+        while (auto block = prepared_blocks.Pop()) {
+            const auto index_start = Clock::now();
+            for (const auto& document : block->documents) {
+                search_server.AddPreparedDocument(document);
+            }
+            stats.index.busy_time += Clock::now() - index_start;
+            stats.document_count += block->documents.size();
+            block->documents.clear();
+            free_blocks.Push(std::move(block->text));
+        }
+    }
+    catch (...) {
+        fail();
+    }
+    reader.join();
+    for (auto& tokenizer : tokenizers) {
+        tokenizer.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    for (const auto tokenize_time : tokenize_times) {
+        stats.tokenize.busy_time += tokenize_time;
+    }
+    stats.wall_time = Clock::now() - start_time;
+    return stats;
+}
+
+}
+
+std::ostream& operator<<(std::ostream& os, const IngestionStats& stats) {
+    using namespace std::string_literals;
+    const auto seconds = [](std::chrono::nanoseconds time) { return std::chrono::duration<double>(time).count(); };
+    os << stats.byte_count << " bytes, "s << stats.block_count << " blocks, "s << stats.document_count
+       << " documents in "s << seconds(stats.wall_time) << " s\n"s;
+    const char* bottleneck = "";
+    double max_stage_time = -1.0;
+    for (const auto& [name, stage] : { std::pair{ "read", &stats.read },
+                                       std::pair{ "tokenize", &stats.tokenize },
+                                       std::pair{ "index", &stats.index } }) {
+        const double stage_time = seconds(stage->busy_time) / stage->thread_count;
+        os << name << ": "s << seconds(stage->busy_time) << " s busy on "s << stage->thread_count << " threads, "s
+           << (stage_time > 0 ? stats.byte_count / stage_time / (1 << 20) : 0.0) << " MiB/s\n"s;
+        if (stage_time > max_stage_time) {
+            max_stage_time = stage_time;
+            bottleneck = name;
+        }
+    }
+    return os << "bottleneck: "s << bottleneck;
+}
+
+IngestionStats IngestCorpus(SearchServer& search_server, std::istream& input, const IngestionOptions& options) {
+    return RunPipeline(search_server, [&input](char* data, size_t size) {
+        input.read(data, static_cast<std::streamsize>(size));
+        return static_cast<size_t>(input.gcount());
+    }, options);
+}
+
+IngestionStats IngestCorpus(SearchServer& search_server, const std::string& path, const IngestionOptions& options) {
+    using namespace std::string_literals;
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open "s + path + ": "s + std::strerror(errno));
+    }
+    const auto read = [fd, &path](char* data, size_t size) {
+        size_t read_count = 0;
+        while (read_count < size) {
+            const ssize_t result = ::read(fd, data + read_count, size - read_count);
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+            if (result < 0) {
+                throw std::runtime_error("Cannot read "s + path + ": "s + std::strerror(errno));
+            }
+            if (result == 0) {
+                break;
+            }
+            read_count += static_cast<size_t>(result);
+        }
+        return read_count;
+    };
+    try {
+        auto stats = RunPipeline(search_server, read, options);
+        ::close(fd);
+        return stats;
+    }
+    catch (...) {
+        ::close(fd);
+        throw;
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "search_server.h"
+
+// Input format: one document per line, four fields separated by tabs,
+//     <id> \t <status> \t <ratings> \t <text>
+// where status is ACTUAL, IRRELEVANT, BANNED or REMOVED and ratings are
+// integers separated by spaces, possibly none. Empty lines are skipped and a
+// trailing \r is ignored.
+struct IngestionOptions {
+    size_t tokenizer_count = std::max(1u, std::thread::hardware_concurrency());
+    size_t block_size = 1 << 20;
+    size_t queue_capacity = 4;
+};
+
+struct IngestionStageStats {
+    std::chrono::nanoseconds busy_time{0};
+    size_t thread_count = 1;
+};
+
+// Busy time excludes waiting on the queues, so the stage with the largest busy
+// time per thread is the one that limits throughput.
+struct IngestionStats {
+    uint64_t byte_count = 0;
+    uint64_t block_count = 0;
+    uint64_t document_count = 0;
+    std::chrono::nanoseconds wall_time{0};
+    IngestionStageStats read;
+    IngestionStageStats tokenize;
+    IngestionStageStats index;
+};
+
+std::ostream& operator<<(std::ostream&, const IngestionStats&);
+
+// Loads documents in three stages connected by bounded queues: a reader cuts
+// the input into large blocks at line boundaries, tokenizer threads parse the
+// lines of whole blocks into PreparedDocuments, and the calling thread adds
+// them to the server. Blocks are recycled, so the reader allocates nothing per
+// line. Documents may be added out of input order. The first error stops the
+// pipeline and is rethrown; documents added before it stay in the server.
+IngestionStats IngestCorpus(SearchServer&, std::istream&, const IngestionOptions& = {});
+IngestionStats IngestCorpus(SearchServer&, const std::string&, const IngestionOptions& = {});
@@ -1,4 +1,5 @@
 #pragma once
+#include <cmath>
 #include <iostream>
 
 struct Document {
@@ -15,6 +16,20 @@ struct Document {
     int rating = 0;
 };
 
+const double RELEVANCE_EPSILON = 1e-6;
+
+// Ties in relevance and rating go to the smaller id, so the top documents do
+// not depend on the order in which a search finds them.
+inline bool IsMoreRelevant(const Document& lhs, const Document& rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) < RELEVANCE_EPSILON) {
+        if (lhs.rating == rhs.rating) {
+            return lhs.id < rhs.id;
+        }
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.relevance > rhs.relevance;
+}
+
 enum class DocumentStatus {
     ACTUAL,
     IRRELEVANT,
@@ -22,4 +37,11 @@ enum class DocumentStatus {
     REMOVED,
 };
 
+// Document predicate that keeps the documents with the given status.
+inline auto HasStatus(DocumentStatus status) {
+    return [status](int, DocumentStatus document_status, int) {
+        return document_status == status;
+    };
+}
+
 std::ostream& operator<<(std::ostream&, const Document);
\ No newline at end of file
@@ -0,0 +1,42 @@
+#include "hashed_word_set.h"
+
+#include <algorithm>
+#include <functional>
+
+bool HashedWordSet::Contains(std::string_view word) const {
+    if (slots_.empty()) {
+        return false;
+    }
+    const size_t mask = slots_.size() - 1;
+    for (size_t slot = std::hash<std::string_view>{}(word) & mask; slots_[slot] != 0; slot = (slot + 1) & mask) {
+        if (words_[slots_[slot] - 1] == word) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t HashedWordSet::GetSize() const {
+    return words_.size();
+}
+
+void HashedWordSet::BuildSlots() {
+    std::sort(words_.begin(), words_.end());
+    words_.erase(std::unique(words_.begin(), words_.end()), words_.end());
+    if (words_.empty()) {
+        return;
+    }
+    size_t slot_count = 2;
+    while (slot_count < words_.size() * 2) {
+        slot_count *= 2;
+    }
+    slots_.assign(slot_count, 0);
+    const size_t mask = slot_count - 1;
+    for (size_t i = 0; i < words_.size(); ++i) {
+        size_t slot = std::hash<std::string_view>{}(words_[i]) & mask;
+        while (slots_[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        slots_[slot] = static_cast<uint32_t>(i + 1);
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Open-addressing hash set of non-empty words. Lookups by string_view never allocate,
+// unlike std::set<std::string>, and take one hash and usually one comparison.
+class HashedWordSet {
+public:
+    HashedWordSet() = default;
+    template <typename StringContainer>
+    explicit HashedWordSet(const StringContainer&);
+
+    bool Contains(std::string_view) const;
+    size_t GetSize() const;
+
+private:
+    std::vector<std::string> words_;
+    // Index of the word plus one, zero marks an empty slot.
+    std::vector<uint32_t> slots_;
+
+    void BuildSlots();
+};
+
+template <typename StringContainer>
+HashedWordSet::HashedWordSet(const StringContainer& words) {
+    for (const auto& word : words) {
+        if (!std::string_view(word).empty()) {
+            words_.emplace_back(word);
+        }
+    }
+    HashedWordSet::BuildSlots();
+}
@@ -0,0 +1,231 @@
+#include "ipc_protocol.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+void Encoder::PutU8(uint8_t value) {
+    PutRaw(value);
+}
+
+void Encoder::PutU32(uint32_t value) {
+    PutRaw(value);
+}
+
+void Encoder::PutU64(uint64_t value) {
+    PutRaw(value);
+}
+
+void Encoder::PutI32(int32_t value) {
+    PutRaw(value);
+}
+
+void Encoder::PutF64(double value) {
+    PutRaw(value);
+}
+
+void Encoder::PutString(std::string_view value) {
+    PutU32(static_cast<uint32_t>(value.size()));
+    buffer_.append(value.data(), value.size());
+}
+
+void Encoder::BeginFrame(uint8_t code, uint32_t request_id) {
+    frame_start_ = buffer_.size();
+    PutU32(0);
+    PutU8(code);
+    PutU32(request_id);
+}
+
+void Encoder::EndFrame() {
+    const uint32_t payload_size = static_cast<uint32_t>(buffer_.size() - frame_start_ - FRAME_HEADER_SIZE);
+    std::memcpy(&buffer_[frame_start_], &payload_size, sizeof(payload_size));
+}
+
+void Encoder::CancelFrame() {
+    buffer_.resize(frame_start_);
+}
+
+const std::string& Encoder::GetBuffer() const {
+    return buffer_;
+}
+
+void Encoder::Clear() {
+    buffer_.clear();
+    frame_start_ = 0;
+}
+
+template <typename T>
+void Encoder::PutRaw(T value) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    buffer_.append(bytes, sizeof(T));
+}
+
+Decoder::Decoder(std::string_view data)
+    : data_(data) {
+}
+
+uint8_t Decoder::GetU8() {
+    return GetRaw<uint8_t>();
+}
+
+uint32_t Decoder::GetU32() {
+    return GetRaw<uint32_t>();
+}
+
+uint64_t Decoder::GetU64() {
+    return GetRaw<uint64_t>();
+}
+
+int32_t Decoder::GetI32() {
+    return GetRaw<int32_t>();
+}
+
+double Decoder::GetF64() {
+    return GetRaw<double>();
+}
+
+std::string_view Decoder::GetString() {
+    const uint32_t size = GetU32();
+    if (data_.size() < size) {
+        throw std::invalid_argument("Truncated message");
+    }
+    const auto result = data_.substr(0, size);
+    data_.remove_prefix(size);
+    return result;
+}
+
+bool Decoder::IsEmpty() const {
+    return data_.empty();
+}
+
+template <typename T>
+T Decoder::GetRaw() {
+    if (data_.size() < sizeof(T)) {
+        throw std::invalid_argument("Truncated message");
+    }
+    T value;
+    std::memcpy(&value, data_.data(), sizeof(T));
+    data_.remove_prefix(sizeof(T));
+    return value;
+}
+
+FrameReader::FrameReader(int fd)
+    : fd_(fd) {
+}
+
+bool FrameReader::Next(FrameHeader& header, std::string_view& payload) {
+    using namespace std::string_literals;
+    if (!Fill(FRAME_HEADER_SIZE)) {
+        return false;
+    }
+    const char* data = buffer_.data() + position_;
+    std::memcpy(&header.payload_size, data, 4);
+    std::memcpy(&header.code, data + 4, 1);
+    std::memcpy(&header.request_id, data + 5, 4);
+    if (header.payload_size > MAX_PAYLOAD_SIZE) {
+        throw std::invalid_argument("Frame is too large"s);
+    }
+    if (!Fill(FRAME_HEADER_SIZE + header.payload_size)) {
+        throw std::runtime_error("Connection closed in the middle of a frame"s);
+    }
+    payload = std::string_view(buffer_).substr(position_ + FRAME_HEADER_SIZE, header.payload_size);
+    position_ += FRAME_HEADER_SIZE + header.payload_size;
+    return true;
+}
+
+bool FrameReader::HasPendingData() const {
+    if (position_ < buffer_.size()) {
+        return true;
+    }
+    int available = 0;
+    return ::ioctl(fd_, FIONREAD, &available) == 0 && available > 0;
+}
+
+bool FrameReader::Fill(size_t size) {
+    using namespace std::string_literals;
+    const size_t READ_CHUNK_SIZE = 64 * 1024;
+    if (buffer_.size() - position_ >= size) {
+        return true;
+    }
+    buffer_.erase(0, position_);
+    position_ = 0;
+    while (buffer_.size() < size) {
+        const size_t old_size = buffer_.size();
+        buffer_.resize(old_size + std::max(size - old_size, READ_CHUNK_SIZE));
+        const ssize_t count = ::read(fd_, buffer_.data() + old_size, buffer_.size() - old_size);
+        buffer_.resize(old_size + std::max<ssize_t>(count, 0));
+        if (count == 0) {
+            if (old_size == 0) return false;
+            throw std::runtime_error("Connection closed in the middle of a frame"s);
+        }
+        if (count < 0 && errno != EINTR) {
+            throw std::runtime_error("Socket read failed: "s + std::strerror(errno));
+        }
+    }
+    return true;
+}
+
+void WriteAll(int fd, std::string_view data) {
+    using namespace std::string_literals;
+    while (!data.empty()) {
+        const ssize_t count = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (count >= 0) {
+            data.remove_prefix(static_cast<size_t>(count));
+        }
+        else if (errno != EINTR) {
+            throw std::runtime_error("Socket write failed: "s + std::strerror(errno));
+        }
+    }
+}
+
+namespace {
+
+sockaddr_un MakeAddress(const std::string& path) {
+    using namespace std::string_literals;
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("Socket path is too long: "s + path);
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+}
+
+int ListenUnixSocket(const std::string& path) {
+    using namespace std::string_literals;
+    const auto address = MakeAddress(path);
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot create socket: "s + std::strerror(errno));
+    }
+    ::unlink(path.c_str());
+    if (::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0
+        || ::listen(fd, SOMAXCONN) < 0) {
+        const int error = errno;
+        ::close(fd);
+        throw std::runtime_error("Cannot listen on "s + path + ": "s + std::strerror(error));
+    }
+    return fd;
+}
+
+int ConnectUnixSocket(const std::string& path) {
+    using namespace std::string_literals;
+    const auto address = MakeAddress(path);
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot create socket: "s + std::strerror(errno));
+    }
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+        const int error = errno;
+        ::close(fd);
+        throw std::runtime_error("Cannot connect to "s + path + ": "s + std::strerror(error));
+    }
+    return fd;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// Binary protocol of the shard server. Every message is a frame:
+//   uint32 payload size | uint8 code | uint32 request id | payload
+// The code of a request is its Opcode, the code of a response is its ResponseCode.
+// Integers and doubles are sent in host byte order, since both ends always run
+// on the same machine. Responses come in request order, so a client may pipeline
+// any number of requests before reading the answers.
+enum class Opcode : uint8_t {
+    ADD_DOCUMENT,
+    REMOVE_DOCUMENT,
+    FIND_TOP_DOCUMENTS,
+    MATCH_DOCUMENT,
+    GET_TERM_STATS,
+    GET_DOCUMENT_COUNT,
+};
+
+enum class ResponseCode : uint8_t {
+    OK,
+    INVALID_ARGUMENT,
+    OUT_OF_RANGE,
+    INTERNAL_ERROR,
+};
+
+struct FrameHeader {
+    uint32_t payload_size = 0;
+    uint8_t code = 0;
+    uint32_t request_id = 0;
+};
+
+constexpr size_t FRAME_HEADER_SIZE = 9;
+constexpr uint32_t MAX_PAYLOAD_SIZE = 64u << 20;
+
+class Encoder {
+public:
+    void PutU8(uint8_t);
+    void PutU32(uint32_t);
+    void PutU64(uint64_t);
+    void PutI32(int32_t);
+    void PutF64(double);
+    void PutString(std::string_view);
+
+    void BeginFrame(uint8_t, uint32_t);
+    void EndFrame();
+    void CancelFrame();
+    const std::string& GetBuffer() const;
+    void Clear();
+
+private:
+    std::string buffer_;
+    size_t frame_start_ = 0;
+
+    template <typename T>
+    void PutRaw(T);
+};
+
+// Reads values from a payload; throws std::invalid_argument on a truncated one.
+class Decoder {
+public:
+    explicit Decoder(std::string_view);
+
+    uint8_t GetU8();
+    uint32_t GetU32();
+    uint64_t GetU64();
+    int32_t GetI32();
+    double GetF64();
+    std::string_view GetString();
+    bool IsEmpty() const;
+
+private:
+    std::string_view data_;
+
+    template <typename T>
+    T GetRaw();
+};
+
+// Buffers reads from a socket so that pipelined frames are taken from memory
+// instead of costing a system call each. Next returns false if the peer closed
+// the connection between frames; the payload stays valid until the next call.
+class FrameReader {
+public:
+    explicit FrameReader(int);
+
+    bool Next(FrameHeader&, std::string_view&);
+    bool HasPendingData() const;
+
+private:
+    int fd_;
+    std::string buffer_;
+    size_t position_ = 0;
+
+    bool Fill(size_t);
+};
+
+// Blocking socket helpers, retried on EINTR; they throw std::runtime_error on failure.
+void WriteAll(int, std::string_view);
+int ListenUnixSocket(const std::string&);
+int ConnectUnixSocket(const std::string&);
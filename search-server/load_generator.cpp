@@ -0,0 +1,72 @@
+#include "load_generator.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "metrics.h"
+
+double LoadReport::GetAchievedQps() const {
+    return elapsed_seconds == 0.0 ? 0.0 : (ok + timed_out + failed) / elapsed_seconds;
+}
+
+LoadReport GenerateLoad(AsyncSearchServer& server, const std::vector<std::string>& queries, const LoadOptions& options) {
+    using namespace std::chrono;
+    using namespace std::string_literals;
+    if (queries.empty() || options.target_qps <= 0.0) {
+        throw std::invalid_argument("Load needs queries and a positive rate"s);
+    }
+    LoadReport report;
+    LatencyHistogram latencies;
+    std::mutex mutex;
+    std::condition_variable all_answered;
+    uint64_t answered = 0;
+
+    const auto interval = duration_cast<steady_clock::duration>(duration<double>(1.0 / options.target_qps));
+    const auto start = steady_clock::now();
+    const auto stop = start + options.duration;
+    auto next_send = start;
+    for (size_t i = 0; next_send < stop; ++i, next_send += interval) {
+        std::this_thread::sleep_until(next_send);
+        QueryRequest request{ queries[i % queries.size()], DocumentStatus::ACTUAL, options.time_budget };
+        const auto sent_at = steady_clock::now();
+        auto on_response = [&, sent_at](QueryResponse response) {
+            const auto latency = duration_cast<nanoseconds>(steady_clock::now() - sent_at).count();
+            std::lock_guard<std::mutex> guard(mutex);
+            switch (response.status) {
+            case QueryStatus::OK: ++report.ok; break;
+            case QueryStatus::TIMEOUT: ++report.timed_out; break;
+            case QueryStatus::REJECTED: ++report.rejected; break;
+            case QueryStatus::FAILED: ++report.failed; break;
+            }
+            if (response.status != QueryStatus::REJECTED) {
+                latencies.Record(latency);
+            }
+            ++answered;
+            all_answered.notify_one();
+        };
+        ++report.sent;
+        if (options.shed_load) {
+            server.TrySubmit(std::move(request), on_response);
+        }
+        else {
+            server.Submit(std::move(request), on_response);
+        }
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    all_answered.wait(lock, [&]() { return answered == report.sent; });
+    report.elapsed_seconds = duration<double>(steady_clock::now() - start).count();
+    report.p50_latency_ns = latencies.ValueAtPercentile(50.0);
+    report.p99_latency_ns = latencies.ValueAtPercentile(99.0);
+    report.max_latency_ns = latencies.GetMax();
+    return report;
+}
+
+std::ostream& operator<<(std::ostream& os, const LoadReport& report) {
+    using namespace std::string_literals;
+    return os << "{ sent = "s << report.sent << ", ok = "s << report.ok
+              << ", timed_out = "s << report.timed_out << ", rejected = "s << report.rejected
+              << ", failed = "s << report.failed << ", qps = "s << report.GetAchievedQps()
+              << ", p50_us = "s << report.p50_latency_ns / 1000 << ", p99_us = "s << report.p99_latency_ns / 1000 << " }"s;
+}
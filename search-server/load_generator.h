@@ -0,0 +1,35 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "async_search_server.h"
+
+struct LoadOptions {
+    double target_qps = 1000.0;
+    std::chrono::milliseconds duration = std::chrono::milliseconds(1000);
+    std::chrono::milliseconds time_budget = std::chrono::milliseconds(50);
+    bool shed_load = true;
+};
+
+struct LoadReport {
+    uint64_t sent = 0;
+    uint64_t ok = 0;
+    uint64_t timed_out = 0;
+    uint64_t rejected = 0;
+    uint64_t failed = 0;
+    double elapsed_seconds = 0.0;
+    uint64_t p50_latency_ns = 0;
+    uint64_t p99_latency_ns = 0;
+    uint64_t max_latency_ns = 0;
+
+    double GetAchievedQps() const;
+};
+
+// Open-loop generator: sends queries at a fixed rate regardless of how fast they
+// are answered, so overload shows up as timeouts and rejections, not as a lower rate.
+LoadReport GenerateLoad(AsyncSearchServer&, const std::vector<std::string>&, const LoadOptions&);
+
+std::ostream& operator<<(std::ostream&, const LoadReport&);
@@ -0,0 +1,249 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std::string_literals;
+
+namespace {
+
+void Increase(std::atomic<uint64_t>& value, uint64_t delta) {
+    value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+size_t HistogramIndex(Operation operation, Phase phase) {
+    return static_cast<size_t>(operation) * PHASE_COUNT + static_cast<size_t>(phase);
+}
+
+}
+
+const char* ToString(Operation operation) {
+    switch (operation) {
+    case Operation::FIND_TOP_DOCUMENTS: return "FindTopDocuments";
+    case Operation::MATCH_DOCUMENT: return "MatchDocument";
+    case Operation::ADD_DOCUMENT: return "AddDocument";
+    case Operation::REMOVE_DOCUMENT: return "RemoveDocument";
+    }
+    return "Unknown";
+}
+
+const char* ToString(Phase phase) {
+    switch (phase) {
+    case Phase::TOTAL: return "total";
+    case Phase::PARSE: return "parse";
+    case Phase::SCORE: return "score";
+    case Phase::FILTER: return "filter";
+    case Phase::SORT: return "sort";
+    case Phase::INDEX: return "index";
+    }
+    return "unknown";
+}
+
+const char* ToString(Counter counter) {
+    switch (counter) {
+    case Counter::POSTINGS_VISITED: return "postings_visited";
+    case Counter::DOCUMENTS_SCORED: return "documents_scored";
+    case Counter::POSTINGS_SKIPPED: return "postings_skipped";
+    }
+    return "unknown";
+}
+
+size_t LatencyHistogram::BucketIndex(uint64_t value) {
+    value = std::min(value, (uint64_t{1} << MAX_VALUE_BITS) - 1);
+    if (value < 2 * SUB_BUCKET_COUNT) {
+        return static_cast<size_t>(value);
+    }
+    const int bit_width = 64 - __builtin_clzll(value);
+    const int shift = bit_width - (SUB_BUCKET_BITS + 1);
+    return static_cast<size_t>(shift) * SUB_BUCKET_COUNT + static_cast<size_t>(value >> shift);
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(size_t index) {
+    if (index < 2 * SUB_BUCKET_COUNT) {
+        return index;
+    }
+    const size_t shift = index / SUB_BUCKET_COUNT - 1;
+    const uint64_t mantissa = index - shift * SUB_BUCKET_COUNT;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t value) {
+    Increase(buckets_[BucketIndex(value)], 1);
+    Increase(count_, 1);
+    Increase(sum_, value);
+    if (value > max_.load(std::memory_order_relaxed)) {
+        max_.store(value, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        Increase(buckets_[i], other.buckets_[i].load(std::memory_order_relaxed));
+    }
+    Increase(count_, other.count_.load(std::memory_order_relaxed));
+    Increase(sum_, other.sum_.load(std::memory_order_relaxed));
+    max_.store(std::max(max_.load(std::memory_order_relaxed), other.max_.load(std::memory_order_relaxed)),
+               std::memory_order_relaxed);
+}
+
+void LatencyHistogram::Reset() {
+    for (auto& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetCount() const {
+    return count_.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetMax() const {
+    return max_.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::GetMean() const {
+    const uint64_t count = GetCount();
+    return count == 0 ? 0.0 : static_cast<double>(sum_.load(std::memory_order_relaxed)) / count;
+}
+
+uint64_t LatencyHistogram::ValueAtPercentile(double percentile) const {
+    const uint64_t count = GetCount();
+    if (count == 0) return 0;
+    const uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percentile / 100.0 * count)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= target) {
+            return std::min(BucketUpperBound(i), GetMax());
+        }
+    }
+    return GetMax();
+}
+
+uint64_t MetricsSnapshot::GetCounter(Counter counter) const {
+    return counters[static_cast<size_t>(counter)];
+}
+
+const PhaseLatency* MetricsSnapshot::Find(Operation operation, Phase phase) const {
+    for (const auto& latency : latencies) {
+        if (latency.operation == operation && latency.phase == phase) {
+            return &latency;
+        }
+    }
+    return nullptr;
+}
+
+std::ostream& operator<<(std::ostream& os, const MetricsSnapshot& snapshot) {
+    os << "{\"latencies\": ["s;
+    bool is_first = true;
+    for (const auto& latency : snapshot.latencies) {
+        if (!is_first) os << ", "s;
+        is_first = false;
+        os << "{\"operation\": \""s << ToString(latency.operation)
+           << "\", \"phase\": \""s << ToString(latency.phase)
+           << "\", \"count\": "s << latency.count
+           << ", \"mean_ns\": "s << latency.mean_ns
+           << ", \"p50_ns\": "s << latency.p50_ns
+           << ", \"p90_ns\": "s << latency.p90_ns
+           << ", \"p99_ns\": "s << latency.p99_ns
+           << ", \"max_ns\": "s << latency.max_ns << "}"s;
+    }
+    os << "], \"counters\": {"s;
+    for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+        if (i > 0) os << ", "s;
+        os << "\""s << ToString(static_cast<Counter>(i)) << "\": "s << snapshot.counters[i];
+    }
+    return os << "}}"s;
+}
+
+std::mutex MetricsRegistry::mutex_;
+std::vector<std::unique_ptr<MetricsRegistry::ThreadMetrics>> MetricsRegistry::threads_;
+
+MetricsRegistry::ThreadMetrics& MetricsRegistry::Local() {
+    // Thread slots are never released: pooled threads come and go, and a snapshot
+    // must still see what finished threads have recorded.
+    thread_local ThreadMetrics* local = nullptr;
+    if (local == nullptr) {
+        auto metrics = std::make_unique<ThreadMetrics>();
+        local = metrics.get();
+        std::lock_guard<std::mutex> guard(mutex_);
+        threads_.push_back(std::move(metrics));
+    }
+    return *local;
+}
+
+void MetricsRegistry::RecordLatency(Operation operation, Phase phase, uint64_t nanoseconds) {
+    Local().histograms[HistogramIndex(operation, phase)].Record(nanoseconds);
+}
+
+void MetricsRegistry::Add(Counter counter, uint64_t value) {
+    Increase(Local().counters[static_cast<size_t>(counter)], value);
+}
+
+MetricsSnapshot MetricsRegistry::Snapshot() {
+    std::vector<LatencyHistogram> merged(OPERATION_COUNT * PHASE_COUNT);
+    MetricsSnapshot snapshot;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        for (const auto& thread_metrics : threads_) {
+            for (size_t i = 0; i < merged.size(); ++i) {
+                merged[i].Merge(thread_metrics->histograms[i]);
+            }
+            for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+                snapshot.counters[i] += thread_metrics->counters[i].load(std::memory_order_relaxed);
+            }
+        }
+    }
+    for (size_t i = 0; i < merged.size(); ++i) {
+        const auto& histogram = merged[i];
+        if (histogram.GetCount() == 0) continue;
+        snapshot.latencies.push_back({ static_cast<Operation>(i / PHASE_COUNT), static_cast<Phase>(i % PHASE_COUNT),
+                                       histogram.GetCount(), histogram.GetMean(),
+                                       histogram.ValueAtPercentile(50.0), histogram.ValueAtPercentile(90.0),
+                                       histogram.ValueAtPercentile(99.0), histogram.GetMax() });
+    }
+    return snapshot;
+}
+
+void MetricsRegistry::Reset() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    for (const auto& thread_metrics : threads_) {
+        for (auto& histogram : thread_metrics->histograms) {
+            histogram.Reset();
+        }
+        for (auto& counter : thread_metrics->counters) {
+            counter.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+thread_local OperationTimer* OperationTimer::current_ = nullptr;
+
+OperationTimer::OperationTimer(Operation operation)
+    : operation_(operation)
+    , start_time_(Clock::now())
+    , lap_time_(start_time_)
+    , previous_(current_)
+{
+    current_ = this;
+}
+
+OperationTimer::~OperationTimer() {
+    using namespace std::chrono;
+    MetricsRegistry::RecordLatency(operation_, Phase::TOTAL,
+                                   duration_cast<nanoseconds>(Clock::now() - start_time_).count());
+    current_ = previous_;
+}
+
+void OperationTimer::Lap(Phase phase) {
+    using namespace std::chrono;
+    const auto now = Clock::now();
+    MetricsRegistry::RecordLatency(operation_, phase, duration_cast<nanoseconds>(now - lap_time_).count());
+    lap_time_ = now;
+}
+
+OperationTimer* OperationTimer::Current() {
+    return current_;
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "log_duration.h"
+
+// Instrumentation is compiled in only when SEARCH_SERVER_METRICS is defined,
+// otherwise METRICS_* macros expand to nothing and their arguments are not evaluated.
+
+enum class Operation {
+    FIND_TOP_DOCUMENTS,
+    MATCH_DOCUMENT,
+    ADD_DOCUMENT,
+    REMOVE_DOCUMENT,
+};
+
+enum class Phase {
+    TOTAL,
+    PARSE,
+    SCORE,
+    FILTER,
+    SORT,
+    INDEX,
+};
+
+// DOCUMENTS_SCORED counts the candidates a search evaluates before the
+// predicate filters them: the documents with a plus word in a document-at-a-time
+// search, with every plus word and no minus word in a conjunctive one. A
+// term-at-a-time search applies the predicate while it accumulates, so it
+// counts the documents passing it, including those minus words exclude later.
+enum class Counter {
+    POSTINGS_VISITED,
+    DOCUMENTS_SCORED,
+    POSTINGS_SKIPPED,
+};
+
+constexpr size_t OPERATION_COUNT = 4;
+constexpr size_t PHASE_COUNT = 6;
+constexpr size_t COUNTER_COUNT = 3;
+
+const char* ToString(Operation);
+const char* ToString(Phase);
+const char* ToString(Counter);
+
+// Log-linear histogram of nanosecond latencies: values below 32 are exact, larger
+// values fall into 16 sub-buckets per power of two (relative error below 6.25%).
+// Every histogram has a single writer thread, so Record needs no read-modify-write.
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr uint64_t SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    static constexpr int MAX_VALUE_BITS = 48;
+    static constexpr size_t BUCKET_COUNT = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    void Record(uint64_t);
+    void Merge(const LatencyHistogram&);
+    void Reset();
+    uint64_t GetCount() const;
+    uint64_t GetMax() const;
+    double GetMean() const;
+    uint64_t ValueAtPercentile(double) const;
+
+    static size_t BucketIndex(uint64_t);
+    static uint64_t BucketUpperBound(size_t);
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+struct PhaseLatency {
+    Operation operation;
+    Phase phase;
+    uint64_t count;
+    double mean_ns;
+    uint64_t p50_ns;
+    uint64_t p90_ns;
+    uint64_t p99_ns;
+    uint64_t max_ns;
+};
+
+struct MetricsSnapshot {
+    std::vector<PhaseLatency> latencies;
+    std::array<uint64_t, COUNTER_COUNT> counters{};
+
+    uint64_t GetCounter(Counter) const;
+    const PhaseLatency* Find(Operation, Phase) const;
+};
+
+std::ostream& operator<<(std::ostream&, const MetricsSnapshot&);
+
+class MetricsRegistry {
+public:
+    static void RecordLatency(Operation, Phase, uint64_t);
+    static void Add(Counter, uint64_t);
+    static MetricsSnapshot Snapshot();
+    // Clears the metrics of every thread. Owners update their histograms and
+    // counters with plain load-and-store, so a reset racing with them may be lost
+    // or half applied: call it only while no thread is recording, say between
+    // test cases or benchmark runs.
+    static void Reset();
+
+private:
+    struct ThreadMetrics {
+        std::array<LatencyHistogram, OPERATION_COUNT * PHASE_COUNT> histograms;
+        std::array<std::atomic<uint64_t>, COUNTER_COUNT> counters{};
+    };
+
+    static std::mutex mutex_;
+    static std::vector<std::unique_ptr<ThreadMetrics>> threads_;
+
+    static ThreadMetrics& Local();
+};
+
+// Measures one operation; Lap() closes the current phase and starts the next one.
+// The innermost active timer of a thread is reachable through Current(), so helpers
+// called by the operation can close their own phases.
+class OperationTimer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit OperationTimer(Operation);
+    OperationTimer(const OperationTimer&) = delete;
+    OperationTimer& operator=(const OperationTimer&) = delete;
+    ~OperationTimer();
+
+    void Lap(Phase);
+    static OperationTimer* Current();
+
+private:
+    const Operation operation_;
+    const Clock::time_point start_time_;
+    Clock::time_point lap_time_;
+    OperationTimer* const previous_;
+    static thread_local OperationTimer* current_;
+};
+
+#ifdef SEARCH_SERVER_METRICS
+#define METRICS_OPERATION(operation) OperationTimer PROFILE_CONCAT(metricsTimer, __LINE__)(operation)
+#define METRICS_LAP(phase) \
+    do { if (OperationTimer* metrics_timer = OperationTimer::Current()) metrics_timer->Lap(phase); } while (false)
+#define METRICS_COUNT(counter, value) MetricsRegistry::Add((counter), (value))
+#else
+#define METRICS_OPERATION(operation) ((void)0)
+#define METRICS_LAP(phase) ((void)0)
+#define METRICS_COUNT(counter, value) ((void)0)
+#endif
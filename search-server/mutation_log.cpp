@@ -0,0 +1,300 @@
+#include "mutation_log.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <execution>
+#include <optional>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ipc_protocol.h"
+
+namespace {
+
+const size_t RECORD_HEADER_SIZE = 8;
+
+uint32_t ComputeCrc32c(std::string_view data) {
+    static const auto TABLE = []() {
+        std::array<uint32_t, 256> table{};
+        for (uint32_t i = 0; i < table.size(); ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 1) ? (crc >> 1) ^ 0x82f63b78u : crc >> 1;
+            }
+            table[i] = crc;
+        }
+        return table;
+    }();
+    uint32_t crc = ~0u;
+    for (const unsigned char c : data) {
+        crc = TABLE[(crc ^ c) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// Returns an error message, empty on success.
+std::string WriteAndSync(int fd, std::string_view data) {
+    using namespace std::string_literals;
+    while (!data.empty()) {
+        const ssize_t count = ::write(fd, data.data(), data.size());
+        if (count >= 0) {
+            data.remove_prefix(static_cast<size_t>(count));
+        }
+        else if (errno != EINTR) {
+            return "Mutation log write failed: "s + std::strerror(errno);
+        }
+    }
+    if (::fdatasync(fd) < 0) {
+        return "Mutation log sync failed: "s + std::strerror(errno);
+    }
+    return {};
+}
+
+struct AddRecord {
+    int document_id;
+    DocumentStatus status;
+    std::vector<int> ratings;
+    std::string_view text;
+};
+
+// Additions are collected until a removal or the end of the log, since a removal
+// may refer to any document added before it.
+class Replayer {
+public:
+    Replayer(SearchServer& search_server, RecoveryStats& stats)
+        : search_server_(search_server)
+        , stats_(stats) {
+    }
+
+    void Add(AddRecord record) {
+        const size_t MAX_BATCH_SIZE = 4096;
+        additions_.push_back(std::move(record));
+        if (additions_.size() >= MAX_BATCH_SIZE) {
+            Flush();
+        }
+    }
+
+    void Remove(int document_id) {
+        Flush();
+        try {
+            search_server_.RemoveDocument(document_id);
+        }
+        catch (const std::out_of_range&) {
+            ++stats_.rejected_count;
+        }
+    }
+
+    void Flush() {
+        std::vector<std::optional<PreparedDocument>> prepared(additions_.size());
+        std::transform(std::execution::par, additions_.begin(), additions_.end(), prepared.begin(),
+                       [this](const AddRecord& record) -> std::optional<PreparedDocument> {
+                           try {
+                               return search_server_.PrepareDocument(record.document_id, record.text, record.status, record.ratings);
+                           }
+                           catch (const std::invalid_argument&) {
+                               return std::nullopt;
+                           }
+                       });
+        for (const auto& document : prepared) {
+            try {
+                if (!document) {
+                    throw std::invalid_argument("Invalid document");
+                }
+                search_server_.AddPreparedDocument(*document);
+            }
+            catch (const std::invalid_argument&) {
+                ++stats_.rejected_count;
+            }
+        }
+        additions_.clear();
+    }
+
+private:
+    SearchServer& search_server_;
+    RecoveryStats& stats_;
+    std::vector<AddRecord> additions_;
+};
+
+// Returns false if the payload is not a valid record.
+bool ReplayRecord(std::string_view payload, Replayer& replayer) {
+    Decoder decoder(payload);
+    try {
+        const auto opcode = static_cast<Opcode>(decoder.GetU8());
+        const int document_id = decoder.GetI32();
+        if (opcode == Opcode::REMOVE_DOCUMENT && decoder.IsEmpty()) {
+            replayer.Remove(document_id);
+            return true;
+        }
+        if (opcode != Opcode::ADD_DOCUMENT) {
+            return false;
+        }
+        AddRecord record{ document_id, static_cast<DocumentStatus>(decoder.GetU8()), {}, {} };
+        const uint32_t rating_count = decoder.GetU32();
+        if (rating_count > payload.size() / sizeof(int32_t)) {
+            return false;
+        }
+        record.ratings.reserve(rating_count);
+        for (uint32_t i = 0; i < rating_count; ++i) {
+            record.ratings.push_back(decoder.GetI32());
+        }
+        record.text = decoder.GetString();
+        if (!decoder.IsEmpty()) {
+            return false;
+        }
+        replayer.Add(std::move(record));
+        return true;
+    }
+    catch (const std::invalid_argument&) {
+        return false;
+    }
+}
+
+}
+
+MutationLog::MutationLog(const std::string& path)
+    : fd_(::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644)) {
+    using namespace std::string_literals;
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot open mutation log "s + path + ": "s + std::strerror(errno));
+    }
+}
+
+MutationLog::~MutationLog() {
+    ::close(fd_);
+}
+
+void MutationLog::LogAddDocument(int document_id, std::string_view document, DocumentStatus status,
+                                 const std::vector<int>& ratings) {
+    Encoder encoder;
+    encoder.PutU8(static_cast<uint8_t>(Opcode::ADD_DOCUMENT));
+    encoder.PutI32(document_id);
+    encoder.PutU8(static_cast<uint8_t>(status));
+    encoder.PutU32(static_cast<uint32_t>(ratings.size()));
+    for (const int rating : ratings) {
+        encoder.PutI32(rating);
+    }
+    encoder.PutString(document);
+    MutationLog::Append(encoder.GetBuffer());
+}
+
+void MutationLog::LogRemoveDocument(int document_id) {
+    Encoder encoder;
+    encoder.PutU8(static_cast<uint8_t>(Opcode::REMOVE_DOCUMENT));
+    encoder.PutI32(document_id);
+    MutationLog::Append(encoder.GetBuffer());
+}
+
+MutationLogStats MutationLog::GetStats() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return stats_;
+}
+
+// The first writer to find no sync in progress becomes the leader: it takes
+// everything appended so far, writes and syncs it without holding the lock,
+// and wakes the writers whose records it made durable.
+void MutationLog::Append(std::string_view payload) {
+    const uint32_t header[] = { static_cast<uint32_t>(payload.size()), ComputeCrc32c(payload) };
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!error_.empty()) {
+        throw std::runtime_error(error_);
+    }
+    pending_.append(reinterpret_cast<const char*>(header), RECORD_HEADER_SIZE);
+    pending_.append(payload.data(), payload.size());
+    const uint64_t sequence = ++appended_count_;
+    ++stats_.record_count;
+    stats_.byte_count += RECORD_HEADER_SIZE + payload.size();
+    while (durable_count_ < sequence) {
+        if (!error_.empty()) {
+            throw std::runtime_error(error_);
+        }
+        if (is_syncing_) {
+            synced_.wait(lock);
+            continue;
+        }
+        is_syncing_ = true;
+        std::string batch;
+        batch.swap(pending_);
+        const uint64_t batch_end = appended_count_;
+        lock.unlock();
+        const std::string error = WriteAndSync(fd_, batch);
+        lock.lock();
+        is_syncing_ = false;
+        if (error.empty()) {
+            durable_count_ = batch_end;
+            ++stats_.sync_count;
+        }
+        else {
+            error_ = error;
+        }
+        synced_.notify_all();
+    }
+}
+
+RecoveryStats MutationLog::Recover(SearchServer& search_server, const std::string& path) {
+    using namespace std::string_literals;
+    RecoveryStats stats;
+    const int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            return stats;
+        }
+        throw std::runtime_error("Cannot open mutation log "s + path + ": "s + std::strerror(errno));
+    }
+    struct stat file_stat {};
+    if (::fstat(fd, &file_stat) < 0) {
+        const int error = errno;
+        ::close(fd);
+        throw std::runtime_error("Cannot stat mutation log "s + path + ": "s + std::strerror(error));
+    }
+    const size_t size = static_cast<size_t>(file_stat.st_size);
+    void* mapping = size > 0 ? ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+    if (mapping == MAP_FAILED) {
+        const int error = errno;
+        ::close(fd);
+        throw std::runtime_error("Cannot map mutation log "s + path + ": "s + std::strerror(error));
+    }
+    const std::string_view log(static_cast<const char*>(mapping), size);
+    size_t offset = 0;
+    try {
+        Replayer replayer(search_server, stats);
+        while (log.size() - offset >= RECORD_HEADER_SIZE) {
+            uint32_t header[2];
+            std::memcpy(header, log.data() + offset, RECORD_HEADER_SIZE);
+            if (header[0] > log.size() - offset - RECORD_HEADER_SIZE) {
+                break;
+            }
+            const auto payload = log.substr(offset + RECORD_HEADER_SIZE, header[0]);
+            if (ComputeCrc32c(payload) != header[1] || !ReplayRecord(payload, replayer)) {
+                break;
+            }
+            offset += RECORD_HEADER_SIZE + payload.size();
+            ++stats.record_count;
+        }
+        replayer.Flush();
+    }
+    catch (...) {
+        if (mapping) {
+            ::munmap(mapping, size);
+        }
+        ::close(fd);
+        throw;
+    }
+    if (mapping) {
+        ::munmap(mapping, size);
+    }
+    stats.valid_byte_count = offset;
+    stats.truncated_byte_count = size - offset;
+    if (offset < size && (::ftruncate(fd, static_cast<off_t>(offset)) < 0 || ::fsync(fd) < 0)) {
+        const int error = errno;
+        ::close(fd);
+        throw std::runtime_error("Cannot truncate mutation log "s + path + ": "s + std::strerror(error));
+    }
+    ::close(fd);
+    return stats;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+struct MutationLogStats {
+    uint64_t record_count = 0;
+    uint64_t byte_count = 0;
+    uint64_t sync_count = 0;
+};
+
+struct RecoveryStats {
+    uint64_t record_count = 0;
+    uint64_t rejected_count = 0;
+    uint64_t valid_byte_count = 0;
+    uint64_t truncated_byte_count = 0;
+};
+
+// Append-only write-ahead log of AddDocument and RemoveDocument calls. A record is
+//     uint32 payload size | uint32 CRC-32C of the payload | payload
+// in host byte order, with the payload encoded as in ipc_protocol.h:
+//     uint8 Opcode | int32 id [ | uint8 status | uint32 count | int32 ratings... | string text ]
+// Log a mutation before applying it. A Log call returns once the record is on
+// disk; records of concurrent callers are written and synced together (group
+// commit), so the number of fsyncs grows with the number of commit rounds, not
+// with the number of writers. Mutations of the same document must not race.
+class MutationLog {
+public:
+    explicit MutationLog(const std::string&);
+    MutationLog(const MutationLog&) = delete;
+    MutationLog& operator=(const MutationLog&) = delete;
+    ~MutationLog();
+
+    void LogAddDocument(int, std::string_view, DocumentStatus, const std::vector<int>&);
+    void LogRemoveDocument(int);
+    MutationLogStats GetStats() const;
+
+    // Replays the log at the path into the server: runs of additions are tokenized
+    // in parallel and indexed through AddPreparedDocument. Mutations the server
+    // rejects are skipped, as the original calls failed too. The log is cut at the
+    // first record that is incomplete or fails its checksum, so a torn tail left by
+    // a crash is dropped. A missing log is an empty one.
+    static RecoveryStats Recover(SearchServer&, const std::string&);
+
+private:
+    int fd_;
+    mutable std::mutex mutex_;
+    std::condition_variable synced_;
+    std::string pending_;
+    uint64_t appended_count_ = 0;
+    uint64_t durable_count_ = 0;
+    bool is_syncing_ = false;
+    std::string error_;
+    MutationLogStats stats_;
+
+    void Append(std::string_view);
+};
@@ -4,6 +4,7 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <stdexcept>
 
 template <typename Iterator>
 class IteratorRange {
@@ -35,31 +36,86 @@ private:
 template <typename Iterator>
 class Paginator {
 public:
+    class PageIterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = IteratorRange<Iterator>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = value_type;
+
+        PageIterator(Iterator page_begin, size_t left, size_t page_size)
+            : page_begin_(page_begin)
+            , left_(left)
+            , page_size_(page_size) {
+        }
+
+        IteratorRange<Iterator> operator*() const {
+            return { page_begin_, std::next(page_begin_, std::min(page_size_, left_)) };
+        }
+
+        PageIterator& operator++() {
+            const size_t current_page_size = std::min(page_size_, left_);
+            page_begin_ = std::next(page_begin_, current_page_size);
+            left_ -= current_page_size;
+            return *this;
+        }
+
+        PageIterator operator++(int) {
+            PageIterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const PageIterator& other) const {
+            return left_ == other.left_;
+        }
+
+        bool operator!=(const PageIterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        Iterator page_begin_;
+        size_t left_;
+        size_t page_size_;
+    };
+
     Paginator() = default;
 
-    Paginator(Iterator begin, Iterator end, size_t page_size) {
-        for (size_t left = std::distance(begin, end); left > 0;) {
-            const size_t current_page_size = std::min(page_size, left);
-            const Iterator current_page_end = std::next(begin, current_page_size);
-            paginator_.push_back({ begin, current_page_end });
-            left -= current_page_size;
-            begin = current_page_end;
+    Paginator(Iterator begin, Iterator end, size_t page_size)
+        : begin_(begin)
+        , end_(end)
+        , page_size_(page_size)
+        , item_count_(std::distance(begin, end)) {
+        if (page_size_ == 0) {
+            throw std::invalid_argument("Page size must be positive");
         }
     }
 
-    auto begin() const {
-        return paginator_.begin();
+    PageIterator begin() const {
+        return { begin_, item_count_, page_size_ };
     }
 
-    auto end() const {
-        return paginator_.end();
+    PageIterator end() const {
+        return { end_, 0, page_size_ };
     }
 
-    auto size() const {
-        return paginator_.size();
+    size_t size() const {
+        return (item_count_ + page_size_ - 1) / page_size_;
     }
+
+    IteratorRange<Iterator> operator[](size_t page) const {
+        const size_t page_start = std::min(page * page_size_, item_count_);
+        const Iterator page_begin = std::next(begin_, page_start);
+        return { page_begin, std::next(page_begin, std::min(page_size_, item_count_ - page_start)) };
+    }
+
 private:
-    std::vector<IteratorRange<Iterator>> paginator_;
+    Iterator begin_;
+    Iterator end_;
+    size_t page_size_ = 1;
+    size_t item_count_ = 0;
 };
 
 template <typename Iterator>
@@ -73,4 +129,4 @@ std::ostream& operator<<(std::ostream& output, const IteratorRange<Iterator>& it
 template <typename Container>
 auto Paginate(const Container& c, size_t page_size) {
     return Paginator(std::begin(c), std::end(c), page_size);
-}
\ No newline at end of file
+}
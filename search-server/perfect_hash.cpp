@@ -0,0 +1,102 @@
+#include "perfect_hash.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+PerfectHash::PerfectHash(const std::pmr::vector<std::string_view>& keys, std::pmr::memory_resource* resource)
+    : displacements_(resource)
+    , key_count_(keys.size()) {
+    if (keys.size() >= DIRECT_SLOT) {
+        throw std::length_error("Too many keys for a perfect hash");
+    }
+    if (keys.empty()) {
+        return;
+    }
+    const size_t bucket_count = keys.size() / 3 + 1;
+    displacements_.assign(bucket_count, 0);
+    std::vector<uint64_t> hashes(keys.size());
+    std::vector<std::vector<uint32_t>> buckets(bucket_count);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        hashes[i] = HashKey(keys[i]);
+        buckets[Mix(hashes[i]) % bucket_count].push_back(static_cast<uint32_t>(i));
+    }
+    std::vector<uint32_t> bucket_order(bucket_count);
+    std::iota(bucket_order.begin(), bucket_order.end(), 0);
+    std::stable_sort(bucket_order.begin(), bucket_order.end(),
+                     [&buckets](uint32_t lhs, uint32_t rhs) { return buckets[lhs].size() > buckets[rhs].size(); });
+
+    std::vector<bool> is_taken(keys.size(), false);
+    std::vector<size_t> slots;
+    size_t free_slot = 0;
+    for (const uint32_t bucket : bucket_order) {
+        const auto& bucket_keys = buckets[bucket];
+        if (bucket_keys.empty()) {
+            break;
+        }
+        if (bucket_keys.size() == 1) {
+            while (is_taken[free_slot]) {
+                ++free_slot;
+            }
+            is_taken[free_slot] = true;
+            displacements_[bucket] = DIRECT_SLOT | static_cast<uint32_t>(free_slot);
+            continue;
+        }
+        for (uint32_t displacement = 1;; ++displacement) {
+            if (displacement == DIRECT_SLOT) {
+                throw std::invalid_argument("Perfect hash keys must be distinct");
+            }
+            slots.clear();
+            for (const uint32_t key : bucket_keys) {
+                const size_t slot = PerfectHash::GetSlot(hashes[key], displacement);
+                if (is_taken[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+                    break;
+                }
+                slots.push_back(slot);
+            }
+            if (slots.size() == bucket_keys.size()) {
+                for (const size_t slot : slots) {
+                    is_taken[slot] = true;
+                }
+                displacements_[bucket] = displacement;
+                break;
+            }
+        }
+    }
+}
+
+size_t PerfectHash::operator()(std::string_view key) const {
+    if (key_count_ == 0) {
+        return 0;
+    }
+    const uint64_t hash = HashKey(key);
+    const uint32_t displacement = displacements_[Mix(hash) % displacements_.size()];
+    if (displacement & DIRECT_SLOT) {
+        return displacement & ~DIRECT_SLOT;
+    }
+    return PerfectHash::GetSlot(hash, displacement);
+}
+
+size_t PerfectHash::GetSize() const {
+    return key_count_;
+}
+
+// FNV-1a
+uint64_t PerfectHash::HashKey(std::string_view key) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const char c : key) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// splitmix64 finalizer
+uint64_t PerfectHash::Mix(uint64_t value) {
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+    return value ^ (value >> 31);
+}
+
+size_t PerfectHash::GetSlot(uint64_t hash, uint32_t displacement) const {
+    return PerfectHash::Mix(hash + displacement * 0x9e3779b97f4a7c15ull) % key_count_;
+}
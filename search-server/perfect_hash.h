@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+// Minimal perfect hash of a fixed set of distinct keys (hash and displace):
+// maps the n keys onto [0, n) without collisions. Any other key is mapped to
+// some slot too, so the caller must compare the key stored in the slot.
+class PerfectHash {
+public:
+    PerfectHash() = default;
+    PerfectHash(const std::pmr::vector<std::string_view>&, std::pmr::memory_resource*);
+
+    size_t operator()(std::string_view) const;
+    size_t GetSize() const;
+
+private:
+    // A displacement with this bit set stores the slot of a single-key bucket.
+    static constexpr uint32_t DIRECT_SLOT = 1u << 31;
+
+    std::pmr::vector<uint32_t> displacements_;
+    size_t key_count_ = 0;
+
+    static uint64_t HashKey(std::string_view);
+    static uint64_t Mix(uint64_t);
+    size_t GetSlot(uint64_t, uint32_t) const;
+};
@@ -0,0 +1,30 @@
+#include "query_plan.h"
+
+#include <string>
+
+std::ostream& operator<<(std::ostream& os, QueryStrategy strategy) {
+    switch (strategy) {
+    case QueryStrategy::EMPTY:
+        return os << "EMPTY";
+    case QueryStrategy::TERM_AT_A_TIME:
+        return os << "TERM_AT_A_TIME";
+    case QueryStrategy::DOCUMENT_AT_A_TIME:
+        return os << "DOCUMENT_AT_A_TIME";
+    case QueryStrategy::CONJUNCTIVE:
+        return os << "CONJUNCTIVE";
+    }
+    return os;
+}
+
+std::ostream& operator<<(std::ostream& os, const QueryPlan& plan) {
+    using namespace std::string_literals;
+    os << "{ strategy = "s << plan.strategy << ", postings = "s << plan.posting_count
+       << ", skipped_postings = "s << plan.skipped_posting_count
+       << ", taat_cost = "s << plan.term_at_a_time_cost << ", daat_cost = "s << plan.document_at_a_time_cost
+       << ", terms = [ "s;
+    for (const auto& term : plan.terms) {
+        os << (term.is_minus ? "-"s : ""s) << term.word << ":"s << term.document_count
+           << (term.is_ignored ? "(ignored)"s : ""s) << " "s;
+    }
+    return os << "] }"s;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+enum class QueryStrategy {
+    EMPTY,
+    TERM_AT_A_TIME,
+    DOCUMENT_AT_A_TIME,
+    CONJUNCTIVE,
+};
+
+struct PlannedTerm {
+    std::string_view word;
+    size_t document_count = 0;
+    bool is_minus = false;
+    // A plus word too common to be scored, see SearchServer::SetCommonWordRatio.
+    bool is_ignored = false;
+};
+
+// How SearchServer evaluates a query. Terms are listed in the order they are
+// applied to a candidate document: minus words from the most to the least
+// frequent, then plus words from the rarest. Costs are in posting visits and
+// are the ones of an ANY query; a CONJUNCTIVE plan visits the postings of the
+// rarest word and probes the others. Ignored common words come last, their
+// postings are counted in skipped_posting_count only.
+struct QueryPlan {
+    QueryStrategy strategy = QueryStrategy::EMPTY;
+    std::vector<PlannedTerm> terms;
+    size_t posting_count = 0;
+    size_t skipped_posting_count = 0;
+    double term_at_a_time_cost = 0.0;
+    double document_at_a_time_cost = 0.0;
+};
+
+std::ostream& operator<<(std::ostream&, QueryStrategy);
+std::ostream& operator<<(std::ostream&, const QueryPlan&);
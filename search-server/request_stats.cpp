@@ -0,0 +1,128 @@
+#include "request_stats.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace {
+
+constexpr int64_t RESETTING_PERIOD = -2;
+
+void Increase(std::atomic<uint64_t>& value) {
+    value.fetch_add(1, std::memory_order_relaxed);
+}
+
+}
+
+double RequestSummary::GetEmptyResultRate() const {
+    return requests == 0 ? 0.0 : static_cast<double>(empty_results) / requests;
+}
+
+uint64_t RequestSummary::GetStatusCount(QueryStatus status) const {
+    return statuses[static_cast<size_t>(status)];
+}
+
+void RequestStats::Bucket::Reset() {
+    requests.store(0, std::memory_order_relaxed);
+    empty_results.store(0, std::memory_order_relaxed);
+    for (auto& count : result_counts) {
+        count.store(0, std::memory_order_relaxed);
+    }
+    for (auto& count : statuses) {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+void RequestStats::Bucket::Add(size_t result_count, QueryStatus status) {
+    Increase(requests);
+    if (result_count == 0) {
+        Increase(empty_results);
+    }
+    Increase(result_counts[std::min(result_count, RESULT_COUNT_BUCKETS - 1)]);
+    Increase(statuses[static_cast<size_t>(status)]);
+}
+
+void RequestStats::Bucket::AddTo(RequestSummary& summary) const {
+    summary.requests += requests.load(std::memory_order_relaxed);
+    summary.empty_results += empty_results.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < RESULT_COUNT_BUCKETS; ++i) {
+        summary.result_counts[i] += result_counts[i].load(std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < QUERY_STATUS_COUNT; ++i) {
+        summary.statuses[i] += statuses[i].load(std::memory_order_relaxed);
+    }
+}
+
+template <size_t BUCKET_COUNT>
+RequestStats::SlidingWindow<BUCKET_COUNT>::SlidingWindow(Clock::duration bucket_width)
+    : bucket_width_(bucket_width)
+{
+}
+
+template <size_t BUCKET_COUNT>
+int64_t RequestStats::SlidingWindow<BUCKET_COUNT>::GetPeriod(Clock::time_point time) const {
+    return time.time_since_epoch() / bucket_width_;
+}
+
+template <size_t BUCKET_COUNT>
+void RequestStats::SlidingWindow<BUCKET_COUNT>::Record(size_t result_count, QueryStatus status, Clock::time_point time) {
+    const int64_t period = GetPeriod(time);
+    Bucket& bucket = buckets_[period % BUCKET_COUNT];
+    int64_t bucket_period = bucket.period.load(std::memory_order_acquire);
+    while (bucket_period != period) {
+        if (bucket_period > period) {
+            return;
+        }
+        if (bucket_period == RESETTING_PERIOD) {
+            std::this_thread::yield();
+        }
+        else if (bucket.period.compare_exchange_weak(bucket_period, RESETTING_PERIOD, std::memory_order_acquire)) {
+            bucket.Reset();
+            bucket.period.store(period, std::memory_order_release);
+            break;
+        }
+        bucket_period = bucket.period.load(std::memory_order_acquire);
+    }
+    bucket.Add(result_count, status);
+}
+
+template <size_t BUCKET_COUNT>
+RequestSummary RequestStats::SlidingWindow<BUCKET_COUNT>::Summarize(Clock::time_point time) const {
+    const int64_t period = GetPeriod(time);
+    RequestSummary summary;
+    for (const Bucket& bucket : buckets_) {
+        const int64_t bucket_period = bucket.period.load(std::memory_order_acquire);
+        if (bucket_period >= 0 && bucket_period <= period && period - bucket_period < static_cast<int64_t>(BUCKET_COUNT)) {
+            bucket.AddTo(summary);
+        }
+    }
+    return summary;
+}
+
+RequestStats::RequestStats()
+    : last_second_(std::chrono::milliseconds(100))
+    , last_minute_(std::chrono::seconds(1))
+    , last_day_(std::chrono::minutes(1))
+{
+}
+
+void RequestStats::Record(size_t result_count, QueryStatus status, Clock::time_point time) {
+    last_second_.Record(result_count, status, time);
+    last_minute_.Record(result_count, status, time);
+    last_day_.Record(result_count, status, time);
+    total_.Add(result_count, status);
+}
+
+RequestSummary RequestStats::GetSummary(Window window, Clock::time_point time) const {
+    switch (window) {
+    case Window::SECOND: return last_second_.Summarize(time);
+    case Window::MINUTE: return last_minute_.Summarize(time);
+    case Window::DAY: return last_day_.Summarize(time);
+    }
+    return {};
+}
+
+RequestSummary RequestStats::GetTotal() const {
+    RequestSummary summary;
+    total_.AddTo(summary);
+    return summary;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "async_search_server.h"
+#include "document.h"
+#include "search_server.h"
+
+constexpr size_t QUERY_STATUS_COUNT = 4;
+constexpr size_t RESULT_COUNT_BUCKETS = 7;
+
+struct RequestSummary {
+    uint64_t requests = 0;
+    uint64_t empty_results = 0;
+    std::array<uint64_t, RESULT_COUNT_BUCKETS> result_counts{};
+    std::array<uint64_t, QUERY_STATUS_COUNT> statuses{};
+
+    double GetEmptyResultRate() const;
+    uint64_t GetStatusCount(QueryStatus) const;
+};
+
+// Thread-safe request statistics over wall-clock sliding windows. Each window is a
+// ring of fixed buckets updated with relaxed atomics, so Record is O(1), lock-free
+// and never allocates. A bucket is recycled by the first writer of a new period;
+// writers racing with the recycling may lose a few increments at the boundary.
+// Result counts are bucketed as 0, 1, ..., 5 and "more than 5".
+class RequestStats {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Window {
+        SECOND,
+        MINUTE,
+        DAY,
+    };
+
+    RequestStats();
+
+    void Record(size_t, QueryStatus = QueryStatus::OK, Clock::time_point = Clock::now());
+    RequestSummary GetSummary(Window, Clock::time_point = Clock::now()) const;
+    RequestSummary GetTotal() const;
+
+    template <typename... Args>
+    std::vector<Document> AddFindRequest(const SearchServer&, Args&&...);
+
+private:
+    struct Bucket {
+        std::atomic<int64_t> period{-1};
+        std::atomic<uint64_t> requests{0};
+        std::atomic<uint64_t> empty_results{0};
+        std::array<std::atomic<uint64_t>, RESULT_COUNT_BUCKETS> result_counts{};
+        std::array<std::atomic<uint64_t>, QUERY_STATUS_COUNT> statuses{};
+
+        void Reset();
+        void Add(size_t, QueryStatus);
+        void AddTo(RequestSummary&) const;
+    };
+
+    template <size_t BUCKET_COUNT>
+    class SlidingWindow {
+    public:
+        explicit SlidingWindow(Clock::duration);
+        void Record(size_t, QueryStatus, Clock::time_point);
+        RequestSummary Summarize(Clock::time_point) const;
+
+    private:
+        const Clock::duration bucket_width_;
+        std::array<Bucket, BUCKET_COUNT> buckets_;
+
+        int64_t GetPeriod(Clock::time_point) const;
+    };
+
+    SlidingWindow<10> last_second_;
+    SlidingWindow<60> last_minute_;
+    SlidingWindow<1440> last_day_;
+    Bucket total_;
+};
+
+template <typename... Args>
+std::vector<Document> RequestStats::AddFindRequest(const SearchServer& search_server, Args&&... args) {
+    try {
+        auto result = search_server.FindTopDocuments(std::forward<Args>(args)...);
+        Record(result.size(), QueryStatus::OK);
+        return result;
+    }
+    catch (...) {
+        Record(0, QueryStatus::FAILED);
+        throw;
+    }
+}
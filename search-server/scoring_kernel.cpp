@@ -0,0 +1,73 @@
+#include "scoring_kernel.h"
+
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SEARCH_SERVER_HAS_AVX2_KERNEL
+#include <immintrin.h>
+#endif
+
+namespace {
+
+void AccumulateRelevanceScalar(const uint32_t* documents, const double* term_freqs, const uint8_t* mask,
+                               uint32_t count, double inverse_document_freq, double* relevances, uint8_t* matched) {
+    for (uint32_t i = 0; i < count; ++i) {
+        if (mask[i]) {
+            const uint32_t document = documents[i];
+            relevances[document] += term_freqs[i] * inverse_document_freq;
+            matched[document] = 1;
+        }
+    }
+}
+
+#ifdef SEARCH_SERVER_HAS_AVX2_KERNEL
+// Lanes that fail the predicate add +0.0, which leaves a relevance unchanged,
+// so the loop has no branch on the mask.
+__attribute__((target("avx2")))
+void AccumulateRelevanceAvx2(const uint32_t* documents, const double* term_freqs, const uint8_t* mask,
+                             uint32_t count, double inverse_document_freq, double* relevances, uint8_t* matched) {
+    const __m256d inverse_document_freqs = _mm256_set1_pd(inverse_document_freq);
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        uint32_t mask_bytes;
+        std::memcpy(&mask_bytes, mask + i, sizeof(mask_bytes));
+        const __m256i lane_bytes = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(static_cast<int>(mask_bytes)));
+        const __m256d lane_mask = _mm256_castsi256_pd(_mm256_cmpgt_epi64(lane_bytes, _mm256_setzero_si256()));
+        const __m256d products = _mm256_and_pd(_mm256_mul_pd(_mm256_loadu_pd(term_freqs + i), inverse_document_freqs),
+                                               lane_mask);
+        const __m128d low = _mm256_castpd256_pd128(products);
+        const __m128d high = _mm256_extractf128_pd(products, 1);
+        relevances[documents[i]] += _mm_cvtsd_f64(low);
+        relevances[documents[i + 1]] += _mm_cvtsd_f64(_mm_unpackhi_pd(low, low));
+        relevances[documents[i + 2]] += _mm_cvtsd_f64(high);
+        relevances[documents[i + 3]] += _mm_cvtsd_f64(_mm_unpackhi_pd(high, high));
+        for (uint32_t lane = 0; lane < 4; ++lane) {
+            matched[documents[i + lane]] |= mask[i + lane];
+        }
+    }
+    AccumulateRelevanceScalar(documents + i, term_freqs + i, mask + i, count - i, inverse_document_freq, relevances,
+                              matched);
+}
+#endif
+
+}
+
+ScoringKernel GetScoringKernel() {
+#ifdef SEARCH_SERVER_HAS_AVX2_KERNEL
+    static const ScoringKernel kernel = __builtin_cpu_supports("avx2") ? ScoringKernel::AVX2 : ScoringKernel::SCALAR;
+    return kernel;
+#else
+    return ScoringKernel::SCALAR;
+#endif
+}
+
+void AccumulateRelevance(ScoringKernel kernel, const uint32_t* documents, const double* term_freqs, const uint8_t* mask,
+                         uint32_t count, double inverse_document_freq, double* relevances, uint8_t* matched) {
+#ifdef SEARCH_SERVER_HAS_AVX2_KERNEL
+    if (kernel == ScoringKernel::AVX2) {
+        AccumulateRelevanceAvx2(documents, term_freqs, mask, count, inverse_document_freq, relevances, matched);
+        return;
+    }
+#endif
+    AccumulateRelevanceScalar(documents, term_freqs, mask, count, inverse_document_freq, relevances, matched);
+}
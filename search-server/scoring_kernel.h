@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+enum class ScoringKernel {
+    SCALAR,
+    AVX2,
+};
+
+// AVX2 if the build targets x86 and the processor has it, SCALAR otherwise.
+// Detected once.
+ScoringKernel GetScoringKernel();
+
+// For every posting i with mask[i] set to 1 adds term_freqs[i] * inverse_document_freq
+// to relevances[documents[i]] and sets matched[documents[i]] to 1; mask values
+// are 0 or 1 and the documents are distinct. The AVX2 kernel multiplies and
+// masks four postings at once instead of branching on the mask, but every
+// kernel rounds the product before adding it, so all of them sum exactly as the
+// plain loop does. The kernel must be SCALAR or the one GetScoringKernel returns.
+void AccumulateRelevance(ScoringKernel, const uint32_t*, const double*, const uint8_t*, uint32_t, double, double*,
+                         uint8_t*);
@@ -0,0 +1,66 @@
+#include "scratch_arena.h"
+
+#include <algorithm>
+
+ScratchArena::ScratchArena(size_t initial_size) {
+    blocks_.push_back({ std::make_unique<std::byte[]>(initial_size), initial_size });
+}
+
+void ScratchArena::Reset() {
+    block_index_ = 0;
+    offset_ = 0;
+}
+
+size_t ScratchArena::GetCapacity() const {
+    size_t capacity = 0;
+    for (const auto& block : blocks_) {
+        capacity += block.size;
+    }
+    return capacity;
+}
+
+ScratchArena& ScratchArena::ForCurrentThread() {
+    static thread_local ScratchArena arena;
+    return arena;
+}
+
+void* ScratchArena::do_allocate(size_t bytes, size_t alignment) {
+    for (; block_index_ < blocks_.size(); ++block_index_, offset_ = 0) {
+        auto& block = blocks_[block_index_];
+        void* pointer = block.data.get() + offset_;
+        size_t space = block.size - offset_;
+        if (std::align(alignment, bytes, pointer, space)) {
+            offset_ = static_cast<std::byte*>(pointer) - block.data.get() + bytes;
+            return pointer;
+        }
+    }
+    const size_t size = std::max(blocks_.back().size * 2, bytes + alignment);
+    blocks_.push_back({ std::make_unique<std::byte[]>(size), size });
+    block_index_ = blocks_.size() - 1;
+    offset_ = 0;
+    return ScratchArena::do_allocate(bytes, alignment);
+}
+
+void ScratchArena::do_deallocate(void*, size_t, size_t) {
+}
+
+bool ScratchArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+thread_local size_t ScratchScope::depth_ = 0;
+
+ScratchScope::ScratchScope()
+    : arena_(ScratchArena::ForCurrentThread()) {
+    ++depth_;
+}
+
+ScratchScope::~ScratchScope() {
+    if (--depth_ == 0) {
+        arena_.Reset();
+    }
+}
+
+std::pmr::memory_resource* ScratchScope::GetResource() const {
+    return &arena_;
+}
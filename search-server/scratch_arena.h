@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+// Bump allocator for the temporary data of one request. Deallocation is a no-op;
+// Reset rewinds to the first block but keeps all blocks, so once the arena has
+// grown to fit the largest request it never calls the upstream allocator again.
+// An arena is used by one thread only.
+class ScratchArena : public std::pmr::memory_resource {
+public:
+    explicit ScratchArena(size_t = 64 * 1024);
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+
+    void Reset();
+    size_t GetCapacity() const;
+
+    static ScratchArena& ForCurrentThread();
+
+private:
+    struct Block {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+    };
+    std::vector<Block> blocks_;
+    size_t block_index_ = 0;
+    size_t offset_ = 0;
+
+    void* do_allocate(size_t, size_t) override;
+    void do_deallocate(void*, size_t, size_t) override;
+    bool do_is_equal(const std::pmr::memory_resource&) const noexcept override;
+};
+
+// Marks the lifetime of the scratch data of a request on the current thread.
+// Scopes nest; the thread's arena is reset when the outermost scope ends, so
+// nothing allocated from it may outlive that scope.
+class ScratchScope {
+public:
+    ScratchScope();
+    ScratchScope(const ScratchScope&) = delete;
+    ScratchScope& operator=(const ScratchScope&) = delete;
+    ~ScratchScope();
+
+    std::pmr::memory_resource* GetResource() const;
+
+private:
+    ScratchArena& arena_;
+    static thread_local size_t depth_;
+};
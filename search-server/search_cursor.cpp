@@ -0,0 +1,77 @@
+#include "search_cursor.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+SearchCursor::SearchCursor(std::vector<Document> documents)
+    : documents_(std::move(documents))
+{
+    if (!documents_.empty()) {
+        segments_.emplace(0, false);
+    }
+}
+
+std::vector<Document> SearchCursor::GetPage(size_t page, size_t page_size) {
+    if (page_size == 0) {
+        throw std::invalid_argument("Page size must be positive");
+    }
+    const size_t start = page * page_size;
+    if (start >= documents_.size()) {
+        position_ = documents_.size();
+        return {};
+    }
+    const size_t stop = std::min(start + page_size, documents_.size());
+    Rank(start, stop);
+    position_ = stop;
+    return { documents_.begin() + start, documents_.begin() + stop };
+}
+
+std::vector<Document> SearchCursor::NextPage(size_t page_size) {
+    if (page_size == 0) {
+        throw std::invalid_argument("Page size must be positive");
+    }
+    const size_t start = position_;
+    const size_t stop = std::min(start + page_size, documents_.size());
+    if (start >= stop) return {};
+    Rank(start, stop);
+    position_ = stop;
+    return { documents_.begin() + start, documents_.begin() + stop };
+}
+
+size_t SearchCursor::GetMatchedCount() const {
+    return documents_.size();
+}
+
+size_t SearchCursor::GetPageCount(size_t page_size) const {
+    return page_size == 0 ? 0 : (documents_.size() + page_size - 1) / page_size;
+}
+
+bool SearchCursor::HasNextPage() const {
+    return position_ < documents_.size();
+}
+
+void SearchCursor::SplitAt(size_t position) {
+    if (position >= documents_.size()) return;
+    auto segment = std::prev(segments_.upper_bound(position));
+    if (segment->first == position) return;
+    const auto next_segment = std::next(segment);
+    const size_t segment_end = next_segment == segments_.end() ? documents_.size() : next_segment->first;
+    if (!segment->second) {
+        std::nth_element(documents_.begin() + segment->first, documents_.begin() + position,
+                         documents_.begin() + segment_end, IsMoreRelevant);
+    }
+    segments_.emplace_hint(next_segment, position, segment->second);
+}
+
+void SearchCursor::Rank(size_t start, size_t stop) {
+    SplitAt(start);
+    SplitAt(stop);
+    for (auto segment = segments_.find(start); segment != segments_.end() && segment->first < stop; ++segment) {
+        if (segment->second) continue;
+        const auto next_segment = std::next(segment);
+        const size_t segment_end = next_segment == segments_.end() ? documents_.size() : next_segment->first;
+        std::sort(documents_.begin() + segment->first, documents_.begin() + segment_end, IsMoreRelevant);
+        segment->second = true;
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "document.h"
+
+// Keeps every matched document of a query and ranks only the pages that are asked for.
+// Ranked positions are remembered as fences between segments, so later pages continue
+// from the closest fence instead of sorting the whole result set again.
+class SearchCursor {
+public:
+    SearchCursor() = default;
+    explicit SearchCursor(std::vector<Document>);
+
+    std::vector<Document> GetPage(size_t, size_t);
+    std::vector<Document> NextPage(size_t);
+    size_t GetMatchedCount() const;
+    size_t GetPageCount(size_t) const;
+    bool HasNextPage() const;
+
+private:
+    std::vector<Document> documents_;
+    std::map<size_t, bool> segments_;
+    size_t position_ = 0;
+
+    void SplitAt(size_t);
+    void Rank(size_t, size_t);
+};
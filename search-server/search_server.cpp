@@ -1,29 +1,72 @@
 #include "search_server.h"
 
-SearchServer::SearchServer(std::string_view stop_words_text)
-    : SearchServer::SearchServer(SplitIntoWords(stop_words_text))
+SearchServer::SearchServer(std::string_view stop_words_text, std::pmr::memory_resource* resource)
+    : SearchServer::SearchServer(SplitIntoWords(stop_words_text), resource)
 {
 }
 
-SearchServer::SearchServer(const std::string& stop_words_text) 
-    : SearchServer::SearchServer(std::string_view(stop_words_text))
+SearchServer::SearchServer(const std::string& stop_words_text, std::pmr::memory_resource* resource) 
+    : SearchServer::SearchServer(std::string_view(stop_words_text), resource)
 {
 }
 
 void SearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
                                const std::vector<int>& ratings) {
+    SearchServer::CheckNotFrozen();
     if ((document_id < 0) || (documents_.count(document_id) > 0)) {
         throw std::invalid_argument("Invalid document_id");
     }
-    const auto words = SearchServer::SplitIntoWordsNoStop(document);
+    METRICS_OPERATION(Operation::ADD_DOCUMENT);
+    const ScratchScope scratch;
+    const auto prepared = SearchServer::PrepareDocument(document_id, document, status, ratings, scratch.GetResource());
+    METRICS_LAP(Phase::PARSE);
+    SearchServer::IndexDocument(prepared);
+    METRICS_LAP(Phase::INDEX);
+}
+
+// Each occurrence adds 1 / word count, so frequencies are bit-identical to
+// the ones summed while indexing word by word.
+PreparedDocument SearchServer::PrepareDocument(int document_id, std::string_view document, DocumentStatus status,
+                                               const std::vector<int>& ratings, std::pmr::memory_resource* resource) const {
+    if (document_id < 0) {
+        throw std::invalid_argument("Invalid document_id");
+    }
+    PreparedDocument prepared{ document_id, status, SearchServer::ComputeAverageRating(ratings),
+                               std::pmr::vector<std::pair<std::string_view, double>>(resource) };
+    auto words = SearchServer::SplitIntoWordsNoStop(document, resource);
     const double inv_word_count = 1.0 / words.size();
-    for (const std::string_view& word : words) {
-        auto& word_to_insert = storage_.emplace_back(std::string(word));
-        word_to_document_freqs_[word_to_insert][document_id] += inv_word_count;
-        document_to_word_[document_id][word_to_insert] += inv_word_count;
+    std::sort(words.begin(), words.end());
+    for (const std::string_view word : words) {
+        if (prepared.word_freqs.empty() || prepared.word_freqs.back().first != word) {
+            prepared.word_freqs.emplace_back(word, 0.0);
+        }
+        prepared.word_freqs.back().second += inv_word_count;
+    }
+    return prepared;
+}
+
+void SearchServer::AddPreparedDocument(const PreparedDocument& document) {
+    SearchServer::CheckNotFrozen();
+    if ((document.id < 0) || (documents_.count(document.id) > 0)) {
+        throw std::invalid_argument("Invalid document_id");
     }
-    documents_.emplace(document_id, DocumentData{ SearchServer::ComputeAverageRating(ratings), status });
-    document_ids_.emplace(document_id);
+    METRICS_OPERATION(Operation::ADD_DOCUMENT);
+    SearchServer::IndexDocument(document);
+    METRICS_LAP(Phase::INDEX);
+}
+
+void SearchServer::IndexDocument(const PreparedDocument& document) {
+    auto& term_ids = document_to_term_ids_[document.id];
+    term_ids.reserve(document.word_freqs.size());
+    for (const auto& [word, term_freq] : document.word_freqs) {
+        const int term_id = SearchServer::GetOrAddTermId(word);
+        term_to_document_freqs_[term_id].emplace(document.id, term_freq);
+        SearchServer::AddToSketch(term_id, document.id);
+        term_ids.push_back(term_id);
+    }
+    std::sort(term_ids.begin(), term_ids.end());
+    documents_.emplace(document.id, DocumentData{ document.rating, document.status });
+    document_ids_.emplace(document.id);
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
@@ -36,40 +79,113 @@ std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query)
     return SearchServer::FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 
-std::set<int>::const_iterator SearchServer::begin() const {
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, size_t page, size_t page_size) const {
+    METRICS_OPERATION(Operation::FIND_TOP_DOCUMENTS);
+    const ScratchScope scratch;
+    const auto query = SearchServer::CompileQuery(raw_query, scratch.GetResource());
+    METRICS_LAP(Phase::PARSE);
+    const auto matched_documents = SearchServer::FindAllDocuments(query, HasStatus(DocumentStatus::ACTUAL));
+    SearchCursor cursor(std::vector<Document>(matched_documents.begin(), matched_documents.end()));
+    auto result = cursor.GetPage(page, page_size);
+    METRICS_LAP(Phase::SORT);
+    return result;
+}
+
+CompiledQuery SearchServer::CompileQuery(std::string_view raw_query, QueryMode mode) const {
+    return SearchServer::CompileQuery(raw_query, std::pmr::get_default_resource(), mode);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const CompiledQuery& query, DocumentStatus status) const {
+    return SearchServer::FindTopDocuments(query, HasStatus(status));
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const CompiledQuery& query) const {
+    return SearchServer::FindTopDocuments(query, DocumentStatus::ACTUAL);
+}
+
+size_t SearchServer::CountMatches(std::string_view raw_query, DocumentStatus status, CountMode mode) const {
+    return SearchServer::CountMatches(raw_query, HasStatus(status), mode);
+}
+
+size_t SearchServer::CountMatches(std::string_view raw_query) const {
+    return SearchServer::CountMatches(raw_query, DocumentStatus::ACTUAL);
+}
+
+size_t SearchServer::CountMatches(const CompiledQuery& query, DocumentStatus status, CountMode mode) const {
+    return SearchServer::CountMatches(query, HasStatus(status), mode);
+}
+
+size_t SearchServer::CountMatches(const CompiledQuery& query) const {
+    return SearchServer::CountMatches(query, DocumentStatus::ACTUAL);
+}
+
+QueryPlan SearchServer::ExplainQuery(std::string_view raw_query) const {
+    const ScratchScope scratch;
+    return SearchServer::ExplainQuery(SearchServer::CompileQuery(raw_query, scratch.GetResource()));
+}
+
+QueryPlan SearchServer::ExplainQuery(const CompiledQuery& query) const {
+    SearchServer::CheckQueryServer(query);
+    const ScratchScope scratch;
+    const auto narrowed_query = SearchServer::DropCommonTerms(query, scratch.GetResource());
+    const auto cost = SearchServer::EstimateQueryCost(narrowed_query ? *narrowed_query : query);
+    QueryPlan plan;
+    plan.strategy = cost.strategy;
+    plan.posting_count = cost.posting_count;
+    plan.term_at_a_time_cost = cost.term_at_a_time_cost;
+    plan.document_at_a_time_cost = cost.document_at_a_time_cost;
+    const auto add_terms = [this, &plan](const std::pmr::vector<int>& term_ids, bool is_minus) {
+        const auto first = plan.terms.size();
+        for (const int term_id : term_ids) {
+            plan.terms.push_back({ term_id_to_word_[term_id], SearchServer::GetTermDocumentCount(term_id), is_minus });
+        }
+        std::stable_sort(plan.terms.begin() + first, plan.terms.end(), [is_minus](const auto& lhs, const auto& rhs) {
+            return is_minus ? lhs.document_count > rhs.document_count : lhs.document_count < rhs.document_count;
+        });
+    };
+    add_terms(query.minus_terms_, true);
+    add_terms(narrowed_query ? narrowed_query->plus_terms_ : query.plus_terms_, false);
+    if (narrowed_query) {
+        for (const int term_id : query.plus_terms_) {
+            if (SearchServer::IsCommonTerm(term_id)) {
+                const size_t document_count = SearchServer::GetTermDocumentCount(term_id);
+                plan.terms.push_back({ term_id_to_word_[term_id], document_count, false, true });
+                plan.skipped_posting_count += document_count;
+            }
+        }
+    }
+    return plan;
+}
+
+SearchCursor SearchServer::OpenSearchCursor(std::string_view raw_query, DocumentStatus status) const {
+    return SearchServer::OpenSearchCursor(raw_query, HasStatus(status));
+}
+
+SearchCursor SearchServer::OpenSearchCursor(std::string_view raw_query) const {
+    return SearchServer::OpenSearchCursor(raw_query, DocumentStatus::ACTUAL);
+}
+
+std::pmr::set<int>::const_iterator SearchServer::begin() const {
     return document_ids_.begin();
 }
 
-std::set<int>::const_iterator SearchServer::end() const {
+std::pmr::set<int>::const_iterator SearchServer::end() const {
     return document_ids_.end();
 }
 
 size_t SearchServer::GetDocumentCount() const {
-    return documents_.size();
+    return document_ids_.size();
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
     if (document_ids_.count(document_id) == 0) throw std::out_of_range("Invalid document id");
-    const auto query = SearchServer::ParseQuery(raw_query);
-    for (std::string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            return { std::vector<std::string_view>{}, documents_.at(document_id).status };
-        }
-    }
-    std::vector<std::string_view> matched_words;
-    matched_words.reserve(query.plus_words.size());
-    for (std::string_view word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            matched_words.push_back(word);
-        }
-    }
-    return { matched_words, documents_.at(document_id).status };
+    METRICS_OPERATION(Operation::MATCH_DOCUMENT);
+    const ScratchScope scratch;
+    const auto query = SearchServer::CompileQuery(raw_query, scratch.GetResource());
+    METRICS_LAP(Phase::PARSE);
+    auto result = SearchServer::MatchTerms(query, document_id);
+    METRICS_LAP(Phase::SCORE);
+    return result;
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::sequenced_policy&, 
@@ -80,39 +196,86 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::parallel_policy&,
                                                                                       std::string_view raw_query, int document_id) const {
     if (document_ids_.count(document_id) == 0) throw std::out_of_range("Invalid document id");
-    auto query = SearchServer::ParseQuery(raw_query, false);
-    if (std::any_of(std::execution::par,
-                    query.minus_words.begin(), query.minus_words.end(),
-                    [this, document_id](std::string_view word) {return document_to_word_.at(document_id).count(word); })) {
-        return { std::vector<std::string_view>{}, documents_.at(document_id).status};
+    METRICS_OPERATION(Operation::MATCH_DOCUMENT);
+    const ScratchScope scratch;
+    const auto query = SearchServer::CompileQuery(raw_query, scratch.GetResource());
+    METRICS_LAP(Phase::PARSE);
+    auto result = SearchServer::MatchTerms(query, document_id);
+    METRICS_LAP(Phase::SCORE);
+    return result;
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const CompiledQuery& query, int document_id) const {
+    SearchServer::CheckQueryServer(query);
+    if (document_ids_.count(document_id) == 0) throw std::out_of_range("Invalid document id");
+    METRICS_OPERATION(Operation::MATCH_DOCUMENT);
+    auto result = SearchServer::MatchTerms(query, document_id);
+    METRICS_LAP(Phase::SCORE);
+    return result;
+}
+
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> SearchServer::MatchDocuments(std::string_view raw_query,
+                                                                                                    const std::vector<int>& document_ids) const {
+    return SearchServer::MatchDocuments(std::execution::seq, raw_query, document_ids);
+}
+
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> SearchServer::MatchDocuments(const std::execution::sequenced_policy&,
+                                                                                                    std::string_view raw_query,
+                                                                                                    const std::vector<int>& document_ids) const {
+    for (const int document_id : document_ids) {
+        if (document_ids_.count(document_id) == 0) throw std::out_of_range("Invalid document id");
+    }
+    METRICS_OPERATION(Operation::MATCH_DOCUMENT);
+    const ScratchScope scratch;
+    const auto query = SearchServer::CompileQuery(raw_query, scratch.GetResource());
+    METRICS_LAP(Phase::PARSE);
+    std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> result;
+    result.reserve(document_ids.size());
+    for (const int document_id : document_ids) {
+        result.push_back(SearchServer::MatchTerms(query, document_id));
+    }
+    METRICS_LAP(Phase::SCORE);
+    return result;
+}
+
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> SearchServer::MatchDocuments(const std::execution::parallel_policy&,
+                                                                                                    std::string_view raw_query,
+                                                                                                    const std::vector<int>& document_ids) const {
+    if (std::any_of(std::execution::par, document_ids.begin(), document_ids.end(),
+                    [this](int document_id) { return document_ids_.count(document_id) == 0; })) {
+        throw std::out_of_range("Invalid document id");
     }
-    std::vector<std::string_view> matched_words(query.plus_words.size());
-    auto it = std::copy_if(std::execution::par,
-                           query.plus_words.begin(), query.plus_words.end(),
-                           matched_words.begin(),
-                           [this, document_id](std::string_view word) {return document_to_word_.at(document_id).count(word); });
-    std::sort(matched_words.begin(), it);
-    matched_words.erase(std::unique(matched_words.begin(), it), matched_words.end());
-    return { matched_words, documents_.at(document_id).status };
+    METRICS_OPERATION(Operation::MATCH_DOCUMENT);
+    const ScratchScope scratch;
+    const auto query = SearchServer::CompileQuery(raw_query, scratch.GetResource());
+    METRICS_LAP(Phase::PARSE);
+    std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> result(document_ids.size());
+    std::transform(std::execution::par, document_ids.begin(), document_ids.end(), result.begin(),
+                   [this, &query](int document_id) { return MatchTerms(query, document_id); });
+    METRICS_LAP(Phase::SCORE);
+    return result;
 }
 
-const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
-    static const std::map<std::string_view, double> empty_map;
-    if (document_to_word_.count(document_id) == 0) {
-        return empty_map;
+WordFrequencies SearchServer::GetWordFrequencies(int document_id) const {
+    if (document_ids_.count(document_id) == 0) {
+        return WordFrequencies(this, document_id, nullptr, nullptr);
     }
-    return document_to_word_.at(document_id);
+    const auto [terms_begin, terms_end] = SearchServer::GetDocumentTerms(document_id);
+    return WordFrequencies(this, document_id, terms_begin, terms_end);
 }
 
 void SearchServer::RemoveDocument(int document_id) {
+    SearchServer::CheckNotFrozen();
     if (document_ids_.count(document_id) == 0) throw std::out_of_range("Invalid document id");
-    for (const auto& [word, freq] : document_to_word_.at(document_id)) {
-        word_to_document_freqs_.at(word).erase(document_id);
-        if (word_to_document_freqs_.at(word).empty()) word_to_document_freqs_.erase(word);
+    METRICS_OPERATION(Operation::REMOVE_DOCUMENT);
+    for (const int term_id : document_to_term_ids_.at(document_id)) {
+        term_to_document_freqs_[term_id].erase(document_id);
+        SearchServer::RemoveFromSketch(term_id, document_id);
     }
-    document_to_word_.erase(document_id);
+    document_to_term_ids_.erase(document_id);
     documents_.erase(document_id);
     document_ids_.erase(document_id);
+    METRICS_LAP(Phase::INDEX);
 }
 
 void SearchServer::RemoveDocument(const std::execution::sequenced_policy&, int document_id) {
@@ -120,24 +283,253 @@ void SearchServer::RemoveDocument(const std::execution::sequenced_policy&, int d
 }
 
 void SearchServer::RemoveDocument(const std::execution::parallel_policy&, int document_id) {
+    SearchServer::CheckNotFrozen();
     if (document_ids_.count(document_id) == 0) throw std::out_of_range("Invalid document id");
-    auto& word_to_freq = GetWordFrequencies(document_id);
-    std::vector<const std::string_view*> words_to_delete(word_to_freq.size());
-    std::transform(std::execution::par, 
-                   word_to_freq.begin(), word_to_freq.end(), 
-                   words_to_delete.begin(),
-                   [](const auto& key_value) {return &key_value.first; });
+    METRICS_OPERATION(Operation::REMOVE_DOCUMENT);
+    const auto& term_ids = document_to_term_ids_.at(document_id);
     std::for_each(std::execution::par, 
-                  words_to_delete.begin(), words_to_delete.end(), 
-                  [this, document_id](const std::string_view* word) { 
-                      word_to_document_freqs_.at(*word).erase(document_id);});
-    document_to_word_.erase(document_id);
+                  term_ids.begin(), term_ids.end(), 
+                  [this, document_id](int term_id) { 
+                      term_to_document_freqs_[term_id].erase(document_id);
+                      SearchServer::RemoveFromSketch(term_id, document_id);});
+    document_to_term_ids_.erase(document_id);
     documents_.erase(document_id);
     document_ids_.erase(document_id);
+    METRICS_LAP(Phase::INDEX);
+}
+
+// Copies the postings, the forward index, the document attributes and the
+// dictionary into the flat arrays of a FrozenIndex and frees the maps they
+// lived in. The set of ids behind begin/end, the sketches and the words stay.
+// Term ids do not change, so queries compiled before freezing stay valid.
+void SearchServer::Freeze(TermFreqPrecision precision, DocumentOrder order) {
+    if (frozen_) {
+        return;
+    }
+    std::pmr::memory_resource* resource = term_id_to_word_.get_allocator().resource();
+    const ScratchScope scratch;
+    FrozenIndex index(term_id_to_word_, precision, resource);
+    index.document_ids = SearchServer::OrderDocuments(order, scratch.GetResource());
+    index.ratings.reserve(documents_.size());
+    index.statuses.reserve(documents_.size());
+    index.document_term_offsets.reserve(documents_.size() + 1);
+    index.document_term_offsets.push_back(0);
+    index.sorted_terms.reserve(word_to_term_id_.size());
+    for (const auto& [word, term_id] : word_to_term_id_) {
+        index.sorted_terms.push_back(term_id);
+    }
+    for (const int document_id : index.document_ids) {
+        const auto& document_data = documents_.at(document_id);
+        index.ratings.push_back(document_data.rating);
+        index.statuses.push_back(document_data.status);
+        const auto& term_ids = document_to_term_ids_.at(document_id);
+        index.document_terms.insert(index.document_terms.end(), term_ids.begin(), term_ids.end());
+        index.document_term_offsets.push_back(static_cast<uint32_t>(index.document_terms.size()));
+    }
+    index.documents_by_id.resize(index.document_ids.size());
+    std::iota(index.documents_by_id.begin(), index.documents_by_id.end(), 0u);
+    std::sort(index.documents_by_id.begin(), index.documents_by_id.end(), [&index](uint32_t lhs, uint32_t rhs) {
+        return index.document_ids[lhs] < index.document_ids[rhs];
+    });
+    index.posting_offsets.reserve(term_to_document_freqs_.size() + 1);
+    index.posting_offsets.push_back(0);
+    index.posting_documents.reserve(index.document_terms.size());
+    std::pmr::vector<std::pair<uint32_t, double>> postings(scratch.GetResource());
+    std::pmr::vector<double> term_freqs(scratch.GetResource());
+    for (const auto& document_freqs : term_to_document_freqs_) {
+        auto document_it = index.documents_by_id.begin();
+        postings.clear();
+        for (const auto& [document_id, term_freq] : document_freqs) {
+            document_it = std::lower_bound(document_it, index.documents_by_id.end(), document_id,
+                                           [&index](uint32_t document, int id) { return index.document_ids[document] < id; });
+            postings.emplace_back(*document_it, term_freq);
+        }
+        if (order != DocumentOrder::ID) {
+            std::sort(postings.begin(), postings.end());
+        }
+        term_freqs.clear();
+        for (const auto& [document, term_freq] : postings) {
+            index.posting_documents.push_back(document);
+            term_freqs.push_back(term_freq);
+        }
+        index.AppendTermFreqs(term_freqs);
+        index.posting_offsets.push_back(static_cast<uint32_t>(index.posting_documents.size()));
+    }
+    const size_t bitmap_word_count = index.GetBitmapWordCount();
+    index.bitmap_offsets.reserve(term_to_document_freqs_.size());
+    for (size_t term_id = 0; term_id < term_to_document_freqs_.size(); ++term_id) {
+        const uint32_t first = index.posting_offsets[term_id];
+        const uint32_t last = index.posting_offsets[term_id + 1];
+        if (last == first || (last - first) * FrozenIndex::BITMAP_DENSITY < index.document_ids.size()) {
+            index.bitmap_offsets.push_back(FrozenIndex::NO_BITMAP);
+            continue;
+        }
+        const size_t offset = index.bitmap_words.size();
+        index.bitmap_offsets.push_back(static_cast<uint32_t>(offset));
+        index.bitmap_words.resize(offset + bitmap_word_count);
+        for (uint32_t i = first; i < last; ++i) {
+            const uint32_t document = index.posting_documents[i];
+            index.bitmap_words[offset + document / 64] |= uint64_t{1} << (document % 64);
+        }
+    }
+    index.slot_to_term.resize(term_id_to_word_.size());
+    for (size_t term_id = 0; term_id < term_id_to_word_.size(); ++term_id) {
+        index.slot_to_term[index.term_hash(term_id_to_word_[term_id])] = static_cast<int>(term_id);
+    }
+    frozen_.emplace(std::move(index));
+    term_to_document_freqs_.clear();
+    term_to_document_freqs_.shrink_to_fit();
+    document_to_term_ids_.clear();
+    word_to_term_id_.clear();
+    documents_.clear();
+}
+
+// SIMILARITY sorts by the words with the smallest hashes: documents are grouped
+// by a word they share, then by a second one within the group. Two random
+// documents with Jaccard similarity j share the first word with probability j.
+std::pmr::vector<int> SearchServer::OrderDocuments(DocumentOrder order, std::pmr::memory_resource* resource) const {
+    std::pmr::vector<int> document_ids(resource);
+    document_ids.reserve(documents_.size());
+    for (const auto& [document_id, document_data] : documents_) {
+        document_ids.push_back(document_id);
+    }
+    if (order == DocumentOrder::RATING) {
+        std::stable_sort(document_ids.begin(), document_ids.end(), [this](int lhs, int rhs) {
+            return documents_.at(lhs).rating > documents_.at(rhs).rating;
+        });
+    }
+    else if (order == DocumentOrder::SIMILARITY) {
+        const int SIGNATURE_SIZE = 2;
+        using Signature = std::array<uint64_t, SIGNATURE_SIZE>;
+        std::pmr::vector<std::pair<Signature, int>> signatures(resource);
+        signatures.reserve(document_ids.size());
+        for (const int document_id : document_ids) {
+            Signature signature;
+            signature.fill(std::numeric_limits<uint64_t>::max());
+            for (const int term_id : document_to_term_ids_.at(document_id)) {
+                for (int i = 0; i < SIGNATURE_SIZE; ++i) {
+                    signature[i] = std::min(signature[i], SearchServer::HashId(term_id * SIGNATURE_SIZE + i));
+                }
+            }
+            signatures.emplace_back(signature, document_id);
+        }
+        std::sort(signatures.begin(), signatures.end());
+        for (size_t i = 0; i < signatures.size(); ++i) {
+            document_ids[i] = signatures[i].second;
+        }
+    }
+    return document_ids;
+}
+
+bool SearchServer::IsFrozen() const {
+    return frozen_.has_value();
+}
+
+namespace {
+
+template <typename T>
+void KeepResident(std::pmr::vector<T>& values, const std::pmr::vector<uint32_t>& posting_offsets,
+                  const std::pmr::vector<bool>& is_resident) {
+    if (values.empty()) {
+        return;
+    }
+    std::pmr::vector<T> resident_values(values.get_allocator());
+    for (size_t term_id = 0; term_id < is_resident.size(); ++term_id) {
+        if (is_resident[term_id]) {
+            resident_values.insert(resident_values.end(), values.begin() + posting_offsets[term_id],
+                                   values.begin() + posting_offsets[term_id + 1]);
+        }
+    }
+    resident_values.shrink_to_fit();
+    values.swap(resident_values);
+}
+
+}
+
+// The most frequent words stay resident: a word is queried about as often as
+// it occurs, so they serve most lookups. The cache promotes the cold words that
+// traffic keeps asking for.
+void SearchServer::MovePostingsToDisk(const std::string& path, const TieringOptions& options) {
+    if (!frozen_) {
+        throw std::logic_error("Index is not frozen");
+    }
+    auto& index = *frozen_;
+    if (index.cold_postings) {
+        throw std::logic_error("Postings are already on disk");
+    }
+    const size_t term_count = index.posting_offsets.size() - 1;
+    const ScratchScope scratch;
+    std::pmr::vector<int> term_ids(term_count, scratch.GetResource());
+    std::iota(term_ids.begin(), term_ids.end(), 0);
+    std::stable_sort(term_ids.begin(), term_ids.end(), [this](int lhs, int rhs) {
+        return SearchServer::GetTermDocumentCount(lhs) > SearchServer::GetTermDocumentCount(rhs);
+    });
+    std::pmr::vector<bool> is_resident(term_count, false, scratch.GetResource());
+    size_t resident_posting_count = 0;
+    for (const int term_id : term_ids) {
+        const size_t document_count = SearchServer::GetTermDocumentCount(term_id);
+        if (resident_posting_count + document_count > options.resident_posting_count) {
+            break;
+        }
+        resident_posting_count += document_count;
+        is_resident[term_id] = true;
+    }
+
+    auto cold_postings = index.MakeColdPostingStore(path, options.cache_byte_count);
+    std::pmr::vector<uint32_t> resident_offsets(index.posting_offsets.get_allocator());
+    resident_offsets.reserve(term_count);
+    uint32_t resident_offset = 0;
+    for (size_t term_id = 0; term_id < term_count; ++term_id) {
+        const uint32_t first = index.posting_offsets[term_id];
+        const uint32_t count = index.posting_offsets[term_id + 1] - first;
+        if (is_resident[term_id] || count == 0) {
+            resident_offsets.push_back(resident_offset);
+            resident_offset += count;
+            continue;
+        }
+        index.AppendColdPostings(*cold_postings, static_cast<int>(term_id), first, count);
+        resident_offsets.push_back(FrozenIndex::NOT_RESIDENT);
+    }
+    KeepResident(index.posting_documents, index.posting_offsets, is_resident);
+    KeepResident(index.posting_freqs, index.posting_offsets, is_resident);
+    KeepResident(index.posting_freqs_f32, index.posting_offsets, is_resident);
+    KeepResident(index.posting_freqs_u16, index.posting_offsets, is_resident);
+    KeepResident(index.posting_freqs_u8, index.posting_offsets, is_resident);
+    index.resident_offsets = std::move(resident_offsets);
+    index.cold_postings = std::move(cold_postings);
+}
+
+void SearchServer::WarmUp(const std::vector<std::string>& queries) const {
+    if (!frozen_ || !frozen_->cold_postings) {
+        return;
+    }
+    for (const auto& raw_query : queries) {
+        const ScratchScope scratch;
+        const auto query = SearchServer::CompileQuery(raw_query, scratch.GetResource());
+        for (const auto* term_ids : { &query.plus_terms_, &query.minus_terms_ }) {
+            for (const int term_id : *term_ids) {
+                frozen_->GetPostings(term_id);
+            }
+        }
+    }
+}
+
+void SearchServer::SetCommonWordRatio(double ratio) {
+    if (!(ratio > 0.0 && ratio <= 1.0)) {
+        throw std::invalid_argument("Common word ratio must be in (0, 1]");
+    }
+    common_word_ratio_ = ratio;
+}
+
+PostingCacheStats SearchServer::GetPostingCacheStats() const {
+    if (!frozen_ || !frozen_->cold_postings) {
+        return {};
+    }
+    return frozen_->cold_postings->GetStats();
 }
 
 bool SearchServer::IsStopWord(std::string_view word) const {
-    return stop_words_.count(word) > 0;
+    return stop_words_.Contains(word);
 }
 
 bool SearchServer::IsValidWord(std::string_view word) {
@@ -146,10 +538,11 @@ bool SearchServer::IsValidWord(std::string_view word) {
         });
 }
 
-std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text) const {
+std::pmr::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text,
+                                                                     std::pmr::memory_resource* resource) const {
     using namespace std::string_literals;
-    std::vector<std::string_view> words;
-    for (std::string_view word : SplitIntoWords(text)) {
+    std::pmr::vector<std::string_view> words(resource);
+    for (std::string_view word : SplitIntoWords(text, resource)) {
         if (!SearchServer::IsValidWord(word)) {
             throw std::invalid_argument("Word: "s + std::string(word) + " is invalid"s);
         }
@@ -180,17 +573,36 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) cons
         is_minus = true;
         word = word.substr(1);
     }
+    bool is_prefix = false;
+    if (!word.empty() && word.back() == '*') {
+        is_prefix = true;
+        word.remove_suffix(1);
+    }
     if (word.empty() || word[0] == '-' || !SearchServer::IsValidWord(word)) {
         throw std::invalid_argument("Query word: "s + std::string(text) + " is invalid");
     }
-    return { word, is_minus, SearchServer::IsStopWord(word) };
+    return { word, is_minus, !is_prefix && SearchServer::IsStopWord(word), is_prefix };
+}
+
+namespace {
+
+void SortUniqueWords(std::pmr::vector<std::string_view>& words) {
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
 }
 
-SearchServer::Query SearchServer::ParseQuery(std::string_view text, bool is_sort_need) const {
-    SearchServer::Query result;
-    for (std::string_view word : SplitIntoWords(text)) {
+}
+
+// Prefix words are kept apart: they are expanded against a dictionary later.
+SearchServer::Query SearchServer::ParseQuery(std::string_view text, std::pmr::memory_resource* resource) const {
+    SearchServer::Query result{ std::pmr::vector<std::string_view>(resource), std::pmr::vector<std::string_view>(resource),
+                                std::pmr::vector<std::string_view>(resource), std::pmr::vector<std::string_view>(resource) };
+    ForEachWord(text, [this, &result](std::string_view word) {
         const auto query_word = SearchServer::ParseQueryWord(word);
-        if (!query_word.is_stop) {
+        if (query_word.is_prefix) {
+            (query_word.is_minus ? result.minus_prefixes : result.plus_prefixes).emplace_back(query_word.data);
+        }
+        else if (!query_word.is_stop) {
             if (query_word.is_minus) {
                 result.minus_words.emplace_back(query_word.data);
             }
@@ -198,16 +610,561 @@ SearchServer::Query SearchServer::ParseQuery(std::string_view text, bool is_sort
                 result.plus_words.emplace_back(query_word.data);
             }
         }
+    });
+    SortUniqueWords(result.plus_words);
+    SortUniqueWords(result.minus_words);
+    SortUniqueWords(result.plus_prefixes);
+    SortUniqueWords(result.minus_prefixes);
+    return result;
+}
+
+// Replaces the prefixes with the words of this server's dictionary.
+void SearchServer::ExpandQuery(Query& query) const {
+    const auto expand = [this](std::pmr::vector<std::string_view>& prefixes, std::pmr::vector<std::string_view>& words) {
+        for (std::string_view prefix : prefixes) {
+            SearchServer::ForEachPrefixTerm(prefix, [this, &words](int term_id) { words.push_back(term_id_to_word_[term_id]); });
+        }
+        prefixes.clear();
+        SortUniqueWords(words);
+    };
+    expand(query.plus_prefixes, query.plus_words);
+    expand(query.minus_prefixes, query.minus_words);
+}
+
+void SearchServer::CheckNotFrozen() const {
+    if (frozen_) {
+        throw std::logic_error("Index is frozen");
+    }
+}
+
+int SearchServer::GetOrAddTermId(std::string_view word) {
+    const auto it = word_to_term_id_.find(word);
+    if (it != word_to_term_id_.end()) {
+        return it->second;
+    }
+    const int term_id = static_cast<int>(term_id_to_word_.size());
+    const std::string_view term = storage_.emplace_back(word);
+    term_id_to_word_.push_back(term);
+    term_to_document_freqs_.emplace_back();
+    term_sketches_.emplace_back();
+    word_to_term_id_.emplace(term, term_id);
+    return term_id;
+}
+
+// The SplitMix64 finalizer, a bijection, so equal hashes mean equal ids. Hashes
+// document ids for the sketches and term ids for the MinHash signatures.
+uint64_t SearchServer::HashId(int document_id) {
+    uint64_t hash = static_cast<uint64_t>(document_id) + 0x9e3779b97f4a7c15ull;
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+    return hash ^ (hash >> 31);
+}
+
+// Called after the posting is added.
+void SearchServer::AddToSketch(int term_id, int document_id) {
+    auto& sketch = term_sketches_[term_id];
+    if (term_to_document_freqs_[term_id].size() <= MATCH_COUNT_SKETCH_SIZE) {
+        return;
     }
-    if (is_sort_need) {
-        std::sort(result.plus_words.begin(), result.plus_words.end());
-        std::sort(result.minus_words.begin(), result.minus_words.end());
-        result.plus_words.erase(std::unique(result.plus_words.begin(), result.plus_words.end()), result.plus_words.end());
-        result.minus_words.erase(std::unique(result.minus_words.begin(), result.minus_words.end()), result.minus_words.end());
+    if (sketch.empty()) {
+        SearchServer::RebuildSketch(term_id);
+        return;
+    }
+    const uint64_t hash = SearchServer::HashId(document_id);
+    if (hash >= SearchServer::HashId(sketch.back())) {
+        return;
+    }
+    sketch.pop_back();
+    sketch.insert(std::upper_bound(sketch.begin(), sketch.end(), hash, [](uint64_t lhs, int rhs) {
+        return lhs < SearchServer::HashId(rhs);
+    }), document_id);
+}
+
+// Called after the posting is erased. Losing a sampled document costs a scan of
+// the postings, which happens with probability MATCH_COUNT_SKETCH_SIZE / document count.
+void SearchServer::RemoveFromSketch(int term_id, int document_id) {
+    auto& sketch = term_sketches_[term_id];
+    if (sketch.empty()) {
+        return;
+    }
+    if (term_to_document_freqs_[term_id].size() <= MATCH_COUNT_SKETCH_SIZE) {
+        sketch.clear();
+        return;
+    }
+    const uint64_t hash = SearchServer::HashId(document_id);
+    if (hash <= SearchServer::HashId(sketch.back())) {
+        SearchServer::RebuildSketch(term_id);
+    }
+}
+
+// Keeps a max-heap of the smallest hashes, so the sketch never grows past its
+// size and a rebuild allocates nothing once the sketch has been full.
+void SearchServer::RebuildSketch(int term_id) {
+    auto& sketch = term_sketches_[term_id];
+    const auto is_less = [](int lhs, int rhs) {
+        return SearchServer::HashId(lhs) < SearchServer::HashId(rhs);
+    };
+    sketch.clear();
+    sketch.reserve(MATCH_COUNT_SKETCH_SIZE);
+    for (const auto& [document_id, term_freq] : term_to_document_freqs_[term_id]) {
+        if (sketch.size() < MATCH_COUNT_SKETCH_SIZE) {
+            sketch.push_back(document_id);
+            std::push_heap(sketch.begin(), sketch.end(), is_less);
+        }
+        else if (is_less(document_id, sketch.front())) {
+            std::pop_heap(sketch.begin(), sketch.end(), is_less);
+            sketch.back() = document_id;
+            std::push_heap(sketch.begin(), sketch.end(), is_less);
+        }
     }
+    std::sort_heap(sketch.begin(), sketch.end(), is_less);
+}
+
+// Words are validated and checked against the stop words as they are read,
+// then looked up in the dictionary, so unknown words never reach the result.
+CompiledQuery SearchServer::CompileQuery(std::string_view text, std::pmr::memory_resource* resource, QueryMode mode) const {
+    CompiledQuery result(this, mode, resource);
+    ForEachWord(text, [this, &result, mode](std::string_view word) {
+        const auto query_word = SearchServer::ParseQueryWord(word);
+        auto& term_ids = query_word.is_minus ? result.minus_terms_ : result.plus_terms_;
+        if (query_word.is_prefix) {
+            if (mode == QueryMode::ALL && !query_word.is_minus) {
+                throw std::invalid_argument("Prefix words are not supported in ALL mode");
+            }
+            SearchServer::ForEachPrefixTerm(query_word.data, [&term_ids](int term_id) { term_ids.push_back(term_id); });
+            return;
+        }
+        if (query_word.is_stop) {
+            return;
+        }
+        const int term_id = SearchServer::FindTermId(query_word.data);
+        if (term_id >= 0) {
+            term_ids.push_back(term_id);
+        }
+        else if (!query_word.is_minus) {
+            result.has_unknown_plus_words_ = true;
+        }
+    });
+    SearchServer::SortQueryTerms(result);
+    return result;
+}
+
+// Prefixes left in the query are expanded against this server's dictionary.
+CompiledQuery SearchServer::ResolveQuery(const Query& query, std::pmr::memory_resource* resource) const {
+    CompiledQuery result(this, QueryMode::ANY, resource);
+    const auto resolve = [this](const std::pmr::vector<std::string_view>& words, const std::pmr::vector<std::string_view>& prefixes,
+                                std::pmr::vector<int>& term_ids) {
+        term_ids.reserve(words.size());
+        for (std::string_view word : words) {
+            const int term_id = SearchServer::FindTermId(word);
+            if (term_id >= 0) {
+                term_ids.push_back(term_id);
+            }
+        }
+        for (std::string_view prefix : prefixes) {
+            SearchServer::ForEachPrefixTerm(prefix, [&term_ids](int term_id) { term_ids.push_back(term_id); });
+        }
+    };
+    resolve(query.plus_words, query.plus_prefixes, result.plus_terms_);
+    resolve(query.minus_words, query.minus_prefixes, result.minus_terms_);
+    SearchServer::SortQueryTerms(result);
     return result;
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(std::string_view word) const {
-    return std::log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
-}
\ No newline at end of file
+void SearchServer::SortQueryTerms(CompiledQuery& query) const {
+    auto& plus_terms = query.plus_terms_;
+    auto& minus_terms = query.minus_terms_;
+    std::sort(plus_terms.begin(), plus_terms.end(),
+              [this](int lhs, int rhs) { return term_id_to_word_[lhs] < term_id_to_word_[rhs]; });
+    plus_terms.erase(std::unique(plus_terms.begin(), plus_terms.end()), plus_terms.end());
+    query.sorted_plus_terms_.assign(plus_terms.begin(), plus_terms.end());
+    std::sort(query.sorted_plus_terms_.begin(), query.sorted_plus_terms_.end());
+    std::sort(minus_terms.begin(), minus_terms.end());
+    minus_terms.erase(std::unique(minus_terms.begin(), minus_terms.end()), minus_terms.end());
+}
+
+void SearchServer::CheckQueryServer(const CompiledQuery& query) const {
+    if (query.server_ != this) {
+        throw std::invalid_argument("Query is compiled by another server");
+    }
+}
+
+// The plus terms sorted by id are merged with the terms of the document; the
+// matched words are then put back in the order of the words.
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchTerms(const CompiledQuery& query, int document_id) const {
+    const auto status = SearchServer::GetDocumentData(document_id).status;
+    const auto [terms_begin, terms_end] = SearchServer::GetDocumentTerms(document_id);
+    if (HasIntersection(query.minus_terms_.begin(), query.minus_terms_.end(), terms_begin, terms_end)) {
+        return { std::vector<std::string_view>{}, status };
+    }
+    std::vector<std::string_view> matched_words;
+    matched_words.reserve(query.plus_terms_.size());
+    IntersectSorted(query.sorted_plus_terms_.begin(), query.sorted_plus_terms_.end(), terms_begin, terms_end,
+                    [this, &matched_words](auto term_it, auto) { matched_words.push_back(term_id_to_word_[*term_it]); });
+    std::sort(matched_words.begin(), matched_words.end());
+    if (query.mode_ == QueryMode::ALL && (query.has_unknown_plus_words_ || matched_words.size() < query.plus_terms_.size())) {
+        matched_words.clear();
+    }
+    return { std::move(matched_words), status };
+}
+
+// For a document sampled from the postings of a plus word.
+bool SearchServer::MatchesQueryTerms(const CompiledQuery& query, int document_id) const {
+    const auto [terms_begin, terms_end] = SearchServer::GetDocumentTerms(document_id);
+    if (HasIntersection(query.minus_terms_.begin(), query.minus_terms_.end(), terms_begin, terms_end)) {
+        return false;
+    }
+    if (query.mode_ == QueryMode::ANY) {
+        return true;
+    }
+    size_t matched_count = 0;
+    IntersectSorted(query.sorted_plus_terms_.begin(), query.sorted_plus_terms_.end(), terms_begin, terms_end,
+                    [&matched_count](auto, auto) { ++matched_count; });
+    return matched_count == query.sorted_plus_terms_.size();
+}
+
+std::vector<Document> SearchServer::TakeTopDocuments(std::pmr::vector<Document>& matched_documents) {
+    const size_t MAX_RESULT_DOCUMENT_COUNT = 5;
+    const auto end = matched_documents.begin() + std::min(matched_documents.size(), MAX_RESULT_DOCUMENT_COUNT);
+    return std::vector<Document>(matched_documents.begin(), end);
+}
+
+int SearchServer::FindTermId(std::string_view word) const {
+    if (frozen_) {
+        if (frozen_->slot_to_term.empty()) {
+            return -1;
+        }
+        const int term_id = frozen_->slot_to_term[frozen_->term_hash(word)];
+        return term_id_to_word_[term_id] == word ? term_id : -1;
+    }
+    const auto it = word_to_term_id_.find(word);
+    return it == word_to_term_id_.end() ? -1 : it->second;
+}
+
+size_t SearchServer::FindFrozenDocument(int document_id) const {
+    const auto& index = *frozen_;
+    return *std::lower_bound(index.documents_by_id.begin(), index.documents_by_id.end(), document_id,
+                             [&index](uint32_t document, int id) { return index.document_ids[document] < id; });
+}
+
+SearchServer::DocumentData SearchServer::GetDocumentData(int document_id) const {
+    if (frozen_) {
+        const size_t document = SearchServer::FindFrozenDocument(document_id);
+        return { frozen_->ratings[document], frozen_->statuses[document] };
+    }
+    return documents_.at(document_id);
+}
+
+std::pair<const int*, const int*> SearchServer::GetDocumentTerms(int document_id) const {
+    if (frozen_) {
+        const size_t document = SearchServer::FindFrozenDocument(document_id);
+        const int* terms = frozen_->document_terms.data();
+        return { terms + frozen_->document_term_offsets[document], terms + frozen_->document_term_offsets[document + 1] };
+    }
+    const auto& term_ids = document_to_term_ids_.at(document_id);
+    return { term_ids.data(), term_ids.data() + term_ids.size() };
+}
+
+size_t SearchServer::GetTermDocumentCount(int term_id) const {
+    if (frozen_) {
+        return frozen_->posting_offsets[term_id + 1] - frozen_->posting_offsets[term_id];
+    }
+    return term_to_document_freqs_[term_id].size();
+}
+
+double SearchServer::GetDocumentTermFreq(int term_id, int document_id) const {
+    if (frozen_) {
+        const auto& index = *frozen_;
+        const auto document = static_cast<uint32_t>(SearchServer::FindFrozenDocument(document_id));
+        const auto postings = index.GetPostings(term_id);
+        const auto position = static_cast<uint32_t>(
+            std::lower_bound(postings.documents, postings.documents + postings.count, document) - postings.documents);
+        return postings.term_freqs ? postings.term_freqs[position] : index.GetTermFreq(term_id, postings.first + position);
+    }
+    return term_to_document_freqs_[term_id].at(document_id);
+}
+
+size_t SearchServer::GetWordDocumentCount(std::string_view word) const {
+    const int term_id = SearchServer::FindTermId(word);
+    return term_id < 0 ? 0 : SearchServer::GetTermDocumentCount(term_id);
+}
+
+double SearchServer::ComputeTermInverseDocumentFreq(int term_id) const {
+    return std::log(GetDocumentCount() * 1.0 / SearchServer::GetTermDocumentCount(term_id));
+}
+
+bool SearchServer::IsCommonTerm(int term_id) const {
+    return SearchServer::GetTermDocumentCount(term_id) > common_word_ratio_ * GetDocumentCount();
+}
+
+// Returns the query without its common plus words, nothing if it has none or
+// if they are all its plus words with documents.
+std::optional<CompiledQuery> SearchServer::DropCommonTerms(const CompiledQuery& query,
+                                                           std::pmr::memory_resource* resource) const {
+    if (common_word_ratio_ >= 1.0 || query.mode_ != QueryMode::ANY) {
+        return std::nullopt;
+    }
+    const auto is_rare = [this](int term_id) {
+        return SearchServer::GetTermDocumentCount(term_id) > 0 && !SearchServer::IsCommonTerm(term_id);
+    };
+    const auto is_common = [this](int term_id) { return SearchServer::IsCommonTerm(term_id); };
+    if (std::none_of(query.plus_terms_.begin(), query.plus_terms_.end(), is_common)
+        || std::none_of(query.plus_terms_.begin(), query.plus_terms_.end(), is_rare)) {
+        return std::nullopt;
+    }
+    CompiledQuery narrowed_query(this, query.mode_, resource);
+    narrowed_query.minus_terms_.assign(query.minus_terms_.begin(), query.minus_terms_.end());
+    std::copy_if(query.sorted_plus_terms_.begin(), query.sorted_plus_terms_.end(),
+                 std::back_inserter(narrowed_query.sorted_plus_terms_),
+                 [this](int term_id) { return !SearchServer::IsCommonTerm(term_id); });
+    size_t skipped_posting_count = 0;
+    for (const int term_id : query.plus_terms_) {
+        if (SearchServer::IsCommonTerm(term_id)) {
+            skipped_posting_count += SearchServer::GetTermDocumentCount(term_id);
+        }
+        else {
+            narrowed_query.plus_terms_.push_back(term_id);
+        }
+    }
+    METRICS_COUNT(Counter::POSTINGS_SKIPPED, skipped_posting_count);
+    return narrowed_query;
+}
+
+// Term at a time pays a map update per posting, document at a time a scan of
+// all plus terms per candidate document. A minus word found in every document
+// empties the result before any posting is read, and so does a plus word
+// without documents in an ALL query, which is evaluated by intersection. A
+// minus word whose postings cover the candidate set empties it too.
+SearchServer::QueryCost SearchServer::EstimateQueryCost(const CompiledQuery& query) const {
+    // A step down the accumulator map costs about three cursor comparisons.
+    const double MAP_STEP_COST = 3.0;
+    // Clearing and scanning the array costs about a posting per eight documents.
+    const double DENSE_SCAN_RATIO = 8.0;
+    QueryCost cost{ QueryStrategy::EMPTY, 0, 0.0, 0.0 };
+    const size_t document_count = GetDocumentCount();
+    for (const int term_id : query.minus_terms_) {
+        if (SearchServer::GetTermDocumentCount(term_id) == document_count) {
+            return cost;
+        }
+    }
+    size_t term_count = 0;
+    for (const int term_id : query.plus_terms_) {
+        const size_t term_document_count = SearchServer::GetTermDocumentCount(term_id);
+        if (term_document_count > 0) {
+            ++term_count;
+            cost.posting_count += term_document_count;
+        }
+    }
+    if (term_count == 0 || (query.mode_ == QueryMode::ALL && (query.has_unknown_plus_words_ || term_count < query.plus_terms_.size()))) {
+        cost.posting_count = 0;
+        return cost;
+    }
+    for (const int term_id : query.minus_terms_) {
+        if (SearchServer::CoversCandidates(query, term_id)) {
+            cost.posting_count = 0;
+            return cost;
+        }
+    }
+    const double candidate_count = static_cast<double>(std::min(document_count, cost.posting_count));
+    cost.term_at_a_time_cost = cost.posting_count * MAP_STEP_COST * std::log2(candidate_count + 1.0) + candidate_count;
+    cost.document_at_a_time_cost = candidate_count * term_count + cost.posting_count;
+    if (frozen_) {
+        // A frozen index sums into an array over all its documents instead of a map.
+        cost.term_at_a_time_cost = cost.posting_count + document_count / DENSE_SCAN_RATIO;
+    }
+    cost.strategy = cost.document_at_a_time_cost <= cost.term_at_a_time_cost ? QueryStrategy::DOCUMENT_AT_A_TIME
+                                                                             : QueryStrategy::TERM_AT_A_TIME;
+    if (query.mode_ == QueryMode::ALL) {
+        cost.strategy = QueryStrategy::CONJUNCTIVE;
+        cost.posting_count = document_count;
+        for (const int term_id : query.plus_terms_) {
+            cost.posting_count = std::min(cost.posting_count, SearchServer::GetTermDocumentCount(term_id));
+        }
+    }
+    return cost;
+}
+
+// Whether every candidate of the query has the minus term: every document of
+// each plus term in an ANY query, of some plus term in an ALL query. The walk
+// stops at the first plus document without the minus term, which in a query
+// that is not emptied is usually one of the first.
+bool SearchServer::CoversCandidates(const CompiledQuery& query, int minus_term_id) const {
+    const auto covers = [this, minus_term_id](int term_id) {
+        if (SearchServer::GetTermDocumentCount(minus_term_id) < SearchServer::GetTermDocumentCount(term_id)) {
+            return false;
+        }
+        PostingCursor minus_cursor(*this, minus_term_id);
+        for (PostingCursor cursor(*this, term_id); !cursor.IsAtEnd(); cursor.Next()) {
+            minus_cursor.SkipTo(cursor.GetDocumentKey());
+            if (minus_cursor.IsAtEnd() || minus_cursor.GetDocumentKey() != cursor.GetDocumentKey()) {
+                return false;
+            }
+        }
+        return true;
+    };
+    if (query.mode_ == QueryMode::ALL) {
+        return std::any_of(query.plus_terms_.begin(), query.plus_terms_.end(), covers);
+    }
+    return std::all_of(query.plus_terms_.begin(), query.plus_terms_.end(), covers);
+}
+
+// The most frequent minus words come first, they exclude a candidate soonest.
+std::pmr::vector<SearchServer::PostingCursor> SearchServer::OpenMinusCursors(const CompiledQuery& query,
+                                                                             std::pmr::memory_resource* resource) const {
+    std::pmr::vector<PostingCursor> cursors(resource);
+    std::pmr::vector<int> term_ids(query.minus_terms_.begin(), query.minus_terms_.end(), resource);
+    std::sort(term_ids.begin(), term_ids.end(), [this](int lhs, int rhs) {
+        return SearchServer::GetTermDocumentCount(lhs) > SearchServer::GetTermDocumentCount(rhs);
+    });
+    cursors.reserve(term_ids.size());
+    for (const int term_id : term_ids) {
+        if (SearchServer::GetTermDocumentCount(term_id) > 0) {
+            cursors.emplace_back(*this, term_id);
+        }
+    }
+    return cursors;
+}
+
+// Candidates must be checked in increasing key order: the cursors only move forward.
+bool SearchServer::IsExcluded(std::pmr::vector<PostingCursor>& minus_cursors, int document_key) {
+    for (auto& cursor : minus_cursors) {
+        cursor.SkipTo(document_key);
+        if (!cursor.IsAtEnd() && cursor.GetDocumentKey() == document_key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+SearchServer::FrozenIndex::FrozenIndex(const std::pmr::vector<std::string_view>& terms, TermFreqPrecision precision,
+                                       std::pmr::memory_resource* resource)
+    : term_hash(terms, resource)
+    , slot_to_term(resource)
+    , sorted_terms(resource)
+    , posting_offsets(resource)
+    , resident_offsets(resource)
+    , posting_documents(resource)
+    , precision(precision)
+    , posting_freqs(resource)
+    , posting_freqs_f32(resource)
+    , posting_freqs_u16(resource)
+    , posting_freqs_u8(resource)
+    , term_freq_scales(resource)
+    , bitmap_offsets(resource)
+    , bitmap_words(resource)
+    , document_ids(resource)
+    , documents_by_id(resource)
+    , ratings(resource)
+    , statuses(resource)
+    , document_term_offsets(resource)
+    , document_terms(resource) {
+}
+
+namespace {
+
+template <typename Quantized>
+double AppendQuantized(const std::pmr::vector<double>& term_freqs, std::pmr::vector<Quantized>& quantized_freqs) {
+    const double max_term_freq = term_freqs.empty() ? 1.0 : *std::max_element(term_freqs.begin(), term_freqs.end());
+    const double scale = max_term_freq / std::numeric_limits<Quantized>::max();
+    for (const double term_freq : term_freqs) {
+        quantized_freqs.push_back(static_cast<Quantized>(std::lround(term_freq / scale)));
+    }
+    return scale;
+}
+
+template <typename Stored>
+void Decode(const Stored* stored_freqs, uint32_t count, double scale, double* term_freqs) {
+    for (uint32_t i = 0; i < count; ++i) {
+        term_freqs[i] = stored_freqs[i] * scale;
+    }
+}
+
+template <typename Stored>
+void DecodeColdTermFreqs(const void* stored_freqs, uint32_t count, double scale, double* term_freqs) {
+    Decode(static_cast<const Stored*>(stored_freqs), count, scale, term_freqs);
+}
+
+}
+
+SearchServer::PostingSpan SearchServer::FrozenIndex::GetPostings(int term_id) const {
+    PostingSpan postings;
+    postings.count = posting_offsets[term_id + 1] - posting_offsets[term_id];
+    postings.first = resident_offsets.empty() ? posting_offsets[term_id] : resident_offsets[term_id];
+    if (postings.first == NOT_RESIDENT) {
+        postings.cold = cold_postings->Load(term_id);
+        postings.documents = postings.cold->documents.data();
+        postings.term_freqs = postings.cold->term_freqs.data();
+        postings.first = 0;
+        return postings;
+    }
+    postings.documents = posting_documents.data() + postings.first;
+    return postings;
+}
+
+void SearchServer::FrozenIndex::AppendTermFreqs(const std::pmr::vector<double>& term_freqs) {
+    switch (precision) {
+    case TermFreqPrecision::DOUBLE:
+        posting_freqs.insert(posting_freqs.end(), term_freqs.begin(), term_freqs.end());
+        break;
+    case TermFreqPrecision::FLOAT:
+        posting_freqs_f32.insert(posting_freqs_f32.end(), term_freqs.begin(), term_freqs.end());
+        break;
+    case TermFreqPrecision::UINT16:
+        term_freq_scales.push_back(AppendQuantized(term_freqs, posting_freqs_u16));
+        break;
+    case TermFreqPrecision::UINT8:
+        term_freq_scales.push_back(AppendQuantized(term_freqs, posting_freqs_u8));
+        break;
+    }
+}
+
+// Plain loops over one array, so that the compiler vectorizes the conversion.
+void SearchServer::FrozenIndex::DecodeTermFreqs(int term_id, uint32_t first, uint32_t count, double* term_freqs) const {
+    switch (precision) {
+    case TermFreqPrecision::DOUBLE:
+        std::copy(posting_freqs.begin() + first, posting_freqs.begin() + first + count, term_freqs);
+        break;
+    case TermFreqPrecision::FLOAT:
+        Decode(posting_freqs_f32.data() + first, count, 1.0, term_freqs);
+        break;
+    case TermFreqPrecision::UINT16:
+        Decode(posting_freqs_u16.data() + first, count, term_freq_scales[term_id], term_freqs);
+        break;
+    case TermFreqPrecision::UINT8:
+        Decode(posting_freqs_u8.data() + first, count, term_freq_scales[term_id], term_freqs);
+        break;
+    }
+}
+
+std::shared_ptr<ColdPostingStore> SearchServer::FrozenIndex::MakeColdPostingStore(const std::string& path,
+                                                                                  size_t cache_byte_count) const {
+    switch (precision) {
+    case TermFreqPrecision::FLOAT:
+        return std::make_shared<ColdPostingStore>(path, cache_byte_count, sizeof(float), DecodeColdTermFreqs<float>);
+    case TermFreqPrecision::UINT16:
+        return std::make_shared<ColdPostingStore>(path, cache_byte_count, sizeof(uint16_t), DecodeColdTermFreqs<uint16_t>);
+    case TermFreqPrecision::UINT8:
+        return std::make_shared<ColdPostingStore>(path, cache_byte_count, sizeof(uint8_t), DecodeColdTermFreqs<uint8_t>);
+    default:
+        return std::make_shared<ColdPostingStore>(path, cache_byte_count, sizeof(double), DecodeColdTermFreqs<double>);
+    }
+}
+
+void SearchServer::FrozenIndex::AppendColdPostings(ColdPostingStore& store, int term_id, uint32_t first,
+                                                   uint32_t count) const {
+    const uint32_t* documents = posting_documents.data() + first;
+    switch (precision) {
+    case TermFreqPrecision::DOUBLE:
+        store.Append(term_id, documents, posting_freqs.data() + first, 1.0, count);
+        break;
+    case TermFreqPrecision::FLOAT:
+        store.Append(term_id, documents, posting_freqs_f32.data() + first, 1.0, count);
+        break;
+    case TermFreqPrecision::UINT16:
+        store.Append(term_id, documents, posting_freqs_u16.data() + first, term_freq_scales[term_id], count);
+        break;
+    case TermFreqPrecision::UINT8:
+        store.Append(term_id, documents, posting_freqs_u8.data() + first, term_freq_scales[term_id], count);
+        break;
+    }
+}
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <array>
 #include <cmath>
+#include <cstdint>
+#include <limits>
 #include <string>
 #include <string_view>
 #include <utility>
@@ -14,41 +17,181 @@
 #include <iterator>
 #include <execution>
 #include <cassert>
+#include <type_traits>
+#include <memory>
+#include <memory_resource>
+#include <optional>
 
 #include "document.h"
 #include "string_processing.h"
 #include "concurrent_map.h"
 #include "log_duration.h"
+#include "metrics.h"
+#include "sorted_intersection.h"
+#include "search_cursor.h"
+#include "scoring_kernel.h"
+#include "scratch_arena.h"
+#include "compiled_query.h"
+#include "hashed_word_set.h"
+#include "perfect_hash.h"
+#include "query_plan.h"
+#include "word_frequencies.h"
+#include "cold_posting_store.h"
 
+// A prefix query word such as run* stands for at most this many dictionary
+// words, the first ones in lexicographic order.
+const size_t MAX_PREFIX_EXPANSION_COUNT = 64;
+
+// Every word found in more documents keeps a sample of this many of them, the
+// ones with the smallest hashes of their ids (a KMV sketch), for approximate counts.
+const size_t MATCH_COUNT_SKETCH_SIZE = 256;
+
+// EXACT counts the matching documents from the postings without scoring them.
+// APPROXIMATE checks the query and the filter on the sketches of the plus words
+// only: while all of them hold every document of their word, the count is still
+// exact; otherwise the relative standard error is about 1 / sqrt(m), where m is
+// the number of sampled documents that pass, at least the fraction of the
+// sample that passes times MATCH_COUNT_SKETCH_SIZE.
+enum class CountMode {
+    EXACT,
+    APPROXIMATE,
+};
+
+// Storage of term frequencies in a frozen index. DOUBLE is exact and FLOAT
+// keeps 24 significant bits. UINT16 and UINT8 store multiples of a per-term
+// scale, max_tf / 65535 or max_tf / 255, so a term adds at most
+// idf * max_tf / 131070 or idf * max_tf / 510 of error to a relevance.
+// Only exactly equal frequencies of a term quantize to the same value: two
+// documents whose relevances differ by less than the quantization step may
+// swap places or become tied.
+enum class TermFreqPrecision {
+    DOUBLE,
+    FLOAT,
+    UINT16,
+    UINT8,
+};
+
+// Order of the document numbers of a frozen index, which all posting lists
+// follow. SIMILARITY sorts documents by MinHash signatures of their words, so
+// documents sharing words get close numbers: posting gaps shrink and a query
+// touches fewer cache lines of the document arrays and bitmaps. RATING puts
+// the best rated documents first. Callers see the same ids in every order.
+enum class DocumentOrder {
+    ID,
+    RATING,
+    SIMILARITY,
+};
+
+// MovePostingsToDisk keeps the postings of the most frequent words in memory,
+// up to resident_posting_count postings in all, and serves the others from
+// disk through a cache of cache_byte_count bytes.
+struct TieringOptions {
+    size_t resident_posting_count = 1 << 20;
+    size_t cache_byte_count = 64 << 20;
+};
+
+// A document tokenized by SearchServer::PrepareDocument: its distinct words,
+// sorted, with their term frequencies. The words view the text passed there.
+struct PreparedDocument {
+    int id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    int rating = 0;
+    std::pmr::vector<std::pair<std::string_view, double>> word_freqs;
+};
+
+template <typename ExecutionPolicy>
+using EnableIfExecutionPolicy = std::enable_if_t<std::is_execution_policy_v<std::decay_t<ExecutionPolicy>>, bool>;
+
+// The index is allocated from the memory resource passed to the constructor, the
+// default resource otherwise. The resource must outlive the server and, for the
+// parallel RemoveDocument, tolerate concurrent deallocation. Temporary data of
+// requests comes from the ScratchArena of the calling thread, except in the
+// parallel ANY search: the arena is not shared between threads, so its
+// ConcurrentMap of relevances is allocated on the heap on every query.
+// Freeze converts the index into flat arrays with a perfect-hash dictionary;
+// a frozen server answers the same queries, and mutating it is a logic error.
+// A query is evaluated term at a time or document at a time, whichever is
+// estimated to visit fewer postings; ExplainQuery shows the chosen plan.
 class SearchServer {
+    friend class ShardedSearchServer;
+    friend class ShardServer;
+    friend class WordFrequencies;
+
 public:
 
     SearchServer() = default;
     template <typename StringContainer>
-    explicit SearchServer(const StringContainer&);
-    explicit SearchServer(const std::string_view);
-    explicit SearchServer(const std::string&);
+    explicit SearchServer(const StringContainer&, std::pmr::memory_resource* = std::pmr::get_default_resource());
+    explicit SearchServer(const std::string_view, std::pmr::memory_resource* = std::pmr::get_default_resource());
+    explicit SearchServer(const std::string&, std::pmr::memory_resource* = std::pmr::get_default_resource());
     void AddDocument(int, std::string_view, DocumentStatus, const std::vector<int>&);
+    // Reads only the stop words, so it may run on other threads while the
+    // server is being modified; AddPreparedDocument then indexes the result.
+    PreparedDocument PrepareDocument(int, std::string_view, DocumentStatus, const std::vector<int>&,
+                                     std::pmr::memory_resource* = std::pmr::get_default_resource()) const;
+    void AddPreparedDocument(const PreparedDocument&);
     template <typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(std::string_view, DocumentPredicate) const;
     std::vector<Document> FindTopDocuments(std::string_view, DocumentStatus) const;
     std::vector<Document> FindTopDocuments(std::string_view) const;
-    template <typename ExecutionPolicy, typename DocumentPredicate>
+    template <typename ExecutionPolicy, typename DocumentPredicate, EnableIfExecutionPolicy<ExecutionPolicy> = true>
     std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view, DocumentPredicate) const;
-    template <typename ExecutionPolicy>
+    template <typename ExecutionPolicy, EnableIfExecutionPolicy<ExecutionPolicy> = true>
     std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view, DocumentStatus) const;
-    template <typename ExecutionPolicy>
+    template <typename ExecutionPolicy, EnableIfExecutionPolicy<ExecutionPolicy> = true>
     std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view) const;
-    std::set<int>::const_iterator begin() const;
-    std::set<int>::const_iterator end() const;
+    std::vector<Document> FindTopDocuments(std::string_view, size_t, size_t) const;
+    CompiledQuery CompileQuery(std::string_view, QueryMode = QueryMode::ANY) const;
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const CompiledQuery&, DocumentPredicate) const;
+    std::vector<Document> FindTopDocuments(const CompiledQuery&, DocumentStatus) const;
+    std::vector<Document> FindTopDocuments(const CompiledQuery&) const;
+    template <typename DocumentPredicate>
+    size_t CountMatches(std::string_view, DocumentPredicate, CountMode = CountMode::EXACT) const;
+    size_t CountMatches(std::string_view, DocumentStatus, CountMode = CountMode::EXACT) const;
+    size_t CountMatches(std::string_view) const;
+    template <typename DocumentPredicate>
+    size_t CountMatches(const CompiledQuery&, DocumentPredicate, CountMode = CountMode::EXACT) const;
+    size_t CountMatches(const CompiledQuery&, DocumentStatus, CountMode = CountMode::EXACT) const;
+    size_t CountMatches(const CompiledQuery&) const;
+    QueryPlan ExplainQuery(std::string_view) const;
+    QueryPlan ExplainQuery(const CompiledQuery&) const;
+    template <typename DocumentPredicate>
+    SearchCursor OpenSearchCursor(std::string_view, DocumentPredicate) const;
+    SearchCursor OpenSearchCursor(std::string_view, DocumentStatus) const;
+    SearchCursor OpenSearchCursor(std::string_view) const;
+    std::pmr::set<int>::const_iterator begin() const;
+    std::pmr::set<int>::const_iterator end() const;
     size_t GetDocumentCount() const;
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view, int) const;
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::sequenced_policy&, std::string_view, int) const;
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::parallel_policy&, std::string_view, int) const;
-    const std::map<std::string_view, double>& GetWordFrequencies(int) const;
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const CompiledQuery&, int) const;
+    std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocuments(std::string_view, const std::vector<int>&) const;
+    std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocuments(const std::execution::sequenced_policy&, std::string_view, const std::vector<int>&) const;
+    std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocuments(const std::execution::parallel_policy&, std::string_view, const std::vector<int>&) const;
+    WordFrequencies GetWordFrequencies(int) const;
     void RemoveDocument(int);
     void RemoveDocument(const std::execution::sequenced_policy&, int);
     void RemoveDocument(const std::execution::parallel_policy&, int);
+    void Freeze(TermFreqPrecision = TermFreqPrecision::DOUBLE, DocumentOrder = DocumentOrder::ID);
+    bool IsFrozen() const;
+    // A frozen index only. Writes the postings of the words outside the resident
+    // budget to the file, which is overwritten and must stay in place while the
+    // server lives, and releases them. Document attributes, the dictionary and
+    // the bitmaps stay in memory.
+    void MovePostingsToDisk(const std::string&, const TieringOptions& = {});
+    // Reads the on-disk postings of the words of the queries, say from a query
+    // log, into the cache; words found repeatedly get promoted like in real traffic.
+    void WarmUp(const std::vector<std::string>&) const;
+    PostingCacheStats GetPostingCacheStats() const;
+    // Plus words of an ANY query found in more than this share of the documents
+    // are not scored while the query has a rarer plus word: each adds at most
+    // term_freq * log(1 / ratio) to a relevance yet costs a visit per posting,
+    // and documents with no other plus word are not matched. Minus words, ALL
+    // queries and MatchDocument are not affected. 1 keeps every word; must not
+    // change while queries run.
+    void SetCommonWordRatio(double);
 
 private:
     struct DocumentData {
@@ -59,38 +202,275 @@ private:
         std::string_view data;
         bool is_minus;
         bool is_stop;
+        bool is_prefix;
+    };
+    // The postings of a term: views of the resident arrays, or of a list read
+    // from disk, which cold holds in memory.
+    struct PostingSpan {
+        const uint32_t* documents = nullptr;
+        // Set for postings read from disk, the resident ones are decoded by position.
+        const double* term_freqs = nullptr;
+        uint32_t first = 0;
+        uint32_t count = 0;
+        std::shared_ptr<const ColdPostingStore::Postings> cold;
+    };
+    // Documents are numbered densely in the DocumentOrder given to Freeze;
+    // postings and the forward index refer to documents by these numbers.
+    struct FrozenIndex {
+        FrozenIndex(const std::pmr::vector<std::string_view>&, TermFreqPrecision, std::pmr::memory_resource*);
+
+        void AppendTermFreqs(const std::pmr::vector<double>&);
+        PostingSpan GetPostings(int) const;
+        // Decodes the frequencies of postings [first, first + count) of the term.
+        void DecodeTermFreqs(int, uint32_t, uint32_t, double*) const;
+        // A store that keeps frequencies in the encoding of this index, so cold
+        // postings score exactly as resident ones.
+        std::shared_ptr<ColdPostingStore> MakeColdPostingStore(const std::string&, size_t) const;
+        // Writes postings [first, first + count) of the term to the store as they are stored here.
+        void AppendColdPostings(ColdPostingStore&, int, uint32_t, uint32_t) const;
+        double GetTermFreq(int term_id, uint32_t position) const {
+            switch (precision) {
+            case TermFreqPrecision::FLOAT:
+                return posting_freqs_f32[position];
+            case TermFreqPrecision::UINT16:
+                return posting_freqs_u16[position] * term_freq_scales[term_id];
+            case TermFreqPrecision::UINT8:
+                return posting_freqs_u8[position] * term_freq_scales[term_id];
+            default:
+                return posting_freqs[position];
+            }
+        }
+        // Returns the bitmap over document numbers of the term, nullptr if it has none.
+        const uint64_t* GetBitmap(int term_id) const {
+            return bitmap_offsets[term_id] == NO_BITMAP ? nullptr : bitmap_words.data() + bitmap_offsets[term_id];
+        }
+        size_t GetBitmapWordCount() const {
+            return (document_ids.size() + 63) / 64;
+        }
+
+        static constexpr uint32_t NO_BITMAP = ~0u;
+        static constexpr uint32_t NOT_RESIDENT = ~0u;
+        static constexpr size_t BITMAP_DENSITY = 32;
+
+        PerfectHash term_hash;
+        std::pmr::vector<int> slot_to_term;
+        std::pmr::vector<int> sorted_terms;
+        // The differences give the document counts of the terms. Once postings
+        // are moved to disk the arrays keep only the resident terms, starting at
+        // resident_offsets, NOT_RESIDENT for the others.
+        std::pmr::vector<uint32_t> posting_offsets;
+        std::pmr::vector<uint32_t> resident_offsets;
+        std::shared_ptr<const ColdPostingStore> cold_postings;
+        std::pmr::vector<uint32_t> posting_documents;
+        // Only the array of the chosen precision is filled.
+        TermFreqPrecision precision;
+        std::pmr::vector<double> posting_freqs;
+        std::pmr::vector<float> posting_freqs_f32;
+        std::pmr::vector<uint16_t> posting_freqs_u16;
+        std::pmr::vector<uint8_t> posting_freqs_u8;
+        std::pmr::vector<double> term_freq_scales;
+        // Terms found in at least 1 / BITMAP_DENSITY of the documents also get a
+        // bitmap, no larger than their posting array, for intersections.
+        std::pmr::vector<uint32_t> bitmap_offsets;
+        std::pmr::vector<uint64_t> bitmap_words;
+        std::pmr::vector<int> document_ids;
+        // Document numbers sorted by id.
+        std::pmr::vector<uint32_t> documents_by_id;
+        std::pmr::vector<int> ratings;
+        std::pmr::vector<DocumentStatus> statuses;
+        std::pmr::vector<uint32_t> document_term_offsets;
+        std::pmr::vector<int> document_terms;
+    };
+    // Walks the postings of one term in document id order in either representation of the index.
+    class PostingCursor {
+    public:
+        PostingCursor(const SearchServer& server, int term_id)
+            : server_(&server)
+            , frozen_(server.frozen_ ? &*server.frozen_ : nullptr) {
+            term_id_ = term_id;
+            if (frozen_) {
+                span_ = frozen_->GetPostings(term_id);
+            }
+            else {
+                postings_ = &server.term_to_document_freqs_[term_id];
+                it_ = postings_->begin();
+                end_ = postings_->end();
+            }
+        }
+
+        bool IsAtEnd() const {
+            return frozen_ ? position_ == span_.count : it_ == end_;
+        }
+        int GetDocumentId() const {
+            return frozen_ ? frozen_->document_ids[span_.documents[position_]] : it_->first;
+        }
+        int GetTermId() const {
+            return term_id_;
+        }
+        // The position of the current document in posting order: its number in
+        // a frozen index, its id otherwise. Cursors are merged by keys.
+        int GetDocumentKey() const {
+            return frozen_ ? static_cast<int>(span_.documents[position_]) : it_->first;
+        }
+        double GetTermFreq() const {
+            if (!frozen_) {
+                return it_->second;
+            }
+            return span_.term_freqs ? span_.term_freqs[position_] : frozen_->GetTermFreq(term_id_, span_.first + position_);
+        }
+        DocumentData GetDocumentData() const {
+            if (frozen_) {
+                const uint32_t document = span_.documents[position_];
+                return { frozen_->ratings[document], frozen_->statuses[document] };
+            }
+            return server_->documents_.at(it_->first);
+        }
+        void Next() {
+            if (frozen_) {
+                ++position_;
+            }
+            else {
+                ++it_;
+            }
+        }
+        // Moves to the first posting with a key not less than document_key: by
+        // galloping in a frozen index, by a few steps or a tree search in a map.
+        void SkipTo(int document_key) {
+            if (frozen_) {
+                position_ = static_cast<uint32_t>(
+                    GallopLowerBound(span_.documents + position_, span_.documents + span_.count,
+                                     static_cast<uint32_t>(document_key))
+                    - span_.documents);
+                return;
+            }
+            const int LINEAR_STEP_COUNT = 8;
+            for (int step = 0; step < LINEAR_STEP_COUNT; ++step) {
+                if (it_ == end_ || it_->first >= document_key) {
+                    return;
+                }
+                ++it_;
+            }
+            if (it_ != end_ && it_->first < document_key) {
+                it_ = postings_->lower_bound(document_key);
+            }
+        }
+
+    private:
+        const SearchServer* server_;
+        const FrozenIndex* frozen_;
+        const std::pmr::map<int, double>* postings_ = nullptr;
+        std::pmr::map<int, double>::const_iterator it_;
+        std::pmr::map<int, double>::const_iterator end_;
+        int term_id_ = 0;
+        PostingSpan span_;
+        uint32_t position_ = 0;
+    };
+    struct QueryCost {
+        QueryStrategy strategy;
+        size_t posting_count;
+        double term_at_a_time_cost;
+        double document_at_a_time_cost;
     };
     struct Query {
-        std::vector<std::string_view> plus_words;
-        std::vector<std::string_view> minus_words;
+        std::pmr::vector<std::string_view> plus_words;
+        std::pmr::vector<std::string_view> minus_words;
+        std::pmr::vector<std::string_view> plus_prefixes;
+        std::pmr::vector<std::string_view> minus_prefixes;
     };
-    const std::set<std::string, std::less<>> stop_words_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, std::map<std::string_view, double>> document_to_word_;
-    std::map<int, DocumentData> documents_;
-    std::set<int> document_ids_;
-    std::deque<std::string> storage_;
+    const HashedWordSet stop_words_;
+    std::pmr::vector<std::pmr::map<int, double>> term_to_document_freqs_;
+    // Sorted by the hashes of the ids, empty for words in at most MATCH_COUNT_SKETCH_SIZE documents.
+    std::pmr::vector<std::pmr::vector<int>> term_sketches_;
+    std::pmr::map<int, std::pmr::vector<int>> document_to_term_ids_;
+    std::pmr::map<std::string_view, int> word_to_term_id_;
+    std::pmr::vector<std::string_view> term_id_to_word_;
+    std::pmr::map<int, DocumentData> documents_;
+    std::pmr::set<int> document_ids_;
+    std::pmr::deque<std::pmr::string> storage_;
+    std::optional<FrozenIndex> frozen_;
+    double common_word_ratio_ = 1.0;
 
     bool IsStopWord(std::string_view) const;
     static bool IsValidWord(std::string_view);
-    std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view) const;
+    std::pmr::vector<std::string_view> SplitIntoWordsNoStop(std::string_view, std::pmr::memory_resource*) const;
     static int ComputeAverageRating(const std::vector<int>&);
+    void IndexDocument(const PreparedDocument&);
     QueryWord ParseQueryWord(std::string_view) const;
-    Query ParseQuery(std::string_view, bool = true) const;
-    double ComputeWordInverseDocumentFreq(std::string_view) const;
+    Query ParseQuery(std::string_view, std::pmr::memory_resource*) const;
+    void ExpandQuery(Query&) const;
+    void CheckNotFrozen() const;
+    int GetOrAddTermId(std::string_view);
+    static uint64_t HashId(int);
+    std::pmr::vector<int> OrderDocuments(DocumentOrder, std::pmr::memory_resource*) const;
+    void AddToSketch(int, int);
+    void RemoveFromSketch(int, int);
+    void RebuildSketch(int);
+    int FindTermId(std::string_view) const;
+    size_t FindFrozenDocument(int) const;
+    DocumentData GetDocumentData(int) const;
+    std::pair<const int*, const int*> GetDocumentTerms(int) const;
+    size_t GetTermDocumentCount(int) const;
+    double GetDocumentTermFreq(int, int) const;
+    template <typename Func>
+    void ForEachPosting(int, Func) const;
+    CompiledQuery CompileQuery(std::string_view, std::pmr::memory_resource*, QueryMode = QueryMode::ANY) const;
+    CompiledQuery ResolveQuery(const Query&, std::pmr::memory_resource*) const;
+    void SortQueryTerms(CompiledQuery&) const;
+    template <typename Func>
+    void ForEachPrefixTerm(std::string_view, Func) const;
+    void CheckQueryServer(const CompiledQuery&) const;
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchTerms(const CompiledQuery&, int) const;
+    size_t GetWordDocumentCount(std::string_view) const;
+    double ComputeTermInverseDocumentFreq(int) const;
+    bool IsCommonTerm(int) const;
+    std::optional<CompiledQuery> DropCommonTerms(const CompiledQuery&, std::pmr::memory_resource*) const;
+    QueryCost EstimateQueryCost(const CompiledQuery&) const;
+    bool CoversCandidates(const CompiledQuery&, int) const;
+    std::pmr::vector<PostingCursor> OpenMinusCursors(const CompiledQuery&, std::pmr::memory_resource*) const;
+    static bool IsExcluded(std::pmr::vector<PostingCursor>&, int);
+    bool MatchesQueryTerms(const CompiledQuery&, int) const;
+    template <typename Func>
+    void ForEachConjunctiveMatch(const CompiledQuery&, std::pmr::vector<PostingCursor>&, Func) const;
+    template <typename DocumentPredicate, typename InverseDocumentFreq>
+    void FindAllDocumentsTermAtATime(const CompiledQuery&, DocumentPredicate, InverseDocumentFreq,
+                                     std::pmr::vector<PostingCursor>&, std::pmr::vector<Document>&) const;
+    template <typename DocumentPredicate, typename InverseDocumentFreq>
+    void FindAllDocumentsDense(const CompiledQuery&, DocumentPredicate, InverseDocumentFreq,
+                               std::pmr::vector<PostingCursor>&, std::pmr::vector<Document>&) const;
+    template <typename DocumentPredicate, typename InverseDocumentFreq>
+    void FindAllDocumentsDocumentAtATime(const CompiledQuery&, DocumentPredicate, InverseDocumentFreq,
+                                         std::pmr::vector<PostingCursor>&, std::pmr::vector<Document>&) const;
+    template <typename DocumentPredicate, typename InverseDocumentFreq>
+    void FindAllDocumentsConjunctive(const CompiledQuery&, DocumentPredicate, InverseDocumentFreq,
+                                     std::pmr::vector<Document>&) const;
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const Query&, DocumentPredicate) const;
+    std::pmr::vector<Document> FindAllDocuments(const CompiledQuery&, DocumentPredicate) const;
+    template <typename DocumentPredicate, typename InverseDocumentFreq>
+    std::pmr::vector<Document> FindAllDocuments(const CompiledQuery&, DocumentPredicate, InverseDocumentFreq) const;
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const std::execution::sequenced_policy&, const Query&, DocumentPredicate) const;
+    std::pmr::vector<Document> FindAllDocuments(const std::execution::sequenced_policy&, const CompiledQuery&, DocumentPredicate) const;
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const std::execution::parallel_policy&, const Query&, DocumentPredicate) const;
+    std::pmr::vector<Document> FindAllDocuments(const std::execution::parallel_policy&, const CompiledQuery&, DocumentPredicate) const;
+    template <typename DocumentPredicate>
+    size_t CountMatchesExactly(const CompiledQuery&, DocumentPredicate) const;
+    template <typename DocumentPredicate>
+    size_t EstimateMatchCount(const CompiledQuery&, DocumentPredicate) const;
+    static std::vector<Document> TakeTopDocuments(std::pmr::vector<Document>&);
 };
 
 template <typename StringContainer>
-SearchServer::SearchServer(const StringContainer& stop_words)
-    : stop_words_(MakeUniqueNonEmptyStrings(stop_words))
+SearchServer::SearchServer(const StringContainer& stop_words, std::pmr::memory_resource* resource)
+    : stop_words_(stop_words)
+    , term_to_document_freqs_(resource)
+    , term_sketches_(resource)
+    , document_to_term_ids_(resource)
+    , word_to_term_id_(resource)
+    , term_id_to_word_(resource)
+    , documents_(resource)
+    , document_ids_(resource)
+    , storage_(resource)
 {
-    if (!std::all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
+    if (!std::all_of(stop_words.begin(), stop_words.end(), IsValidWord)) {
         throw std::invalid_argument("Some of stop words are invalid");
     }
 }
@@ -98,43 +478,46 @@ SearchServer::SearchServer(const StringContainer& stop_words)
 template <typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query,
                                                      DocumentPredicate document_predicate) const {
-    const size_t MAX_RESULT_DOCUMENT_COUNT = 5;
-    const double EPSILON = 1e-6;
-    const auto query = ParseQuery(raw_query);
+    METRICS_OPERATION(Operation::FIND_TOP_DOCUMENTS);
+    const ScratchScope scratch;
+    const auto query = CompileQuery(raw_query, scratch.GetResource());
+    METRICS_LAP(Phase::PARSE);
     auto matched_documents = FindAllDocuments(query, document_predicate);
-    std::sort(matched_documents.begin(), matched_documents.end(),
-              [EPSILON](const Document& lhs, const Document& rhs) {
-                  if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
-                      return lhs.rating > rhs.rating;
-                  }
-                  return lhs.relevance > rhs.relevance; });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-    }
-    return matched_documents;
+    std::sort(matched_documents.begin(), matched_documents.end(), IsMoreRelevant);
+    auto result = TakeTopDocuments(matched_documents);
+    METRICS_LAP(Phase::SORT);
+    return result;
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const CompiledQuery& query,
+                                                     DocumentPredicate document_predicate) const {
+    SearchServer::CheckQueryServer(query);
+    METRICS_OPERATION(Operation::FIND_TOP_DOCUMENTS);
+    const ScratchScope scratch;
+    auto matched_documents = FindAllDocuments(query, document_predicate);
+    std::sort(matched_documents.begin(), matched_documents.end(), IsMoreRelevant);
+    auto result = TakeTopDocuments(matched_documents);
+    METRICS_LAP(Phase::SORT);
+    return result;
 }
 
-template <typename ExecutionPolicy, typename DocumentPredicate>
+template <typename ExecutionPolicy, typename DocumentPredicate, EnableIfExecutionPolicy<ExecutionPolicy>>
 std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, 
                                                      std::string_view raw_query, 
                                                      DocumentPredicate document_predicate) const {
-    const size_t MAX_RESULT_DOCUMENT_COUNT = 5;
-    const double EPSILON = 1e-6;
-    const auto query = ParseQuery(raw_query);
+    METRICS_OPERATION(Operation::FIND_TOP_DOCUMENTS);
+    const ScratchScope scratch;
+    const auto query = CompileQuery(raw_query, scratch.GetResource());
+    METRICS_LAP(Phase::PARSE);
     auto matched_documents = FindAllDocuments(policy, query, document_predicate);
-    std::sort(policy, matched_documents.begin(), matched_documents.end(),
-        [EPSILON](const Document& lhs, const Document& rhs) {
-            if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
-                return lhs.rating > rhs.rating;
-            }
-            return lhs.relevance > rhs.relevance; });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-    }
-    return matched_documents;
+    std::sort(policy, matched_documents.begin(), matched_documents.end(), IsMoreRelevant);
+    auto result = TakeTopDocuments(matched_documents);
+    METRICS_LAP(Phase::SORT);
+    return result;
 }
 
-template <typename ExecutionPolicy>
+template <typename ExecutionPolicy, EnableIfExecutionPolicy<ExecutionPolicy>>
 std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, 
                                                      std::string_view raw_query,
                                                      DocumentStatus status) const {
@@ -143,80 +526,569 @@ std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& poli
             return document_status == status; });
 }
 
-template <typename ExecutionPolicy>
+template <typename ExecutionPolicy, EnableIfExecutionPolicy<ExecutionPolicy>>
 std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, 
                                                      std::string_view raw_query) const {
     return SearchServer::FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& query,
-                                                     DocumentPredicate document_predicate) const {
-    std::map<int, double> document_to_relevance;
-    for (std::string_view word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
+SearchCursor SearchServer::OpenSearchCursor(std::string_view raw_query, DocumentPredicate document_predicate) const {
+    METRICS_OPERATION(Operation::FIND_TOP_DOCUMENTS);
+    const ScratchScope scratch;
+    const auto query = CompileQuery(raw_query, scratch.GetResource());
+    METRICS_LAP(Phase::PARSE);
+    const auto matched_documents = FindAllDocuments(query, document_predicate);
+    return SearchCursor(std::vector<Document>(matched_documents.begin(), matched_documents.end()));
+}
+
+template <typename DocumentPredicate>
+size_t SearchServer::CountMatches(std::string_view raw_query, DocumentPredicate document_predicate, CountMode mode) const {
+    const ScratchScope scratch;
+    const auto query = CompileQuery(raw_query, scratch.GetResource());
+    return mode == CountMode::EXACT ? CountMatchesExactly(query, document_predicate)
+                                    : EstimateMatchCount(query, document_predicate);
+}
+
+template <typename DocumentPredicate>
+size_t SearchServer::CountMatches(const CompiledQuery& query, DocumentPredicate document_predicate, CountMode mode) const {
+    SearchServer::CheckQueryServer(query);
+    const ScratchScope scratch;
+    return mode == CountMode::EXACT ? CountMatchesExactly(query, document_predicate)
+                                    : EstimateMatchCount(query, document_predicate);
+}
+
+// An ALL query walks the intersection. Otherwise a frozen index ORs the plus
+// postings into a bitmap over document numbers and clears the minus ones, and
+// a mutable index merges the plus posting lists; either way the predicate is
+// the only per-document work.
+template <typename DocumentPredicate>
+size_t SearchServer::CountMatchesExactly(const CompiledQuery& query, DocumentPredicate document_predicate) const {
+    std::pmr::memory_resource* resource = &ScratchArena::ForCurrentThread();
+    if (const auto narrowed_query = DropCommonTerms(query, resource)) {
+        return CountMatchesExactly(*narrowed_query, document_predicate);
+    }
+    if (EstimateQueryCost(query).strategy == QueryStrategy::EMPTY) {
+        return 0;
+    }
+    size_t count = 0;
+    if (query.mode_ == QueryMode::ALL) {
+        std::pmr::vector<PostingCursor> cursors(resource);
+        ForEachConjunctiveMatch(query, cursors, [&](int, int document_id, const DocumentData& document_data) {
+            count += document_predicate(document_id, document_data.status, document_data.rating) ? 1 : 0;
+        });
+        return count;
+    }
+    if (frozen_) {
+        const auto& index = *frozen_;
+        std::pmr::vector<uint64_t> bits(index.GetBitmapWordCount(), 0, resource);
+        const auto apply = [&](int term_id, bool is_minus) {
+            if (const uint64_t* bitmap = index.GetBitmap(term_id)) {
+                for (size_t word = 0; word < bits.size(); ++word) {
+                    bits[word] = is_minus ? bits[word] & ~bitmap[word] : bits[word] | bitmap[word];
+                }
+                return;
+            }
+            const auto postings = index.GetPostings(term_id);
+            for (uint32_t i = 0; i < postings.count; ++i) {
+                const uint32_t document = postings.documents[i];
+                const uint64_t bit = uint64_t{1} << (document % 64);
+                bits[document / 64] = is_minus ? bits[document / 64] & ~bit : bits[document / 64] | bit;
+            }
+        };
+        for (const int term_id : query.plus_terms_) {
+            apply(term_id, false);
+        }
+        for (const int term_id : query.minus_terms_) {
+            apply(term_id, true);
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto& [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-            const auto& document_data = documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+        for (size_t word = 0; word < bits.size(); ++word) {
+            for (uint64_t word_bits = bits[word]; word_bits != 0; word_bits &= word_bits - 1) {
+                const size_t document = word * 64 + __builtin_ctzll(word_bits);
+                count += document_predicate(index.document_ids[document], index.statuses[document], index.ratings[document]) ? 1 : 0;
             }
         }
+        return count;
+    }
+    std::pmr::vector<PostingCursor> cursors(resource);
+    for (const int term_id : query.plus_terms_) {
+        if (GetTermDocumentCount(term_id) > 0) {
+            cursors.emplace_back(*this, term_id);
+        }
+    }
+    auto minus_cursors = OpenMinusCursors(query, resource);
+    while (true) {
+        const PostingCursor* lead = nullptr;
+        for (const auto& cursor : cursors) {
+            if (!cursor.IsAtEnd() && (lead == nullptr || cursor.GetDocumentKey() < lead->GetDocumentKey())) {
+                lead = &cursor;
+            }
+        }
+        if (lead == nullptr) {
+            break;
+        }
+        const int document_key = lead->GetDocumentKey();
+        const int document_id = lead->GetDocumentId();
+        const auto document_data = lead->GetDocumentData();
+        if (!IsExcluded(minus_cursors, document_key) && document_predicate(document_id, document_data.status, document_data.rating)) {
+            ++count;
+        }
+        for (auto& cursor : cursors) {
+            if (!cursor.IsAtEnd() && cursor.GetDocumentKey() == document_key) {
+                cursor.Next();
+            }
+        }
+    }
+    return count;
+}
+
+// The sample is the union of the plus word sketches cut to the
+// MATCH_COUNT_SKETCH_SIZE smallest hashes, a word without a sketch contributing
+// all its documents; a union of n documents has its k-th smallest hash near
+// k / n, which gives its size. An ALL query samples its rarest word instead,
+// whose document count is known. The estimate scales the size by the share of
+// the sample that matches the query and the predicate.
+template <typename DocumentPredicate>
+size_t SearchServer::EstimateMatchCount(const CompiledQuery& query, DocumentPredicate document_predicate) const {
+    std::pmr::memory_resource* resource = &ScratchArena::ForCurrentThread();
+    if (const auto narrowed_query = DropCommonTerms(query, resource)) {
+        return EstimateMatchCount(*narrowed_query, document_predicate);
+    }
+    if (EstimateQueryCost(query).strategy == QueryStrategy::EMPTY) {
+        return 0;
+    }
+    std::pmr::vector<int> sampled_terms(resource);
+    for (const int term_id : query.plus_terms_) {
+        if (GetTermDocumentCount(term_id) > 0) {
+            sampled_terms.push_back(term_id);
+        }
+    }
+    if (query.mode_ == QueryMode::ALL) {
+        const int rarest = *std::min_element(sampled_terms.begin(), sampled_terms.end(), [this](int lhs, int rhs) {
+            return GetTermDocumentCount(lhs) < GetTermDocumentCount(rhs);
+        });
+        sampled_terms.assign(1, rarest);
     }
-    for (std::string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+    std::pmr::vector<std::pair<uint64_t, int>> sample(resource);
+    bool is_complete = true;
+    for (const int term_id : sampled_terms) {
+        const auto& sketch = term_sketches_[term_id];
+        if (sketch.empty()) {
+            ForEachPosting(term_id, [&sample](int, int document_id, double, DocumentStatus, int) {
+                sample.emplace_back(HashId(document_id), document_id);
+            });
             continue;
         }
-        for (const auto& [document_id, _] : word_to_document_freqs_.at(word)) {
-            document_to_relevance.erase(document_id);
+        is_complete = false;
+        for (const int document_id : sketch) {
+            sample.emplace_back(HashId(document_id), document_id);
+        }
+    }
+    std::sort(sample.begin(), sample.end());
+    sample.erase(std::unique(sample.begin(), sample.end()), sample.end());
+    if (!is_complete) {
+        sample.resize(std::min(sample.size(), MATCH_COUNT_SKETCH_SIZE));
+    }
+    size_t matched_count = 0;
+    for (const auto& [hash, document_id] : sample) {
+        const auto document_data = GetDocumentData(document_id);
+        if (MatchesQueryTerms(query, document_id) && document_predicate(document_id, document_data.status, document_data.rating)) {
+            ++matched_count;
+        }
+    }
+    if (is_complete) {
+        return matched_count;
+    }
+    double population = static_cast<double>(GetTermDocumentCount(sampled_terms.front()));
+    if (sampled_terms.size() > 1) {
+        const double max_hash = static_cast<double>(std::numeric_limits<uint64_t>::max());
+        population = (sample.size() - 1) / (static_cast<double>(sample.back().first) / max_hash);
+        population = std::min(population, static_cast<double>(GetDocumentCount()));
+    }
+    return static_cast<size_t>(std::llround(population * matched_count / sample.size()));
+}
+
+// Calls func(term_id) for the dictionary words starting with the prefix in
+// lexicographic order, skipping words without documents, up to the expansion limit.
+template <typename Func>
+void SearchServer::ForEachPrefixTerm(std::string_view prefix, Func func) const {
+    size_t expansion_count = 0;
+    const auto visit = [this, &func, &expansion_count](int term_id) {
+        if (GetTermDocumentCount(term_id) > 0) {
+            func(term_id);
+            ++expansion_count;
+        }
+        return expansion_count < MAX_PREFIX_EXPANSION_COUNT;
+    };
+    const auto has_prefix = [prefix](std::string_view word) { return word.substr(0, prefix.size()) == prefix; };
+    if (frozen_) {
+        const auto& sorted_terms = frozen_->sorted_terms;
+        auto it = std::lower_bound(sorted_terms.begin(), sorted_terms.end(), prefix,
+                                   [this](int term_id, std::string_view word) { return term_id_to_word_[term_id] < word; });
+        for (; it != sorted_terms.end() && has_prefix(term_id_to_word_[*it]) && visit(*it); ++it) {
+        }
+        return;
+    }
+    for (auto it = word_to_term_id_.lower_bound(prefix); it != word_to_term_id_.end() && has_prefix(it->first) && visit(it->second); ++it) {
+    }
+}
+
+// Calls func(document_key, document_id, term_freq, status, rating) for the
+// postings of the term in key order (see PostingCursor::GetDocumentKey).
+template <typename Func>
+void SearchServer::ForEachPosting(int term_id, Func func) const {
+    if (frozen_) {
+        const uint32_t BLOCK_SIZE = 128;
+        const auto& index = *frozen_;
+        const auto postings = index.GetPostings(term_id);
+        double block_freqs[BLOCK_SIZE];
+        for (uint32_t block = 0; block < postings.count; block += BLOCK_SIZE) {
+            const uint32_t count = std::min(BLOCK_SIZE, postings.count - block);
+            const double* term_freqs = postings.term_freqs ? postings.term_freqs + block : block_freqs;
+            if (!postings.term_freqs) {
+                index.DecodeTermFreqs(term_id, postings.first + block, count, block_freqs);
+            }
+            for (uint32_t i = 0; i < count; ++i) {
+                const uint32_t document = postings.documents[block + i];
+                func(static_cast<int>(document), index.document_ids[document], term_freqs[i], index.statuses[document],
+                     index.ratings[document]);
+            }
         }
+        return;
     }
-    std::vector<Document> matched_documents;
-    for (const auto& [document_id, relevance] : document_to_relevance) {
-        matched_documents.push_back(
-            { document_id, relevance, documents_.at(document_id).rating });
+    for (const auto& [document_id, term_freq] : term_to_document_freqs_[term_id]) {
+        const auto& document_data = documents_.at(document_id);
+        func(document_id, document_id, term_freq, document_data.status, document_data.rating);
     }
+}
+
+template <typename DocumentPredicate>
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const CompiledQuery& query,
+                                                          DocumentPredicate document_predicate) const {
+    return SearchServer::FindAllDocuments(query, document_predicate,
+                                          [this](int term_id) { return ComputeTermInverseDocumentFreq(term_id); });
+}
+
+// Scratch data and the result are allocated from the arena of the current thread,
+// so the caller must keep a ScratchScope open while it uses the result.
+template <typename DocumentPredicate, typename InverseDocumentFreq>
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const CompiledQuery& query, DocumentPredicate document_predicate,
+                                                          InverseDocumentFreq compute_inverse_document_freq) const {
+    std::pmr::memory_resource* resource = &ScratchArena::ForCurrentThread();
+    if (const auto narrowed_query = DropCommonTerms(query, resource)) {
+        return FindAllDocuments(*narrowed_query, document_predicate, compute_inverse_document_freq);
+    }
+    std::pmr::vector<Document> matched_documents(resource);
+    const auto cost = EstimateQueryCost(query);
+    if (cost.strategy == QueryStrategy::EMPTY) {
+        return matched_documents;
+    }
+    METRICS_COUNT(Counter::POSTINGS_VISITED, cost.posting_count);
+    if (cost.strategy == QueryStrategy::CONJUNCTIVE) {
+        FindAllDocumentsConjunctive(query, document_predicate, compute_inverse_document_freq, matched_documents);
+        METRICS_LAP(Phase::FILTER);
+        return matched_documents;
+    }
+    auto minus_cursors = OpenMinusCursors(query, resource);
+    if (cost.strategy == QueryStrategy::DOCUMENT_AT_A_TIME) {
+        FindAllDocumentsDocumentAtATime(query, document_predicate, compute_inverse_document_freq, minus_cursors, matched_documents);
+    }
+    else {
+        FindAllDocumentsTermAtATime(query, document_predicate, compute_inverse_document_freq, minus_cursors, matched_documents);
+    }
+    METRICS_LAP(Phase::FILTER);
     return matched_documents;
 }
 
+// Relevance is summed in the order of the plus terms, so both strategies
+// compute exactly the same scores.
+template <typename DocumentPredicate, typename InverseDocumentFreq>
+void SearchServer::FindAllDocumentsTermAtATime(const CompiledQuery& query, DocumentPredicate document_predicate,
+                                               InverseDocumentFreq compute_inverse_document_freq,
+                                               std::pmr::vector<PostingCursor>& minus_cursors,
+                                               std::pmr::vector<Document>& matched_documents) const {
+    if (frozen_) {
+        FindAllDocumentsDense(query, document_predicate, compute_inverse_document_freq, minus_cursors, matched_documents);
+        return;
+    }
+    std::pmr::map<int, double> key_to_relevance(matched_documents.get_allocator().resource());
+    for (const int term_id : query.plus_terms_) {
+        if (GetTermDocumentCount(term_id) == 0) {
+            continue;
+        }
+        const double inverse_document_freq = compute_inverse_document_freq(term_id);
+        ForEachPosting(term_id, [&](int document_key, int document_id, double term_freq, DocumentStatus status, int rating) {
+            if (document_predicate(document_id, status, rating)) {
+                key_to_relevance[document_key] += term_freq * inverse_document_freq;
+            }
+        });
+    }
+    METRICS_COUNT(Counter::DOCUMENTS_SCORED, key_to_relevance.size());
+    METRICS_LAP(Phase::SCORE);
+    matched_documents.reserve(key_to_relevance.size());
+    for (const auto& [document_key, relevance] : key_to_relevance) {
+        if (IsExcluded(minus_cursors, document_key)) {
+            continue;
+        }
+        matched_documents.push_back({ document_key, relevance, documents_.at(document_key).rating });
+    }
+}
+
+// A frozen index numbers its documents densely, so relevances are summed in an
+// array indexed by number. The predicate is evaluated for a block of postings
+// into a mask, then the scoring kernel adds the block; matched documents are
+// collected in number order.
+template <typename DocumentPredicate, typename InverseDocumentFreq>
+void SearchServer::FindAllDocumentsDense(const CompiledQuery& query, DocumentPredicate document_predicate,
+                                         InverseDocumentFreq compute_inverse_document_freq,
+                                         std::pmr::vector<PostingCursor>& minus_cursors,
+                                         std::pmr::vector<Document>& matched_documents) const {
+    const uint32_t BLOCK_SIZE = 128;
+    const auto& index = *frozen_;
+    const ScoringKernel kernel = GetScoringKernel();
+    std::pmr::memory_resource* resource = matched_documents.get_allocator().resource();
+    std::pmr::vector<double> relevances(index.document_ids.size(), 0.0, resource);
+    std::pmr::vector<uint8_t> matched(index.document_ids.size(), 0, resource);
+    double block_freqs[BLOCK_SIZE];
+    uint8_t block_mask[BLOCK_SIZE];
+    for (const int term_id : query.plus_terms_) {
+        if (GetTermDocumentCount(term_id) == 0) {
+            continue;
+        }
+        const double inverse_document_freq = compute_inverse_document_freq(term_id);
+        const auto postings = index.GetPostings(term_id);
+        for (uint32_t block = 0; block < postings.count; block += BLOCK_SIZE) {
+            const uint32_t count = std::min(BLOCK_SIZE, postings.count - block);
+            const uint32_t* documents = postings.documents + block;
+            const double* term_freqs = postings.term_freqs ? postings.term_freqs + block : block_freqs;
+            if (!postings.term_freqs) {
+                index.DecodeTermFreqs(term_id, postings.first + block, count, block_freqs);
+            }
+            for (uint32_t i = 0; i < count; ++i) {
+                const uint32_t document = documents[i];
+                block_mask[i] = document_predicate(index.document_ids[document], index.statuses[document],
+                                                   index.ratings[document]) ? 1 : 0;
+            }
+            AccumulateRelevance(kernel, documents, term_freqs, block_mask, count, inverse_document_freq,
+                                relevances.data(), matched.data());
+        }
+    }
+    METRICS_COUNT(Counter::DOCUMENTS_SCORED, std::count(matched.begin(), matched.end(), 1));
+    METRICS_LAP(Phase::SCORE);
+    for (size_t document = 0; document < matched.size(); ++document) {
+        if (matched[document] && !IsExcluded(minus_cursors, static_cast<int>(document))) {
+            matched_documents.push_back({ index.document_ids[document], relevances[document], index.ratings[document] });
+        }
+    }
+}
+
+template <typename DocumentPredicate, typename InverseDocumentFreq>
+void SearchServer::FindAllDocumentsDocumentAtATime(const CompiledQuery& query, DocumentPredicate document_predicate,
+                                                   InverseDocumentFreq compute_inverse_document_freq,
+                                                   std::pmr::vector<PostingCursor>& minus_cursors,
+                                                   std::pmr::vector<Document>& matched_documents) const {
+    std::pmr::memory_resource* resource = matched_documents.get_allocator().resource();
+    std::pmr::vector<PostingCursor> cursors(resource);
+    std::pmr::vector<double> inverse_document_freqs(resource);
+    cursors.reserve(query.plus_terms_.size());
+    inverse_document_freqs.reserve(query.plus_terms_.size());
+    for (const int term_id : query.plus_terms_) {
+        if (GetTermDocumentCount(term_id) > 0) {
+            cursors.emplace_back(*this, term_id);
+            inverse_document_freqs.push_back(compute_inverse_document_freq(term_id));
+        }
+    }
+    [[maybe_unused]] size_t candidate_count = 0;
+    while (true) {
+        const PostingCursor* lead = nullptr;
+        for (const auto& cursor : cursors) {
+            if (!cursor.IsAtEnd() && (lead == nullptr || cursor.GetDocumentKey() < lead->GetDocumentKey())) {
+                lead = &cursor;
+            }
+        }
+        if (lead == nullptr) {
+            break;
+        }
+        ++candidate_count;
+        const int document_key = lead->GetDocumentKey();
+        const int document_id = lead->GetDocumentId();
+        const auto document_data = lead->GetDocumentData();
+        const bool is_matched = !IsExcluded(minus_cursors, document_key)
+                                && document_predicate(document_id, document_data.status, document_data.rating);
+        double relevance = 0.0;
+        for (size_t i = 0; i < cursors.size(); ++i) {
+            auto& cursor = cursors[i];
+            if (!cursor.IsAtEnd() && cursor.GetDocumentKey() == document_key) {
+                relevance += cursor.GetTermFreq() * inverse_document_freqs[i];
+                cursor.Next();
+            }
+        }
+        if (is_matched) {
+            matched_documents.push_back({ document_id, relevance, document_data.rating });
+        }
+    }
+    METRICS_COUNT(Counter::DOCUMENTS_SCORED, candidate_count);
+    METRICS_LAP(Phase::SCORE);
+}
+
+template <typename DocumentPredicate, typename InverseDocumentFreq>
+void SearchServer::FindAllDocumentsConjunctive(const CompiledQuery& query, DocumentPredicate document_predicate,
+                                               InverseDocumentFreq compute_inverse_document_freq,
+                                               std::pmr::vector<Document>& matched_documents) const {
+    std::pmr::memory_resource* resource = matched_documents.get_allocator().resource();
+    std::pmr::vector<PostingCursor> cursors(resource);
+    std::pmr::vector<double> inverse_document_freqs(resource);
+    inverse_document_freqs.reserve(query.plus_terms_.size());
+    for (const int term_id : query.plus_terms_) {
+        inverse_document_freqs.push_back(compute_inverse_document_freq(term_id));
+    }
+    [[maybe_unused]] size_t candidate_count = 0;
+    ForEachConjunctiveMatch(query, cursors, [&](int document_key, int document_id, const DocumentData& document_data) {
+        ++candidate_count;
+        if (!document_predicate(document_id, document_data.status, document_data.rating)) {
+            return;
+        }
+        double relevance = 0.0;
+        for (size_t i = 0; i < cursors.size(); ++i) {
+            cursors[i].SkipTo(document_key);
+            relevance += cursors[i].GetTermFreq() * inverse_document_freqs[i];
+        }
+        matched_documents.push_back({ document_id, relevance, document_data.rating });
+    });
+    METRICS_COUNT(Counter::DOCUMENTS_SCORED, candidate_count);
+    METRICS_LAP(Phase::SCORE);
+}
+
+// Calls func(document_key, document_id, document_data) in key order for the
+// documents with all plus words and no minus word; cursors receives one cursor
+// per plus term, in query order, which func may move forward.
+// Candidates are the postings of the rarest plus word, or, when every plus word
+// has a bitmap, the bits of their intersection. A candidate must be in every
+// other posting list: a bit test where a bitmap exists, a galloping skip
+// otherwise. Minus words are tested the same way.
+template <typename Func>
+void SearchServer::ForEachConjunctiveMatch(const CompiledQuery& query, std::pmr::vector<PostingCursor>& cursors,
+                                           Func func) const {
+    std::pmr::memory_resource* resource = cursors.get_allocator().resource();
+    const size_t term_count = query.plus_terms_.size();
+    std::pmr::vector<size_t> order(term_count, resource);
+    cursors.reserve(term_count);
+    for (size_t i = 0; i < term_count; ++i) {
+        cursors.emplace_back(*this, query.plus_terms_[i]);
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [this, &query](size_t lhs, size_t rhs) {
+        return GetTermDocumentCount(query.plus_terms_[lhs]) < GetTermDocumentCount(query.plus_terms_[rhs]);
+    });
+    std::pmr::vector<const uint64_t*> plus_bitmaps(term_count, nullptr, resource);
+    std::pmr::vector<const uint64_t*> minus_bitmaps(resource);
+    std::pmr::vector<PostingCursor> minus_cursors(resource);
+    for (auto& cursor : OpenMinusCursors(query, resource)) {
+        const uint64_t* bitmap = frozen_ ? frozen_->GetBitmap(cursor.GetTermId()) : nullptr;
+        if (bitmap) {
+            minus_bitmaps.push_back(bitmap);
+        }
+        else {
+            minus_cursors.push_back(cursor);
+        }
+    }
+    if (frozen_) {
+        for (size_t i = 0; i < term_count; ++i) {
+            plus_bitmaps[i] = frozen_->GetBitmap(query.plus_terms_[i]);
+        }
+    }
+    const auto has_bit = [](const uint64_t* bitmap, int document) {
+        return ((bitmap[document / 64] >> (document % 64)) & 1) != 0;
+    };
+    const auto accept = [&](int document_key, int document_id, const DocumentData& document_data) {
+        for (const uint64_t* bitmap : minus_bitmaps) {
+            if (has_bit(bitmap, document_key)) {
+                return;
+            }
+        }
+        if (!IsExcluded(minus_cursors, document_key)) {
+            func(document_key, document_id, document_data);
+        }
+    };
+
+    if (std::all_of(plus_bitmaps.begin(), plus_bitmaps.end(), [](const uint64_t* bitmap) { return bitmap != nullptr; })) {
+        const auto& index = *frozen_;
+        for (size_t word = 0; word < index.GetBitmapWordCount(); ++word) {
+            uint64_t bits = ~uint64_t{0};
+            for (const uint64_t* bitmap : plus_bitmaps) {
+                bits &= bitmap[word];
+            }
+            for (const uint64_t* bitmap : minus_bitmaps) {
+                bits &= ~bitmap[word];
+            }
+            for (; bits != 0; bits &= bits - 1) {
+                const auto document = static_cast<int>(word * 64 + __builtin_ctzll(bits));
+                accept(document, index.document_ids[document], { index.ratings[document], index.statuses[document] });
+            }
+        }
+        return;
+    }
+    auto& lead = cursors[order.front()];
+    for (; !lead.IsAtEnd(); lead.Next()) {
+        const int document_key = lead.GetDocumentKey();
+        const bool is_in_all = std::all_of(order.begin() + 1, order.end(), [&](size_t i) {
+            if (plus_bitmaps[i]) {
+                return has_bit(plus_bitmaps[i], document_key);
+            }
+            cursors[i].SkipTo(document_key);
+            return !cursors[i].IsAtEnd() && cursors[i].GetDocumentKey() == document_key;
+        });
+        if (is_in_all) {
+            accept(document_key, lead.GetDocumentId(), lead.GetDocumentData());
+        }
+    }
+}
+
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const std::execution::parallel_policy&,
-                                                     const Query& query, DocumentPredicate document_predicate) const {
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const std::execution::parallel_policy&,
+                                                          const CompiledQuery& query, DocumentPredicate document_predicate) const {
+    if (query.mode_ == QueryMode::ALL) {
+        return SearchServer::FindAllDocuments(query, document_predicate);
+    }
+    if (const auto narrowed_query = DropCommonTerms(query, &ScratchArena::ForCurrentThread())) {
+        return SearchServer::FindAllDocuments(std::execution::par, *narrowed_query, document_predicate);
+    }
     ConcurrentMap<int, double> document_to_relevance(100);
     std::for_each(std::execution::par,
-                  query.plus_words.begin(), query.plus_words.end(),
-                  [this, &document_to_relevance, document_predicate](const std::string_view word) {
-                       if (word_to_document_freqs_.count(word) == 0) return;
-                       const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-                       for (const auto& [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-                           const auto& document_data = documents_.at(document_id);
-                           if (document_predicate(document_id, document_data.status, document_data.rating)) {
+                  query.plus_terms_.begin(), query.plus_terms_.end(),
+                  [this, &document_to_relevance, document_predicate](const int term_id) {
+                       const size_t document_count = GetTermDocumentCount(term_id);
+                       if (document_count == 0) return;
+                       const double inverse_document_freq = ComputeTermInverseDocumentFreq(term_id);
+                       METRICS_COUNT(Counter::POSTINGS_VISITED, document_count);
+                       ForEachPosting(term_id, [&](int, int document_id, double term_freq, DocumentStatus status, int rating) {
+                           if (document_predicate(document_id, status, rating)) {
                                document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
                            }
-                       }
+                       });
                   });
+    METRICS_LAP(Phase::SCORE);
     std::for_each(std::execution::par,
-                  query.minus_words.begin(), query.minus_words.end(),
-                  [this, &document_to_relevance](const std::string_view word) {
-                      for (const auto& [document_id, _] : word_to_document_freqs_.at(word)) {
+                  query.minus_terms_.begin(), query.minus_terms_.end(),
+                  [this, &document_to_relevance](const int term_id) {
+                      ForEachPosting(term_id, [&document_to_relevance](int, int document_id, double, DocumentStatus, int) {
                           document_to_relevance.Erase(document_id);
-                      }
+                      });
                   });
     auto result = document_to_relevance.BuildOrdinaryMap();
-    std::vector<Document> matched_documents(result.size());
+    METRICS_LAP(Phase::FILTER);
+    std::pmr::vector<Document> matched_documents(result.size(), &ScratchArena::ForCurrentThread());
     std::transform(std::execution::par, 
                    result.begin(), result.end(), 
                    matched_documents.begin(), 
                    [this](const auto& id_relevance) {
-                       return Document{ id_relevance.first, id_relevance.second, documents_.at(id_relevance.first).rating };
+                       return Document{ id_relevance.first, id_relevance.second, GetDocumentData(id_relevance.first).rating };
                    });
     return matched_documents;
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const std::execution::sequenced_policy&, 
-                                                     const Query& query, DocumentPredicate document_predicate) const {
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const std::execution::sequenced_policy&, 
+                                                          const CompiledQuery& query, DocumentPredicate document_predicate) const {
     return SearchServer::FindAllDocuments(query, document_predicate);
 }
\ No newline at end of file
@@ -0,0 +1,158 @@
+#include "shard_aggregator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <functional>
+#include <stdexcept>
+
+#include "search_server.h"
+
+ShardAggregator::ShardAggregator(const std::vector<std::string>& socket_paths) {
+    if (socket_paths.empty()) {
+        throw std::invalid_argument("Shard count must be positive");
+    }
+    for (const auto& socket_path : socket_paths) {
+        shards_.push_back(std::make_unique<ShardClient>(socket_path));
+    }
+}
+
+void ShardAggregator::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                                  const std::vector<int>& ratings) {
+    if (document_id < 0) {
+        throw std::invalid_argument("Invalid document_id");
+    }
+    ShardAggregator::GetShard(document_id).AddDocument(document_id, document, status, ratings);
+}
+
+void ShardAggregator::RemoveDocument(int document_id) {
+    ShardAggregator::GetShard(document_id).RemoveDocument(document_id);
+}
+
+std::vector<Document> ShardAggregator::FindTopDocuments(std::string_view raw_query, DocumentStatus status) {
+    return ShardAggregator::FindTopDocuments(std::vector<std::string>{ std::string(raw_query) }, status).front();
+}
+
+std::vector<std::vector<Document>> ShardAggregator::FindTopDocuments(const std::vector<std::string>& queries,
+                                                                     DocumentStatus status) {
+    const size_t MAX_RESULT_DOCUMENT_COUNT = 5;
+    std::vector<std::vector<Document>> result(queries.size());
+    std::exception_ptr error;
+    // Every sent request must be received, even after a failure, to keep the pipelines in order.
+    const auto receive = [&error](auto func) {
+        try {
+            func();
+        }
+        catch (...) {
+            if (!error) error = std::current_exception();
+        }
+    };
+    for (size_t begin = 0; begin < queries.size(); begin += PIPELINE_DEPTH) {
+        const size_t end = std::min(queries.size(), begin + PIPELINE_DEPTH);
+        for (auto& shard : shards_) {
+            for (size_t i = begin; i < end; ++i) {
+                shard->SendGetTermStats(queries[i]);
+            }
+            shard->Flush();
+        }
+        std::vector<std::vector<TermStats>> shard_stats(end - begin);
+        for (auto& shard : shards_) {
+            for (auto& stats : shard_stats) {
+                receive([&shard, &stats]() { stats.push_back(shard->ReceiveTermStats()); });
+            }
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        for (auto& shard : shards_) {
+            for (size_t i = begin; i < end; ++i) {
+                shard->SendFindTopDocuments(ShardAggregator::ExpandQuery(shard_stats[i - begin]), status);
+            }
+            shard->Flush();
+        }
+        for (auto& shard : shards_) {
+            for (size_t i = begin; i < end; ++i) {
+                receive([&shard, &documents = result[i]]() {
+                    const auto shard_documents = shard->ReceiveDocuments();
+                    documents.insert(documents.end(), shard_documents.begin(), shard_documents.end());
+                });
+            }
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        for (size_t i = begin; i < end; ++i) {
+            auto& documents = result[i];
+            std::sort(documents.begin(), documents.end(), IsMoreRelevant);
+            if (documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
+                documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+            }
+        }
+    }
+    return result;
+}
+
+std::tuple<std::vector<std::string>, DocumentStatus> ShardAggregator::MatchDocument(std::string_view raw_query,
+                                                                                    int document_id) {
+    return ShardAggregator::GetShard(document_id).MatchDocument(raw_query, document_id);
+}
+
+size_t ShardAggregator::GetDocumentCount() {
+    size_t document_count = 0;
+    for (auto& shard : shards_) {
+        document_count += shard->GetDocumentCount();
+    }
+    return document_count;
+}
+
+// Mirrors ShardedSearchServer::ExpandQuery: the words of a prefix are the union
+// of the shard expansions capped at MAX_PREFIX_EXPANSION_COUNT. Every shard reports
+// its first words, so the capped union is what one big server would expand the
+// prefix to, and every shard holding one of these words has reported its frequency.
+ExpandedQuery ShardAggregator::ExpandQuery(const std::vector<TermStats>& shard_stats) {
+    const auto expand = [&shard_stats](auto get_prefix_words, std::vector<std::string>& words) {
+        const size_t prefix_count = get_prefix_words(shard_stats.front()).size();
+        for (size_t i = 0; i < prefix_count; ++i) {
+            std::vector<std::string> expansions;
+            for (const auto& stats : shard_stats) {
+                const auto& prefix_words = get_prefix_words(stats)[i];
+                expansions.insert(expansions.end(), prefix_words.begin(), prefix_words.end());
+            }
+            std::sort(expansions.begin(), expansions.end());
+            expansions.erase(std::unique(expansions.begin(), expansions.end()), expansions.end());
+            expansions.resize(std::min(expansions.size(), MAX_PREFIX_EXPANSION_COUNT));
+            words.insert(words.end(), expansions.begin(), expansions.end());
+        }
+    };
+    ExpandedQuery result;
+    auto plus_words = shard_stats.front().plus_words;
+    result.minus_words = shard_stats.front().minus_words;
+    expand([](const TermStats& stats) -> const auto& { return stats.plus_prefix_words; }, plus_words);
+    expand([](const TermStats& stats) -> const auto& { return stats.minus_prefix_words; }, result.minus_words);
+    uint64_t document_count = 0;
+    for (const auto& stats : shard_stats) {
+        document_count += stats.document_count;
+    }
+    for (const auto& word : plus_words) {
+        uint64_t document_freq = 0;
+        for (const auto& stats : shard_stats) {
+            const auto it = stats.document_freqs.find(word);
+            if (it != stats.document_freqs.end()) {
+                document_freq += it->second;
+            }
+        }
+        // Words without documents cannot match, so they are not sent.
+        if (document_freq > 0) {
+            result.inverse_document_freqs[word] = std::log(document_count * 1.0 / document_freq);
+        }
+    }
+    return result;
+}
+
+size_t ShardAggregator::GetShardCount() const {
+    return shards_.size();
+}
+
+ShardClient& ShardAggregator::GetShard(int document_id) {
+    return *shards_[std::hash<int>{}(document_id) % shards_.size()];
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "document.h"
+#include "shard_client.h"
+
+// Client side of multi-process sharding: routes documents to shard servers by
+// id hash, like ShardedSearchServer does with in-process shards, and answers
+// queries by fan-out and top-K merge. A query takes two pipelined round trips
+// to every shard: the first collects the document counts, document frequencies
+// and prefix expansions, the second scores the globally expanded words with the
+// global statistics, so results match a single SearchServer. Queries in a batch
+// share these round trips. Like ShardClient, an aggregator must not be shared
+// between threads.
+class ShardAggregator {
+public:
+    explicit ShardAggregator(const std::vector<std::string>&);
+
+    void AddDocument(int, std::string_view, DocumentStatus, const std::vector<int>&);
+    void RemoveDocument(int);
+    std::vector<Document> FindTopDocuments(std::string_view, DocumentStatus = DocumentStatus::ACTUAL);
+    std::vector<std::vector<Document>> FindTopDocuments(const std::vector<std::string>&, DocumentStatus = DocumentStatus::ACTUAL);
+    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(std::string_view, int);
+    size_t GetDocumentCount();
+    size_t GetShardCount() const;
+
+private:
+    std::vector<std::unique_ptr<ShardClient>> shards_;
+
+    ShardClient& GetShard(int);
+    static ExpandedQuery ExpandQuery(const std::vector<TermStats>&);
+};
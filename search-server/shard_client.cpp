@@ -0,0 +1,199 @@
+#include "shard_client.h"
+
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <unistd.h>
+
+ShardClient::ShardClient(const std::string& socket_path)
+    : fd_(ConnectUnixSocket(socket_path))
+    , reader_(fd_) {
+}
+
+ShardClient::~ShardClient() {
+    ::close(fd_);
+}
+
+void ShardClient::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                              const std::vector<int>& ratings) {
+    ShardClient::SendAddDocument(document_id, document, status, ratings);
+    ShardClient::Flush();
+    ShardClient::ReceiveEmpty();
+}
+
+void ShardClient::RemoveDocument(int document_id) {
+    ShardClient::BeginRequest(Opcode::REMOVE_DOCUMENT);
+    requests_.PutI32(document_id);
+    requests_.EndFrame();
+    ShardClient::Flush();
+    ShardClient::ReceiveEmpty();
+}
+
+std::vector<Document> ShardClient::FindTopDocuments(std::string_view raw_query, DocumentStatus status) {
+    ShardClient::SendFindTopDocuments(raw_query, status);
+    ShardClient::Flush();
+    return ShardClient::ReceiveDocuments();
+}
+
+std::vector<std::vector<Document>> ShardClient::FindTopDocuments(const std::vector<std::string>& queries,
+                                                                 DocumentStatus status) {
+    std::vector<std::vector<Document>> result;
+    result.reserve(queries.size());
+    std::exception_ptr error;
+    for (size_t begin = 0; begin < queries.size(); begin += PIPELINE_DEPTH) {
+        const size_t end = std::min(queries.size(), begin + PIPELINE_DEPTH);
+        for (size_t i = begin; i < end; ++i) {
+            ShardClient::SendFindTopDocuments(queries[i], status);
+        }
+        ShardClient::Flush();
+        for (size_t i = begin; i < end; ++i) {
+            try {
+                result.push_back(ShardClient::ReceiveDocuments());
+            }
+            catch (...) {
+                if (!error) error = std::current_exception();
+                result.emplace_back();
+            }
+        }
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return result;
+}
+
+std::tuple<std::vector<std::string>, DocumentStatus> ShardClient::MatchDocument(std::string_view raw_query, int document_id) {
+    ShardClient::BeginRequest(Opcode::MATCH_DOCUMENT);
+    requests_.PutString(raw_query);
+    requests_.PutI32(document_id);
+    requests_.EndFrame();
+    ShardClient::Flush();
+    auto response = ShardClient::Receive();
+    std::vector<std::string> words(response.GetU32());
+    for (auto& word : words) {
+        word = response.GetString();
+    }
+    return { words, static_cast<DocumentStatus>(response.GetU8()) };
+}
+
+size_t ShardClient::GetDocumentCount() {
+    ShardClient::BeginRequest(Opcode::GET_DOCUMENT_COUNT);
+    requests_.EndFrame();
+    ShardClient::Flush();
+    return ShardClient::Receive().GetU64();
+}
+
+void ShardClient::SendAddDocument(int document_id, std::string_view document, DocumentStatus status,
+                                  const std::vector<int>& ratings) {
+    ShardClient::BeginRequest(Opcode::ADD_DOCUMENT);
+    requests_.PutI32(document_id);
+    requests_.PutString(document);
+    requests_.PutU8(static_cast<uint8_t>(status));
+    requests_.PutU32(static_cast<uint32_t>(ratings.size()));
+    for (const int rating : ratings) {
+        requests_.PutI32(rating);
+    }
+    requests_.EndFrame();
+}
+
+void ShardClient::SendFindTopDocuments(std::string_view raw_query, DocumentStatus status) {
+    ShardClient::BeginRequest(Opcode::FIND_TOP_DOCUMENTS);
+    requests_.PutU8(static_cast<uint8_t>(status));
+    requests_.PutU8(false);
+    requests_.PutString(raw_query);
+    requests_.EndFrame();
+}
+
+void ShardClient::SendFindTopDocuments(const ExpandedQuery& query, DocumentStatus status) {
+    ShardClient::BeginRequest(Opcode::FIND_TOP_DOCUMENTS);
+    requests_.PutU8(static_cast<uint8_t>(status));
+    requests_.PutU8(true);
+    requests_.PutU32(static_cast<uint32_t>(query.inverse_document_freqs.size()));
+    for (const auto& [word, inverse_document_freq] : query.inverse_document_freqs) {
+        requests_.PutString(word);
+        requests_.PutF64(inverse_document_freq);
+    }
+    requests_.PutU32(static_cast<uint32_t>(query.minus_words.size()));
+    for (const auto& word : query.minus_words) {
+        requests_.PutString(word);
+    }
+    requests_.EndFrame();
+}
+
+void ShardClient::SendGetTermStats(std::string_view raw_query) {
+    ShardClient::BeginRequest(Opcode::GET_TERM_STATS);
+    requests_.PutString(raw_query);
+    requests_.EndFrame();
+}
+
+void ShardClient::Flush() {
+    WriteAll(fd_, requests_.GetBuffer());
+    requests_.Clear();
+}
+
+void ShardClient::ReceiveEmpty() {
+    ShardClient::Receive();
+}
+
+std::vector<Document> ShardClient::ReceiveDocuments() {
+    auto response = ShardClient::Receive();
+    std::vector<Document> documents(response.GetU32());
+    for (auto& document : documents) {
+        document.id = response.GetI32();
+        document.relevance = response.GetF64();
+        document.rating = response.GetI32();
+    }
+    return documents;
+}
+
+TermStats ShardClient::ReceiveTermStats() {
+    auto response = ShardClient::Receive();
+    TermStats result;
+    result.document_count = response.GetU64();
+    const auto get_words = [&response, &result](std::vector<std::string>& words, bool has_document_freqs) {
+        for (uint32_t i = response.GetU32(); i > 0; --i) {
+            words.emplace_back(response.GetString());
+            if (has_document_freqs) {
+                result.document_freqs[words.back()] = response.GetU64();
+            }
+        }
+    };
+    get_words(result.plus_words, true);
+    get_words(result.minus_words, false);
+    result.plus_prefix_words.resize(response.GetU32());
+    for (auto& words : result.plus_prefix_words) {
+        get_words(words, true);
+    }
+    result.minus_prefix_words.resize(response.GetU32());
+    for (auto& words : result.minus_prefix_words) {
+        get_words(words, false);
+    }
+    return result;
+}
+
+void ShardClient::BeginRequest(Opcode opcode) {
+    requests_.BeginFrame(static_cast<uint8_t>(opcode), next_request_id_++);
+}
+
+Decoder ShardClient::Receive() {
+    using namespace std::string_literals;
+    FrameHeader header;
+    std::string_view payload;
+    if (!reader_.Next(header, payload)) {
+        throw std::runtime_error("Shard closed the connection"s);
+    }
+    if (header.request_id != next_response_id_++) {
+        throw std::runtime_error("Unexpected response order"s);
+    }
+    Decoder response(payload);
+    switch (static_cast<ResponseCode>(header.code)) {
+    case ResponseCode::OK:
+        return response;
+    case ResponseCode::INVALID_ARGUMENT:
+        throw std::invalid_argument(std::string(response.GetString()));
+    case ResponseCode::OUT_OF_RANGE:
+        throw std::out_of_range(std::string(response.GetString()));
+    default:
+        throw std::runtime_error(std::string(response.GetString()));
+    }
+}
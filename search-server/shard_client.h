@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "document.h"
+#include "ipc_protocol.h"
+
+// What one shard knows about a query: its document count, the parsed words and
+// its own expansions of every prefix, at most MAX_PREFIX_EXPANSION_COUNT words
+// in lexicographic order. Document frequencies are given for the plus words and
+// the expansions of the plus prefixes.
+struct TermStats {
+    uint64_t document_count = 0;
+    std::map<std::string, uint64_t> document_freqs;
+    std::vector<std::string> plus_words;
+    std::vector<std::string> minus_words;
+    std::vector<std::vector<std::string>> plus_prefix_words;
+    std::vector<std::vector<std::string>> minus_prefix_words;
+};
+
+// A query expanded over all shards: the plus words with their global inverse
+// document frequencies and the minus words. Shards score exactly these words.
+struct ExpandedQuery {
+    std::map<std::string, double> inverse_document_freqs;
+    std::vector<std::string> minus_words;
+};
+
+// Requests a client keeps in flight at once; bounded so that neither side can
+// fill both socket buffers and block forever.
+constexpr size_t PIPELINE_DEPTH = 256;
+
+// Connection to a ShardServer. The blocking methods make one round trip each.
+// Send*/Receive* pairs pipeline requests: up to PIPELINE_DEPTH of them may be
+// sent and flushed at once, then the answers are received in the same order. Errors of
+// the shard are rethrown as std::invalid_argument or std::out_of_range, broken
+// connections as std::runtime_error. A client must not be shared between threads.
+class ShardClient {
+public:
+    explicit ShardClient(const std::string&);
+    ShardClient(const ShardClient&) = delete;
+    ShardClient& operator=(const ShardClient&) = delete;
+    ~ShardClient();
+
+    void AddDocument(int, std::string_view, DocumentStatus, const std::vector<int>&);
+    void RemoveDocument(int);
+    std::vector<Document> FindTopDocuments(std::string_view, DocumentStatus = DocumentStatus::ACTUAL);
+    std::vector<std::vector<Document>> FindTopDocuments(const std::vector<std::string>&, DocumentStatus = DocumentStatus::ACTUAL);
+    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(std::string_view, int);
+    size_t GetDocumentCount();
+
+    void SendAddDocument(int, std::string_view, DocumentStatus, const std::vector<int>&);
+    void SendFindTopDocuments(std::string_view, DocumentStatus);
+    void SendFindTopDocuments(const ExpandedQuery&, DocumentStatus);
+    void SendGetTermStats(std::string_view);
+    void Flush();
+    void ReceiveEmpty();
+    std::vector<Document> ReceiveDocuments();
+    TermStats ReceiveTermStats();
+
+private:
+    const int fd_;
+    FrameReader reader_;
+    Encoder requests_;
+    uint32_t next_request_id_ = 0;
+    uint32_t next_response_id_ = 0;
+
+    void BeginRequest(Opcode);
+    Decoder Receive();
+};
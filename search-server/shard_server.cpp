@@ -0,0 +1,233 @@
+#include "shard_server.h"
+
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+ShardServer::ShardServer(SearchServer& search_server, const std::string& socket_path)
+    : search_server_(search_server)
+    , socket_path_(socket_path)
+    , listen_fd_(ListenUnixSocket(socket_path)) {
+}
+
+ShardServer::~ShardServer() {
+    Stop();
+    ::close(listen_fd_);
+    ::unlink(socket_path_.c_str());
+}
+
+void ShardServer::Serve() {
+    using namespace std::string_literals;
+    while (true) {
+        const int fd = ::accept(listen_fd_, nullptr, nullptr);
+        if (is_stopping_) {
+            if (fd >= 0) ::close(fd);
+            break;
+        }
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            throw std::runtime_error("Accept failed: "s + std::strerror(errno));
+        }
+        std::lock_guard lock(connections_mutex_);
+        connection_fds_.push_back(fd);
+        std::thread([this, fd]() { ServeConnection(fd); }).detach();
+    }
+    std::unique_lock lock(connections_mutex_);
+    for (const int fd : connection_fds_) {
+        ::shutdown(fd, SHUT_RDWR);
+    }
+    connections_closed_.wait(lock, [this]() { return connection_fds_.empty(); });
+}
+
+void ShardServer::Stop() {
+    if (is_stopping_.exchange(true)) {
+        return;
+    }
+    try {
+        ::close(ConnectUnixSocket(socket_path_));
+    }
+    catch (const std::runtime_error&) {
+    }
+}
+
+void ShardServer::ServeConnection(int fd) {
+    const size_t MAX_BUFFERED_RESPONSE_SIZE = 64 * 1024;
+    FrameReader reader(fd);
+    Encoder responses;
+    FrameHeader header;
+    std::string_view payload;
+    try {
+        while (reader.Next(header, payload)) {
+            Decoder request(payload);
+            responses.BeginFrame(static_cast<uint8_t>(ResponseCode::OK), header.request_id);
+            auto error_code = ResponseCode::OK;
+            std::string error;
+            try {
+                HandleRequest(static_cast<Opcode>(header.code), request, responses);
+            }
+            catch (const std::invalid_argument& e) {
+                error_code = ResponseCode::INVALID_ARGUMENT;
+                error = e.what();
+            }
+            catch (const std::out_of_range& e) {
+                error_code = ResponseCode::OUT_OF_RANGE;
+                error = e.what();
+            }
+            catch (const std::exception& e) {
+                error_code = ResponseCode::INTERNAL_ERROR;
+                error = e.what();
+            }
+            if (error_code != ResponseCode::OK) {
+                responses.CancelFrame();
+                responses.BeginFrame(static_cast<uint8_t>(error_code), header.request_id);
+                responses.PutString(error);
+            }
+            responses.EndFrame();
+            if (responses.GetBuffer().size() > MAX_BUFFERED_RESPONSE_SIZE || !reader.HasPendingData()) {
+                WriteAll(fd, responses.GetBuffer());
+                responses.Clear();
+            }
+        }
+    }
+    catch (const std::exception&) {
+        // A broken connection only affects its own client.
+    }
+    std::lock_guard lock(connections_mutex_);
+    connection_fds_.erase(std::find(connection_fds_.begin(), connection_fds_.end(), fd));
+    ::close(fd);
+    connections_closed_.notify_all();
+}
+
+void ShardServer::HandleRequest(Opcode opcode, Decoder& request, Encoder& response) {
+    switch (opcode) {
+    case Opcode::ADD_DOCUMENT: {
+        const int document_id = request.GetI32();
+        const auto document = request.GetString();
+        const auto status = static_cast<DocumentStatus>(request.GetU8());
+        std::vector<int> ratings;
+        for (uint32_t i = request.GetU32(); i > 0; --i) {
+            ratings.push_back(request.GetI32());
+        }
+        std::unique_lock lock(search_mutex_);
+        search_server_.AddDocument(document_id, document, status, ratings);
+        break;
+    }
+    case Opcode::REMOVE_DOCUMENT: {
+        const int document_id = request.GetI32();
+        std::unique_lock lock(search_mutex_);
+        search_server_.RemoveDocument(document_id);
+        break;
+    }
+    case Opcode::FIND_TOP_DOCUMENTS:
+        ShardServer::FindTopDocuments(request, response);
+        break;
+    case Opcode::MATCH_DOCUMENT: {
+        const auto raw_query = request.GetString();
+        const int document_id = request.GetI32();
+        std::shared_lock lock(search_mutex_);
+        const auto [words, status] = search_server_.MatchDocument(raw_query, document_id);
+        response.PutU32(static_cast<uint32_t>(words.size()));
+        for (std::string_view word : words) {
+            response.PutString(word);
+        }
+        response.PutU8(static_cast<uint8_t>(status));
+        break;
+    }
+    case Opcode::GET_TERM_STATS:
+        ShardServer::GetTermStats(request, response);
+        break;
+    case Opcode::GET_DOCUMENT_COUNT: {
+        std::shared_lock lock(search_mutex_);
+        response.PutU64(search_server_.GetDocumentCount());
+        break;
+    }
+    default:
+        throw std::invalid_argument("Unknown opcode");
+    }
+}
+
+// Request: status, then either the raw query or a query expanded by the
+// aggregator: plus words with their global inverse document frequencies and
+// minus words. The expanded words are scored as they are, so the shard ranks
+// exactly as one big server would.
+void ShardServer::FindTopDocuments(Decoder& request, Encoder& response) {
+    const size_t MAX_RESULT_DOCUMENT_COUNT = 5;
+    const auto status = static_cast<DocumentStatus>(request.GetU8());
+    const bool is_expanded = request.GetU8() != 0;
+    std::vector<Document> documents;
+    if (is_expanded) {
+        const ScratchScope scratch;
+        auto* resource = scratch.GetResource();
+        SearchServer::Query query{ std::pmr::vector<std::string_view>(resource), std::pmr::vector<std::string_view>(resource),
+                                   std::pmr::vector<std::string_view>(resource), std::pmr::vector<std::string_view>(resource) };
+        std::map<std::string_view, double> inverse_document_freqs;
+        for (uint32_t i = request.GetU32(); i > 0; --i) {
+            const auto word = request.GetString();
+            query.plus_words.push_back(word);
+            inverse_document_freqs[word] = request.GetF64();
+        }
+        for (uint32_t i = request.GetU32(); i > 0; --i) {
+            query.minus_words.push_back(request.GetString());
+        }
+        std::shared_lock lock(search_mutex_);
+        auto matched_documents = search_server_.FindAllDocuments(search_server_.ResolveQuery(query, resource),
+            HasStatus(status),
+            [this, &inverse_document_freqs](int term_id) {
+                return inverse_document_freqs.at(search_server_.term_id_to_word_[term_id]);
+            });
+        lock.unlock();
+        const auto end = matched_documents.begin() + std::min(matched_documents.size(), MAX_RESULT_DOCUMENT_COUNT);
+        std::partial_sort(matched_documents.begin(), end, matched_documents.end(), IsMoreRelevant);
+        documents.assign(matched_documents.begin(), end);
+    }
+    else {
+        const auto raw_query = request.GetString();
+        std::shared_lock lock(search_mutex_);
+        documents = search_server_.FindTopDocuments(raw_query, status);
+    }
+    response.PutU32(static_cast<uint32_t>(documents.size()));
+    for (const auto& document : documents) {
+        response.PutI32(document.id);
+        response.PutF64(document.relevance);
+        response.PutI32(document.rating);
+    }
+}
+
+// Response: document count of the shard, the plus words with their document
+// frequencies, the minus words, then the words of every plus prefix with their
+// document frequencies and the words of every minus prefix. Prefixes are expanded
+// in this shard's dictionary, the aggregator caps the union of the expansions.
+void ShardServer::GetTermStats(Decoder& request, Encoder& response) {
+    const ScratchScope scratch;
+    const auto query = search_server_.ParseQuery(request.GetString(), scratch.GetResource());
+    std::shared_lock lock(search_mutex_);
+    response.PutU64(search_server_.GetDocumentCount());
+    response.PutU32(static_cast<uint32_t>(query.plus_words.size()));
+    for (std::string_view word : query.plus_words) {
+        response.PutString(word);
+        response.PutU64(search_server_.GetWordDocumentCount(word));
+    }
+    response.PutU32(static_cast<uint32_t>(query.minus_words.size()));
+    for (std::string_view word : query.minus_words) {
+        response.PutString(word);
+    }
+    const auto put_prefix_words = [this, &response, &scratch](const std::pmr::vector<std::string_view>& prefixes,
+                                                              bool has_document_freqs) {
+        response.PutU32(static_cast<uint32_t>(prefixes.size()));
+        for (std::string_view prefix : prefixes) {
+            std::pmr::vector<int> term_ids(scratch.GetResource());
+            search_server_.ForEachPrefixTerm(prefix, [&term_ids](int term_id) { term_ids.push_back(term_id); });
+            response.PutU32(static_cast<uint32_t>(term_ids.size()));
+            for (const int term_id : term_ids) {
+                response.PutString(search_server_.term_id_to_word_[term_id]);
+                if (has_document_freqs) {
+                    response.PutU64(search_server_.GetTermDocumentCount(term_id));
+                }
+            }
+        }
+    };
+    put_prefix_words(query.plus_prefixes, true);
+    put_prefix_words(query.minus_prefixes, false);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ipc_protocol.h"
+#include "search_server.h"
+
+// Serves a SearchServer over a Unix domain socket with the protocol of
+// ipc_protocol.h. Every connection gets its own thread; readers share the index,
+// writers lock it exclusively. The socket is bound in the constructor, so clients
+// may connect as soon as it returns. Stop may be called from any thread, Serve
+// returns once all connections are closed.
+class ShardServer {
+public:
+    ShardServer(SearchServer&, const std::string&);
+    ShardServer(const ShardServer&) = delete;
+    ShardServer& operator=(const ShardServer&) = delete;
+    ~ShardServer();
+
+    void Serve();
+    void Stop();
+
+private:
+    SearchServer& search_server_;
+    std::shared_mutex search_mutex_;
+    const std::string socket_path_;
+    const int listen_fd_;
+    std::atomic<bool> is_stopping_{false};
+    std::mutex connections_mutex_;
+    std::condition_variable connections_closed_;
+    std::vector<int> connection_fds_;
+
+    void ServeConnection(int);
+    void HandleRequest(Opcode, Decoder&, Encoder&);
+    void FindTopDocuments(Decoder&, Encoder&);
+    void GetTermStats(Decoder&, Encoder&);
+};
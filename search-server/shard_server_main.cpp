@@ -0,0 +1,36 @@
+#include <csignal>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "search_server.h"
+#include "shard_server.h"
+
+// Usage: search_server_shard <socket path> [stop words]
+// Serves one shard until SIGINT or SIGTERM.
+int main(int argc, char* argv[]) {
+    using namespace std::string_literals;
+    if (argc < 2 || argc > 3) {
+        std::cerr << "Usage: "s << argv[0] << " <socket path> [stop words]"s << std::endl;
+        return 1;
+    }
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    try {
+        SearchServer search_server(argc == 3 ? std::string(argv[2]) : ""s);
+        ShardServer shard_server(search_server, argv[1]);
+        std::thread serving([&shard_server]() { shard_server.Serve(); });
+        int signal = 0;
+        sigwait(&signals, &signal);
+        shard_server.Stop();
+        serving.join();
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include "sharded_search_server.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+
+ShardedSearchServer::ShardedSearchServer(size_t shard_count) {
+    if (shard_count == 0) {
+        throw std::invalid_argument("Shard count must be positive");
+    }
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_.emplace_back();
+    }
+}
+
+void ShardedSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                                      const std::vector<int>& ratings) {
+    if (document_id < 0) {
+        throw std::invalid_argument("Invalid document_id");
+    }
+    auto& shard = GetShard(document_id);
+    std::unique_lock lock(shard.mutex);
+    shard.server.AddDocument(document_id, document, status, ratings);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+    auto& shard = GetShard(document_id);
+    std::unique_lock lock(shard.mutex);
+    shard.server.RemoveDocument(document_id);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
+    return ShardedSearchServer::FindTopDocuments(raw_query, HasStatus(status));
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query) const {
+    return ShardedSearchServer::FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> ShardedSearchServer::MatchDocument(std::string_view raw_query,
+                                                                                             int document_id) const {
+    const auto& shard = GetShard(document_id);
+    std::shared_lock lock(shard.mutex);
+    return shard.server.MatchDocument(raw_query, document_id);
+}
+
+size_t ShardedSearchServer::GetDocumentCount() const {
+    size_t document_count = 0;
+    for (const auto& shard : shards_) {
+        std::shared_lock lock(shard.mutex);
+        document_count += shard.server.GetDocumentCount();
+    }
+    return document_count;
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+    return shards_.size();
+}
+
+ShardedSearchServer::Shard& ShardedSearchServer::GetShard(int document_id) {
+    return shards_[std::hash<int>{}(document_id) % shards_.size()];
+}
+
+const ShardedSearchServer::Shard& ShardedSearchServer::GetShard(int document_id) const {
+    return shards_[std::hash<int>{}(document_id) % shards_.size()];
+}
+
+// Expands the prefixes against the union of the shard dictionaries, so that
+// the expansion limit applies to the whole index as in a single server.
+// Must be called with all shards locked.
+void ShardedSearchServer::ExpandQuery(SearchServer::Query& query) const {
+    const auto expand = [this](auto& prefixes, auto& words) {
+        for (std::string_view prefix : prefixes) {
+            std::vector<std::string_view> expansions;
+            for (const auto& shard : shards_) {
+                shard.server.ForEachPrefixTerm(prefix, [&expansions, &shard](int term_id) {
+                    expansions.push_back(shard.server.term_id_to_word_[term_id]);
+                });
+            }
+            std::sort(expansions.begin(), expansions.end());
+            expansions.erase(std::unique(expansions.begin(), expansions.end()), expansions.end());
+            expansions.resize(std::min(expansions.size(), MAX_PREFIX_EXPANSION_COUNT));
+            words.insert(words.end(), expansions.begin(), expansions.end());
+        }
+        prefixes.clear();
+        std::sort(words.begin(), words.end());
+        words.erase(std::unique(words.begin(), words.end()), words.end());
+    };
+    expand(query.plus_prefixes, query.plus_words);
+    expand(query.minus_prefixes, query.minus_words);
+}
+
+// Must be called with all shards locked, so that the counts are consistent.
+std::map<std::string_view, double> ShardedSearchServer::ComputeInverseDocumentFreqs(const SearchServer::Query& query) const {
+    size_t document_count = 0;
+    for (const auto& shard : shards_) {
+        document_count += shard.server.GetDocumentCount();
+    }
+    std::map<std::string_view, double> inverse_document_freqs;
+    for (std::string_view word : query.plus_words) {
+        size_t word_document_count = 0;
+        for (const auto& shard : shards_) {
+            word_document_count += shard.server.GetWordDocumentCount(word);
+        }
+        if (word_document_count > 0) {
+            inverse_document_freqs[word] = std::log(document_count * 1.0 / word_document_count);
+        }
+    }
+    return inverse_document_freqs;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <deque>
+#include <execution>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+// Splits documents across independent SearchServer shards by document id hash.
+// Each shard has its own lock, so writers to different shards never contend,
+// and every query is scattered to all shards in parallel. Shards are scored
+// with the global document count and document frequencies, so relevances are
+// exactly the ones a single SearchServer computes for the same documents.
+class ShardedSearchServer {
+public:
+    explicit ShardedSearchServer(size_t);
+    template <typename StopWords>
+    ShardedSearchServer(size_t, const StopWords&);
+
+    void AddDocument(int, std::string_view, DocumentStatus, const std::vector<int>&);
+    void RemoveDocument(int);
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view, DocumentPredicate) const;
+    std::vector<Document> FindTopDocuments(std::string_view, DocumentStatus) const;
+    std::vector<Document> FindTopDocuments(std::string_view) const;
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view, int) const;
+    size_t GetDocumentCount() const;
+    size_t GetShardCount() const;
+
+private:
+    struct Shard {
+        template <typename... Args>
+        explicit Shard(const Args&... args)
+            : server(args...) {
+        }
+
+        SearchServer server;
+        mutable std::shared_mutex mutex;
+    };
+    std::deque<Shard> shards_;
+
+    Shard& GetShard(int);
+    const Shard& GetShard(int) const;
+    void ExpandQuery(SearchServer::Query&) const;
+    std::map<std::string_view, double> ComputeInverseDocumentFreqs(const SearchServer::Query&) const;
+};
+
+template <typename StopWords>
+ShardedSearchServer::ShardedSearchServer(size_t shard_count, const StopWords& stop_words) {
+    if (shard_count == 0) {
+        throw std::invalid_argument("Shard count must be positive");
+    }
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_.emplace_back(stop_words);
+    }
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query,
+                                                            DocumentPredicate document_predicate) const {
+    const size_t MAX_RESULT_DOCUMENT_COUNT = 5;
+    const ScratchScope scratch;
+    auto query = shards_.front().server.ParseQuery(raw_query, scratch.GetResource());
+    std::vector<std::shared_lock<std::shared_mutex>> locks;
+    locks.reserve(shards_.size());
+    for (const auto& shard : shards_) {
+        locks.emplace_back(shard.mutex);
+    }
+    ExpandQuery(query);
+    const auto inverse_document_freqs = ComputeInverseDocumentFreqs(query);
+    std::vector<std::vector<Document>> shard_documents(shards_.size());
+    std::transform(std::execution::par, shards_.begin(), shards_.end(), shard_documents.begin(),
+                   [&query, &inverse_document_freqs, document_predicate, MAX_RESULT_DOCUMENT_COUNT](const Shard& shard) {
+                       const ScratchScope scratch;
+                       const auto& server = shard.server;
+                       auto documents = server.FindAllDocuments(server.ResolveQuery(query, scratch.GetResource()), document_predicate,
+                           [&inverse_document_freqs, &server](int term_id) {
+                               return inverse_document_freqs.at(server.term_id_to_word_[term_id]);
+                           });
+                       const auto end = documents.begin() + std::min(documents.size(), MAX_RESULT_DOCUMENT_COUNT);
+                       std::partial_sort(documents.begin(), end, documents.end(), IsMoreRelevant);
+                       return std::vector<Document>(documents.begin(), end);
+                   });
+    locks.clear();
+    std::vector<Document> matched_documents;
+    for (const auto& documents : shard_documents) {
+        matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
+    }
+    std::sort(matched_documents.begin(), matched_documents.end(), IsMoreRelevant);
+    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
+        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    }
+    return matched_documents;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+
+// Galloping search: finds the first element not less than value by probing
+// positions 1, 2, 4, ... ahead and binary searching the last step only, so
+// skipping k elements costs O(log k) instead of O(log n).
+template <typename RandomIt, typename T, typename Less>
+RandomIt GallopLowerBound(RandomIt first, RandomIt last, const T& value, Less less) {
+    typename std::iterator_traits<RandomIt>::difference_type step = 1;
+    RandomIt low = first;
+    while (last - low > step && less(*(low + step), value)) {
+        low += step;
+        step *= 2;
+    }
+    return std::lower_bound(low, low + std::min(step + 1, last - low), value, less);
+}
+
+template <typename RandomIt, typename T>
+RandomIt GallopLowerBound(RandomIt first, RandomIt last, const T& value) {
+    return GallopLowerBound(first, last, value, std::less<>{});
+}
+
+// Calls visit(it1, it2) for every pair of equal elements of two sorted ranges.
+// Ranges of similar length are merged linearly; when one range is much shorter
+// its elements are located in the longer one by galloping.
+template <typename RandomIt1, typename RandomIt2, typename Visitor>
+void IntersectSorted(RandomIt1 first1, RandomIt1 last1, RandomIt2 first2, RandomIt2 last2, Visitor visit) {
+    const auto size1 = last1 - first1;
+    const auto size2 = last2 - first2;
+    const int GALLOP_RATIO = 8;
+    if (size1 * GALLOP_RATIO < size2) {
+        for (; first1 != last1 && first2 != last2; ++first1) {
+            first2 = GallopLowerBound(first2, last2, *first1);
+            if (first2 != last2 && !(*first1 < *first2)) {
+                visit(first1, first2);
+                ++first2;
+            }
+        }
+        return;
+    }
+    if (size2 * GALLOP_RATIO < size1) {
+        for (; first1 != last1 && first2 != last2; ++first2) {
+            first1 = GallopLowerBound(first1, last1, *first2);
+            if (first1 != last1 && !(*first2 < *first1)) {
+                visit(first1, first2);
+                ++first1;
+            }
+        }
+        return;
+    }
+    while (first1 != last1 && first2 != last2) {
+        if (*first1 < *first2) {
+            ++first1;
+        }
+        else if (*first2 < *first1) {
+            ++first2;
+        }
+        else {
+            visit(first1, first2);
+            ++first1;
+            ++first2;
+        }
+    }
+}
+
+template <typename RandomIt1, typename RandomIt2>
+bool HasIntersection(RandomIt1 first1, RandomIt1 last1, RandomIt2 first2, RandomIt2 last2) {
+    while (first1 != last1 && first2 != last2) {
+        if (*first1 < *first2) {
+            first1 = GallopLowerBound(first1, last1, *first2);
+        }
+        else if (*first2 < *first1) {
+            first2 = GallopLowerBound(first2, last2, *first1);
+        }
+        else {
+            return true;
+        }
+    }
+    return false;
+}
@@ -2,11 +2,12 @@
 
 std::vector<std::string_view> SplitIntoWords(std::string_view str) {
     std::vector<std::string_view> result;
-    str.remove_prefix(std::min(str.size(), str.find_first_not_of(" ")));
-    while (!str.empty()) {
-        auto space = str.find(' ');
-        result.push_back(space == str.npos ? str.substr() : str.substr(0, space));
-        str.remove_prefix(std::min(str.size(), str.find_first_not_of(" ", space)));
-    }
+    ForEachWord(str, [&result](std::string_view word) { result.push_back(word); });
     return result;
-}
\ No newline at end of file
+}
+
+std::pmr::vector<std::string_view> SplitIntoWords(std::string_view str, std::pmr::memory_resource* resource) {
+    std::pmr::vector<std::string_view> result(resource);
+    ForEachWord(str, [&result](std::string_view word) { result.push_back(word); });
+    return result;
+}
@@ -1,19 +1,21 @@
 #pragma once
 
+#include <algorithm>
+#include <memory_resource>
 #include <string>
 #include <string_view>
 #include <vector>
-#include <set>
 
-std::vector<std::string_view> SplitIntoWords(std::string_view);
-
-template <typename StringContainer>
-std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
-    std::set<std::string, std::less<>> non_empty_strings;
-    for (const auto& str : strings) {
-        if (!str.empty()) {
-            non_empty_strings.emplace(str);
-        }
+// Calls func for every space-separated word of text without collecting them.
+template <typename Func>
+void ForEachWord(std::string_view text, Func func) {
+    text.remove_prefix(std::min(text.size(), text.find_first_not_of(" ")));
+    while (!text.empty()) {
+        const auto space = text.find(' ');
+        func(space == text.npos ? text.substr() : text.substr(0, space));
+        text.remove_prefix(std::min(text.size(), text.find_first_not_of(" ", space)));
     }
-    return non_empty_strings;
-}
\ No newline at end of file
+}
+
+std::vector<std::string_view> SplitIntoWords(std::string_view);
+std::pmr::vector<std::string_view> SplitIntoWords(std::string_view, std::pmr::memory_resource*);
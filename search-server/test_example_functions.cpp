@@ -2,6 +2,77 @@
 
 using namespace std::string_literals;
 
+namespace {
+
+thread_local size_t allocation_count = 0;
+
+void* CountedAllocate(size_t size, size_t alignment) {
+    ++allocation_count;
+    if (size == 0) {
+        size = 1;
+    }
+    void* pointer = alignment <= alignof(std::max_align_t)
+        ? std::malloc(size)
+        : std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+}
+
+// Counts heap allocations of the current thread, so that tests can check the
+// allocation-free paths. Every replaceable form is routed through malloc and
+// free, so that news and deletes stay paired.
+void* operator new(size_t size) {
+    return CountedAllocate(size, 0);
+}
+
+void* operator new[](size_t size) {
+    return CountedAllocate(size, 0);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    return CountedAllocate(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return CountedAllocate(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
 void AssertImpl(bool value, const std::string& expr_str, const std::string& file, const std::string& func, unsigned line,
     const std::string& hint) {
     if (!value) {
@@ -24,6 +95,14 @@ std::vector<std::string_view> VectStringToVectStringView(const std::vector<std::
     return result;
 }
 
+SearchServer MakeGeneratedServer(const CorpusGenerator& generator) {
+    SearchServer search_server(generator.GetStopWordsText());
+    for (const auto& document : generator.GenerateDocuments()) {
+        search_server.AddDocument(document.id, document.text, document.status, document.ratings);
+    }
+    return search_server;
+}
+
 void TestExcludeStopWordsFromAddedDocumentContent() {
     const int doc_id = 42;
     const std::string content = "cat in the city"s;
@@ -157,6 +236,273 @@ void TestPeginator() {
     ASSERT_EQUAL_HINT(pages.size(), page_size, "Error in page distribution"s);
 }
 
+void TestLazyPaginator() {
+    const std::vector<int> items = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+    const auto pages = Paginate(items, 3);
+    ASSERT_EQUAL_HINT(pages.size(), 4u, "Error in page count"s);
+    std::vector<size_t> page_sizes;
+    for (const auto& page : pages) {
+        page_sizes.push_back(page.size());
+    }
+    ASSERT_EQUAL_HINT(page_sizes, std::vector<size_t>({ 3, 3, 3, 1 }), "Error in page distribution"s);
+    ASSERT_EQUAL_HINT(*pages[2].begin(), 7, "Error in random page access"s);
+    ASSERT_EQUAL_HINT(pages[3].size(), 1u, "Error in random page access"s);
+    ASSERT_EQUAL_HINT(Paginate(std::vector<int>{}, 3).size(), 0u, "Empty container has no pages"s);
+}
+
+void TestPagedSearch() {
+    SearchServer search_server;
+    const int document_count = 20;
+    for (int id = 1; id <= document_count; ++id) {
+        std::string text;
+        for (int i = 0; i < document_count; ++i) {
+            text += i < id ? "cat "s : "dog "s;
+        }
+        search_server.AddDocument(id, text, id % 7 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL, { id });
+    }
+    search_server.AddDocument(100, "bird"s, DocumentStatus::ACTUAL, { 1 });
+    std::vector<int> expected_ids;
+    for (int id = document_count; id > 0; --id) {
+        if (id % 7 != 0) expected_ids.push_back(id);
+    }
+    const auto to_ids = [](const std::vector<Document>& documents) {
+        std::vector<int> ids;
+        for (const auto& document : documents) {
+            ids.push_back(document.id);
+        }
+        return ids;
+    };
+    const size_t page_size = 3;
+    for (size_t page = 0; page * page_size < expected_ids.size(); ++page) {
+        const std::vector<int> expected(expected_ids.begin() + page * page_size,
+                                        expected_ids.begin() + std::min(expected_ids.size(), (page + 1) * page_size));
+        ASSERT_EQUAL_HINT(to_ids(search_server.FindTopDocuments("cat -bird"s, page, page_size)), expected, "Error in paged search"s);
+    }
+    ASSERT_HINT(search_server.FindTopDocuments("cat"s, 10, page_size).empty(), "Pages past the end must be empty"s);
+    auto cursor = search_server.OpenSearchCursor("cat"s);
+    ASSERT_EQUAL_HINT(cursor.GetMatchedCount(), expected_ids.size(), "Error in cursor matched count"s);
+    ASSERT_EQUAL_HINT(to_ids(cursor.GetPage(4, page_size)), std::vector<int>({ 6, 5, 4 }), "Error in cursor page"s);
+    ASSERT_EQUAL_HINT(to_ids(cursor.NextPage(page_size)), std::vector<int>({ 3, 2, 1 }), "Error in cursor continuation"s);
+    ASSERT_HINT(!cursor.HasNextPage(), "Cursor must be exhausted"s);
+    ASSERT_EQUAL_HINT(to_ids(cursor.GetPage(1, page_size)), std::vector<int>({ 17, 16, 15 }), "Error in cursor page"s);
+    ASSERT_EQUAL_HINT(to_ids(cursor.NextPage(2)), std::vector<int>({ 13, 12 }), "Error in cursor continuation"s);
+    ASSERT_EQUAL_HINT(to_ids(search_server.FindTopDocuments("cat"s)), to_ids(cursor.GetPage(0, 5)),
+                      "Cursor must rank like FindTopDocuments"s);
+}
+
+void TestThreadPool() {
+    ThreadPool pool(3);
+    std::atomic<int> sum = 0;
+    std::vector<std::future<int>> results;
+    for (int i = 1; i <= 100; ++i) {
+        results.push_back(pool.Async([&pool, &sum, i]() {
+            pool.Submit([&sum, i]() { sum += i; });
+            return i * i;
+        }));
+    }
+    int squares = 0;
+    for (auto& result : results) {
+        squares += result.get();
+    }
+    ASSERT_EQUAL_HINT(squares, 338350, "Error in pool task results"s);
+    while (sum.load() != 5050) {
+        std::this_thread::yield();
+    }
+
+    BoundedQueue<int> queue(2);
+    ASSERT_HINT(queue.TryPush(1) && queue.TryPush(2), "Queue must accept items up to capacity"s);
+    ASSERT_HINT(!queue.TryPush(3), "Full queue must reject items"s);
+    ASSERT_EQUAL_HINT(*queue.Pop(), 1, "Queue must be FIFO"s);
+    queue.Close();
+    ASSERT_EQUAL_HINT(*queue.Pop(), 2, "Closed queue must be drained"s);
+    ASSERT_HINT(!queue.Pop().has_value(), "Drained closed queue must be empty"s);
+}
+
+void TestAsyncSearchServer() {
+    SearchServer search_server("and with"s);
+    int id = 0;
+    for (const std::string& text : { "funny pet and nasty rat"s, "funny pet with curly hair"s,
+                                      "funny pet and not very nasty rat"s, "nasty rat with curly hair"s }) {
+        search_server.AddDocument(++id, text, DocumentStatus::ACTUAL, { 1, 2 });
+    }
+    const std::vector<std::string> queries = { "nasty rat -not"s, "curly hair"s, "funny"s, "pet -funny"s };
+    try {
+        AsyncSearchServer rejecting_server(search_server, { 1, 0 });
+        ASSERT_HINT(false, "Zero queue capacity must be rejected"s);
+    }
+    catch (const std::invalid_argument&) {
+    }
+    AsyncSearchServer async_server(search_server, { 2, 16 });
+    std::vector<std::future<QueryResponse>> responses;
+    for (const auto& query : queries) {
+        responses.push_back(async_server.Submit({ query, DocumentStatus::ACTUAL, std::chrono::seconds(10) }));
+    }
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const auto response = responses[i].get();
+        ASSERT_HINT(response.status == QueryStatus::OK, "Query must be served"s);
+        ASSERT_EQUAL_HINT(response.documents.size(), search_server.FindTopDocuments(queries[i]).size(), "Error in async search"s);
+    }
+    const auto expired = async_server.Submit({ "funny"s, DocumentStatus::ACTUAL, std::chrono::seconds(0) }).get();
+    ASSERT_HINT(expired.status == QueryStatus::TIMEOUT, "Expired request must time out"s);
+    const auto invalid = async_server.Submit({ "funny --pet"s, DocumentStatus::ACTUAL, std::chrono::seconds(10) }).get();
+    ASSERT_HINT(invalid.status == QueryStatus::FAILED, "Invalid query must fail"s);
+
+    AsyncSearchServer closed_server(search_server, { 1, 1 });
+    auto started = std::make_shared<std::promise<void>>();
+    std::promise<void> unblock;
+    std::shared_future<void> unblocked = unblock.get_future().share();
+    // The first callback holds the only worker, so the second request stays queued in the only slot.
+    closed_server.Submit({ "funny"s, DocumentStatus::ACTUAL, std::chrono::seconds(10) },
+                         [started, unblocked](QueryResponse) {
+                             started->set_value();
+                             unblocked.wait();
+                         });
+    started->get_future().wait();
+    auto queued = closed_server.TrySubmit({ "funny"s, DocumentStatus::ACTUAL, std::chrono::seconds(10) });
+    ASSERT_HINT(closed_server.TrySubmit({ "funny"s }).get().status == QueryStatus::REJECTED, "Overload must be shed"s);
+    unblock.set_value();
+    ASSERT_HINT(queued.get().status == QueryStatus::OK, "Queued request must complete"s);
+    const auto stats = async_server.GetStats();
+    ASSERT_EQUAL_HINT(stats.completed, queries.size(), "Error in async stats"s);
+    ASSERT_EQUAL_HINT(stats.timed_out + stats.failed, 2u, "Error in async stats"s);
+    ASSERT_EQUAL_HINT(closed_server.GetStats().rejected, 1u, "Error in async stats"s);
+
+    std::promise<void> thrown;
+    async_server.Submit({ "funny"s, DocumentStatus::ACTUAL, std::chrono::seconds(10) }, [&thrown](QueryResponse) {
+        thrown.set_value();
+        throw std::runtime_error("Callback failure");
+    });
+    thrown.get_future().wait();
+    ASSERT_HINT(async_server.Submit({ "funny"s, DocumentStatus::ACTUAL, std::chrono::seconds(10) }).get().status == QueryStatus::OK,
+                "Throwing callback must not stop the pool"s);
+}
+
+void TestRequestStats() {
+    using namespace std::chrono;
+    RequestStats stats;
+    const RequestStats::Clock::time_point start(hours(1000));
+    stats.Record(0, QueryStatus::OK, start);
+    stats.Record(3, QueryStatus::OK, start + milliseconds(500));
+    {
+        const auto summary = stats.GetSummary(RequestStats::Window::SECOND, start + milliseconds(600));
+        ASSERT_EQUAL_HINT(summary.requests, 2u, "Error in second window"s);
+        ASSERT_EQUAL_HINT(summary.GetEmptyResultRate(), 0.5, "Error in empty result rate"s);
+        ASSERT_EQUAL_HINT(summary.result_counts[3], 1u, "Error in result count distribution"s);
+    }
+    ASSERT_EQUAL_HINT(stats.GetSummary(RequestStats::Window::SECOND, start + seconds(2)).requests, 0u,
+                      "Old requests must leave the second window"s);
+    stats.Record(0, QueryStatus::TIMEOUT, start + seconds(30));
+    {
+        const auto summary = stats.GetSummary(RequestStats::Window::MINUTE, start + seconds(40));
+        ASSERT_EQUAL_HINT(summary.requests, 3u, "Error in minute window"s);
+        ASSERT_EQUAL_HINT(summary.GetStatusCount(QueryStatus::TIMEOUT), 1u, "Error in status counts"s);
+    }
+    stats.Record(7, QueryStatus::OK, start + seconds(90));
+    ASSERT_EQUAL_HINT(stats.GetSummary(RequestStats::Window::MINUTE, start + seconds(90)).requests, 1u,
+                      "Old requests must leave the minute window"s);
+    ASSERT_EQUAL_HINT(stats.GetSummary(RequestStats::Window::DAY, start + seconds(90)).result_counts[RESULT_COUNT_BUCKETS - 1], 1u,
+                      "Error in day window"s);
+    ASSERT_EQUAL_HINT(stats.GetSummary(RequestStats::Window::DAY, start + hours(25)).requests, 0u,
+                      "Old requests must leave the day window"s);
+
+    RequestStats concurrent_stats;
+    const auto now = RequestStats::Clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&concurrent_stats, now, t]() {
+            for (int i = 0; i < 10000; ++i) {
+                concurrent_stats.Record(i % 6, t == 0 ? QueryStatus::FAILED : QueryStatus::OK, now);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const auto summary = concurrent_stats.GetSummary(RequestStats::Window::SECOND, now);
+    ASSERT_EQUAL_HINT(summary.requests, 40000u, "Concurrent records must not be lost"s);
+    ASSERT_EQUAL_HINT(summary.GetStatusCount(QueryStatus::FAILED), 10000u, "Error in concurrent status counts"s);
+    ASSERT_EQUAL_HINT(concurrent_stats.GetTotal().empty_results, 4u * 1667u, "Error in concurrent empty results"s);
+
+    SearchServer search_server;
+    search_server.AddDocument(1, "curly cat"s, DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(2, "curly dog"s, DocumentStatus::BANNED, { 1 });
+    RequestStats server_stats;
+    server_stats.AddFindRequest(search_server, "curly"s);
+    server_stats.AddFindRequest(search_server, std::execution::par, "dog"s, DocumentStatus::ACTUAL);
+    server_stats.AddFindRequest(search_server, std::execution::seq, "curly"s,
+                                [](int document_id, DocumentStatus, int) { return document_id > 1; });
+    try {
+        server_stats.AddFindRequest(search_server, "--curly"s);
+    }
+    catch (const std::invalid_argument&) {
+    }
+    const auto total = server_stats.GetTotal();
+    ASSERT_EQUAL_HINT(total.requests, 4u, "Every request must be recorded"s);
+    ASSERT_EQUAL_HINT(total.empty_results, 2u, "Error in empty results"s);
+    ASSERT_EQUAL_HINT(total.GetStatusCount(QueryStatus::FAILED), 1u, "Failed requests must be recorded"s);
+}
+
+void TestShardedSearchServer() {
+    CorpusOptions corpus_options;
+    corpus_options.document_count = 300;
+    corpus_options.vocabulary_size = 200;
+    const CorpusGenerator generator(corpus_options);
+    SearchServer search_server = MakeGeneratedServer(generator);
+    ShardedSearchServer sharded_server(3, generator.GetStopWordsText());
+    const auto documents = generator.GenerateDocuments();
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 3; ++t) {
+        threads.emplace_back([&sharded_server, &documents, t]() {
+            for (size_t i = t; i < documents.size(); i += 3) {
+                const auto& document = documents[i];
+                sharded_server.AddDocument(document.id, document.text, document.status, document.ratings);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQUAL_HINT(sharded_server.GetDocumentCount(), documents.size(), "Concurrent adds must not be lost"s);
+    QueryOptions query_options;
+    query_options.query_count = 50;
+    query_options.max_query_length = 3;
+    const auto relevant_ids = [](const std::vector<Document>& documents) {
+        std::vector<std::pair<int, double>> result;
+        for (const auto& document : documents) {
+            result.push_back({ document.id, document.relevance });
+        }
+        return result;
+    };
+    for (const auto& query : generator.GenerateQueries(query_options)) {
+        ASSERT_EQUAL_HINT(relevant_ids(sharded_server.FindTopDocuments(query)), relevant_ids(search_server.FindTopDocuments(query)),
+                          "Sharded scores must match the single server"s);
+        const auto even = [](int document_id, DocumentStatus, int) { return document_id % 2 == 0; };
+        ASSERT_EQUAL_HINT(relevant_ids(sharded_server.FindTopDocuments(query, even)), relevant_ids(search_server.FindTopDocuments(query, even)),
+                          "Error in sharded predicate search"s);
+    }
+    const auto& word = generator.GetVocabulary().front();
+    ASSERT_EQUAL_HINT(std::get<0>(sharded_server.MatchDocument(word, 0)), std::get<0>(search_server.MatchDocument(word, 0)),
+                      "Error in sharded matching"s);
+    for (const auto& document : search_server.FindTopDocuments(word)) {
+        sharded_server.RemoveDocument(document.id);
+        search_server.RemoveDocument(document.id);
+    }
+    ASSERT_EQUAL_HINT(relevant_ids(sharded_server.FindTopDocuments(word)), relevant_ids(search_server.FindTopDocuments(word)),
+                      "Error in sharded search after removal"s);
+    try {
+        sharded_server.AddDocument(1, "duplicate"s, DocumentStatus::ACTUAL, { 1 });
+        ASSERT_HINT(false, "Duplicate id must be rejected"s);
+    }
+    catch (const std::invalid_argument&) {
+    }
+    try {
+        sharded_server.RemoveDocument(100500);
+        ASSERT_HINT(false, "Unknown id must be rejected"s);
+    }
+    catch (const std::out_of_range&) {
+    }
+}
+
 void TestQueryQueue() {
     int resulted_empty_requests = 1437;
     SearchServer search_server("and in at"s);
@@ -260,6 +606,1074 @@ void TestFindingDocumentsWithPolicy() {
     ASSERT_EQUAL_HINT(result3.size(), id / 2, "Error in Finding Documents without policy"s);
 }
 
+void TestSortedIntersection() {
+    std::vector<int> small = { 3, 40, 41, 900 };
+    std::vector<int> large(1000);
+    std::iota(large.begin(), large.end(), 0);
+    std::vector<int> even;
+    for (int i = 0; i < 20; i += 2) {
+        even.push_back(i);
+    }
+    const std::vector<int> odd = { 1, 3, 5, 7 };
+    for (const auto& [lhs, rhs] : std::vector<std::pair<std::vector<int>, std::vector<int>>>{
+             { small, large }, { large, small }, { even, odd }, { odd, { 2, 3, 7, 8 } } }) {
+        std::vector<int> expected;
+        std::set_intersection(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), std::back_inserter(expected));
+        std::vector<int> intersection;
+        IntersectSorted(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                        [&intersection](auto it, auto) { intersection.push_back(*it); });
+        ASSERT_EQUAL_HINT(intersection, expected, "Error in sorted intersection"s);
+        ASSERT_EQUAL_HINT(HasIntersection(lhs.begin(), lhs.end(), rhs.begin(), rhs.end()), !expected.empty(),
+                          "Error in intersection check"s);
+    }
+    ASSERT_EQUAL_HINT(*GallopLowerBound(large.begin(), large.end(), 777), 777, "Error in galloping search"s);
+    ASSERT_HINT(GallopLowerBound(small.begin(), small.end(), 901) == small.end(), "Error in galloping search"s);
+}
+
+void TestMatchDocuments() {
+    SearchServer search_server("and with to"s);
+    search_server.AddDocument(1, "white cat and fashion collar"s, DocumentStatus::ACTUAL, { 1, 2 });
+    search_server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, { 1, 2 });
+    search_server.AddDocument(3, "wellgroomed dog expressive eyes"s, DocumentStatus::BANNED, { 1, 2 });
+    search_server.AddDocument(4, "white fashion cat"s, DocumentStatus::IRRELEVANT, { 1, 2 });
+    search_server.AddDocument(5, "and with"s, DocumentStatus::ACTUAL, { 1, 2 });
+    const std::string query = "fluffy wellgroomed cat cat -collar unknown"s;
+    const std::vector<int> ids = { 5, 4, 3, 2, 1 };
+    const auto sequential_result = search_server.MatchDocuments(query, ids);
+    const auto parallel_result = search_server.MatchDocuments(std::execution::par, query, ids);
+    ASSERT_EQUAL_HINT(sequential_result.size(), ids.size(), "Every document must be matched"s);
+    for (size_t i = 0; i < ids.size(); ++i) {
+        const auto [expected_words, expected_status] = search_server.MatchDocument(query, ids[i]);
+        const auto [words, status] = sequential_result[i];
+        const auto [parallel_words, parallel_status] = parallel_result[i];
+        ASSERT_EQUAL_HINT(words, expected_words, "Error in batch matching"s);
+        ASSERT_EQUAL_HINT(parallel_words, expected_words, "Error in parallel batch matching"s);
+        ASSERT_HINT(status == expected_status && parallel_status == expected_status, "Error in batch matching status"s);
+    }
+    try {
+        search_server.MatchDocuments(query, { 1, 42 });
+        ASSERT_HINT(false, "Unknown document id must be rejected"s);
+    }
+    catch (const std::out_of_range&) {
+    }
+}
+
+void TestLatencyHistogram() {
+    for (uint64_t value = 0; value < 100000; ++value) {
+        const size_t index = LatencyHistogram::BucketIndex(value);
+        ASSERT_HINT(LatencyHistogram::BucketUpperBound(index) >= value, "Value must not exceed its bucket bound"s);
+        ASSERT_HINT(index == 0 || LatencyHistogram::BucketUpperBound(index - 1) < value, "Buckets must not overlap"s);
+    }
+    LatencyHistogram histogram;
+    for (uint64_t value = 1; value <= 1000; ++value) {
+        histogram.Record(value * 1000);
+    }
+    ASSERT_EQUAL_HINT(histogram.GetCount(), 1000u, "Error in histogram count"s);
+    ASSERT_EQUAL_HINT(histogram.GetMax(), 1000000u, "Error in histogram maximum"s);
+    const auto p50 = histogram.ValueAtPercentile(50.0);
+    const auto p99 = histogram.ValueAtPercentile(99.0);
+    ASSERT_HINT(p50 >= 500000 && p50 <= 500000 * 1.0625, "Error in histogram median"s);
+    ASSERT_HINT(p99 >= 990000 && p99 <= 1000000, "Error in histogram 99th percentile"s);
+}
+
+void TestMetricsSnapshot() {
+#ifdef SEARCH_SERVER_METRICS
+    MetricsRegistry::Reset();
+    SearchServer search_server("and with"s);
+    search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+    search_server.FindTopDocuments("funny curly -rat"s);
+    search_server.MatchDocument("funny curly"s, 2);
+    search_server.RemoveDocument(1);
+    const auto snapshot = MetricsRegistry::Snapshot();
+    const auto* find_total = snapshot.Find(Operation::FIND_TOP_DOCUMENTS, Phase::TOTAL);
+    ASSERT_HINT(find_total != nullptr && find_total->count == 1, "FindTopDocuments must be measured"s);
+    ASSERT_HINT(snapshot.Find(Operation::FIND_TOP_DOCUMENTS, Phase::SORT) != nullptr, "Sort phase must be measured"s);
+    ASSERT_HINT(snapshot.Find(Operation::ADD_DOCUMENT, Phase::INDEX)->count == 2, "AddDocument must be measured"s);
+    ASSERT_HINT(snapshot.Find(Operation::MATCH_DOCUMENT, Phase::SCORE) != nullptr, "MatchDocument must be measured"s);
+    ASSERT_HINT(snapshot.Find(Operation::REMOVE_DOCUMENT, Phase::TOTAL) != nullptr, "RemoveDocument must be measured"s);
+    ASSERT_EQUAL_HINT(snapshot.GetCounter(Counter::POSTINGS_VISITED), 3u, "Error in postings counter"s);
+    ASSERT_EQUAL_HINT(snapshot.GetCounter(Counter::DOCUMENTS_SCORED), 2u, "Error in scored documents counter"s);
+
+    // Every plus word of the ALL query has a bitmap, so candidates come from the bitmap intersection.
+    MetricsRegistry::Reset();
+    search_server.AddDocument(3, "funny pet with a nasty cat"s, DocumentStatus::ACTUAL, { 4 });
+    search_server.Freeze();
+    search_server.FindTopDocuments(search_server.CompileQuery("funny pet"s, QueryMode::ALL));
+    const auto* bitmap_score = MetricsRegistry::Snapshot().Find(Operation::FIND_TOP_DOCUMENTS, Phase::SCORE);
+    ASSERT_HINT(bitmap_score != nullptr && bitmap_score->count == 1, "Bitmap intersection must be measured"s);
+#endif
+}
+
+void TestShardServer() {
+    CorpusOptions corpus_options;
+    corpus_options.document_count = 200;
+    corpus_options.vocabulary_size = 150;
+    const CorpusGenerator generator(corpus_options);
+    SearchServer search_server(generator.GetStopWordsText());
+    std::vector<std::unique_ptr<SearchServer>> shards;
+    std::vector<std::unique_ptr<ShardServer>> shard_servers;
+    std::vector<std::thread> serving;
+    std::vector<std::string> socket_paths;
+    for (int i = 0; i < 2; ++i) {
+        socket_paths.push_back("/tmp/search_server_test_"s + std::to_string(::getpid()) + "_"s + std::to_string(i) + ".sock"s);
+        shards.push_back(std::make_unique<SearchServer>(generator.GetStopWordsText()));
+        shard_servers.push_back(std::make_unique<ShardServer>(*shards.back(), socket_paths.back()));
+        serving.emplace_back([&shard_server = *shard_servers.back()]() { shard_server.Serve(); });
+    }
+    {
+        ShardAggregator aggregator(socket_paths);
+        for (const auto& document : generator.GenerateDocuments()) {
+            search_server.AddDocument(document.id, document.text, document.status, document.ratings);
+            aggregator.AddDocument(document.id, document.text, document.status, document.ratings);
+        }
+        // Every shard expands word* below the cap, the union exceeds it. Words beyond
+        // the cap are in shorter documents, so they would rank first if expanded.
+        for (size_t i = 0; i < MAX_PREFIX_EXPANSION_COUNT + 10; ++i) {
+            const int document_id = static_cast<int>(1000 + i);
+            const auto text = "word"s + std::to_string(document_id) + (i < MAX_PREFIX_EXPANSION_COUNT ? " long text"s : ""s);
+            search_server.AddDocument(document_id, text, DocumentStatus::ACTUAL, { 1 });
+            aggregator.AddDocument(document_id, text, DocumentStatus::ACTUAL, { 1 });
+        }
+        ASSERT_EQUAL_HINT(aggregator.GetDocumentCount(), search_server.GetDocumentCount(), "Error in remote document count"s);
+        ASSERT_HINT(shards[0]->GetDocumentCount() > 0 && shards[1]->GetDocumentCount() > 0, "Documents must be spread over shards"s);
+        QueryOptions query_options;
+        query_options.query_count = 30;
+        auto queries = generator.GenerateQueries(query_options);
+        queries.push_back("word*"s);
+        queries.push_back("word* -word100*"s);
+        queries.push_back(generator.GetVocabulary().front() + " word101*"s);
+        const auto remote_results = aggregator.FindTopDocuments(queries);
+        for (size_t i = 0; i < queries.size(); ++i) {
+            const auto expected = search_server.FindTopDocuments(queries[i]);
+            const auto& actual = remote_results[i];
+            ASSERT_EQUAL_HINT(actual.size(), expected.size(), "Error in remote search"s);
+            for (size_t j = 0; j < actual.size(); ++j) {
+                ASSERT_EQUAL_HINT(actual[j].id, expected[j].id, "Error in remote ranking"s);
+                ASSERT_EQUAL_HINT(actual[j].relevance, expected[j].relevance, "Remote scores must match the single server"s);
+            }
+            ASSERT_EQUAL_HINT(aggregator.FindTopDocuments(queries[i], DocumentStatus::BANNED).size(),
+                              search_server.FindTopDocuments(queries[i], DocumentStatus::BANNED).size(),
+                              "Error in remote status search"s);
+        }
+        const auto& word = generator.GetVocabulary().front();
+        const auto [words, status] = aggregator.MatchDocument(word, 0);
+        const auto [expected_words, expected_status] = search_server.MatchDocument(word, 0);
+        ASSERT_EQUAL_HINT(words.size(), expected_words.size(), "Error in remote matching"s);
+        ASSERT_HINT(status == expected_status, "Error in remote matching status"s);
+        aggregator.RemoveDocument(0);
+        search_server.RemoveDocument(0);
+        ASSERT_EQUAL_HINT(aggregator.GetDocumentCount(), search_server.GetDocumentCount(), "Error in remote removal"s);
+        try {
+            aggregator.AddDocument(1, "duplicate"s, DocumentStatus::ACTUAL, { 1 });
+            ASSERT_HINT(false, "Duplicate id must be rejected"s);
+        }
+        catch (const std::invalid_argument&) {
+        }
+        try {
+            aggregator.MatchDocument(word, 0);
+            ASSERT_HINT(false, "Removed id must be rejected"s);
+        }
+        catch (const std::out_of_range&) {
+        }
+        try {
+            aggregator.FindTopDocuments(std::vector<std::string>{ "--cat"s, word });
+            ASSERT_HINT(false, "Invalid query must be rejected"s);
+        }
+        catch (const std::invalid_argument&) {
+        }
+        ASSERT_EQUAL_HINT(aggregator.FindTopDocuments(word).size(), search_server.FindTopDocuments(word).size(),
+                          "Connection must stay usable after errors"s);
+    }
+    for (size_t i = 0; i < shard_servers.size(); ++i) {
+        shard_servers[i]->Stop();
+        serving[i].join();
+    }
+}
+
+void TestMemoryResources() {
+    std::vector<std::byte> index_buffer(1 << 20);
+    std::pmr::monotonic_buffer_resource index_arena(index_buffer.data(), index_buffer.size(), std::pmr::null_memory_resource());
+    SearchServer search_server("and with"s, &index_arena);
+    const std::vector<int> ratings = { 1, 2, 3 };
+    search_server.AddDocument(0, "warm up the scratch arena with a rather long document text", DocumentStatus::ACTUAL, ratings);
+    search_server.FindTopDocuments("warm up the scratch arena with a rather long query -text -document");
+    const size_t scratch_capacity = ScratchArena::ForCurrentThread().GetCapacity();
+    // The assertions themselves allocate, so the counts are taken before them.
+    const auto count_allocations = [](auto func) {
+        const size_t allocations_before = allocation_count;
+        func();
+        return allocation_count - allocations_before;
+    };
+
+    const size_t add_allocations = count_allocations([&]() {
+        search_server.AddDocument(1, "funny pet and nasty rat", DocumentStatus::ACTUAL, ratings);
+        search_server.AddDocument(2, "funny pet with curly hair", DocumentStatus::ACTUAL, ratings);
+        search_server.AddDocument(3, "nasty rat with curly hair", DocumentStatus::ACTUAL, ratings);
+    });
+    ASSERT_EQUAL_HINT(add_allocations, 0u, "Index must be built in its memory resource"s);
+
+    std::vector<Document> documents;
+    const size_t find_allocations = count_allocations([&]() { documents = search_server.FindTopDocuments("curly nasty rat -funny"); });
+    ASSERT_EQUAL_HINT(find_allocations, 1u, "Only the result may be allocated on the heap"s);
+    ASSERT_EQUAL_HINT(documents.size(), 1u, "Error in search with memory resources"s);
+    ASSERT_EQUAL_HINT(documents.front().id, 3, "Error in search with memory resources"s);
+    const size_t empty_find_allocations = count_allocations([&]() { documents = search_server.FindTopDocuments("unknown words only"); });
+    ASSERT_EQUAL_HINT(empty_find_allocations, 0u, "Empty search must not allocate"s);
+    ASSERT_HINT(documents.empty(), "Error in search with memory resources"s);
+    std::tuple<std::vector<std::string_view>, DocumentStatus> match;
+    const size_t match_allocations = count_allocations([&]() { match = search_server.MatchDocument("curly hair -rat", 2); });
+    ASSERT_EQUAL_HINT(match_allocations, 1u, "Only the matched words may be allocated on the heap"s);
+    ASSERT_EQUAL_HINT(std::get<0>(match).size(), 2u, "Error in matching with memory resources"s);
+    ASSERT_EQUAL_HINT(ScratchArena::ForCurrentThread().GetCapacity(), scratch_capacity, "Scratch arena must be reused"s);
+
+    ScratchArena arena(64);
+    {
+        std::pmr::vector<int> numbers(&arena);
+        for (int i = 0; i < 1000; ++i) {
+            numbers.push_back(i);
+        }
+        ASSERT_EQUAL_HINT(std::accumulate(numbers.begin(), numbers.end(), 0), 499500, "Error in scratch arena"s);
+    }
+    const size_t capacity = arena.GetCapacity();
+    arena.Reset();
+    {
+        std::pmr::vector<int> numbers(&arena);
+        numbers.assign(1000, 1);
+    }
+    ASSERT_EQUAL_HINT(arena.GetCapacity(), capacity, "Reset arena must reuse its blocks"s);
+}
+
+void TestCompiledQuery() {
+    CorpusOptions corpus_options;
+    corpus_options.document_count = 300;
+    corpus_options.vocabulary_size = 200;
+    const CorpusGenerator generator(corpus_options);
+    SearchServer search_server = MakeGeneratedServer(generator);
+    QueryOptions query_options;
+    query_options.query_count = 100;
+    for (const auto& raw_query : generator.GenerateQueries(query_options)) {
+        const auto query = search_server.CompileQuery(raw_query);
+        for (int repeat = 0; repeat < 2; ++repeat) {
+            const auto expected = search_server.FindTopDocuments(std::execution::seq, raw_query);
+            const auto actual = search_server.FindTopDocuments(query);
+            ASSERT_EQUAL_HINT(actual.size(), expected.size(), "Error in compiled query search"s);
+            for (size_t i = 0; i < actual.size(); ++i) {
+                ASSERT_EQUAL_HINT(actual[i].id, expected[i].id, "Error in compiled query ranking"s);
+                ASSERT_EQUAL_HINT(actual[i].relevance, expected[i].relevance, "Compiled query must score exactly as the text"s);
+            }
+        }
+        ASSERT_EQUAL_HINT(search_server.FindTopDocuments(query, DocumentStatus::BANNED).size(),
+                          search_server.FindTopDocuments(raw_query, DocumentStatus::BANNED).size(),
+                          "Error in compiled query status search"s);
+    }
+
+    SearchServer small_server("and with"s);
+    small_server.AddDocument(1, "funny pet and nasty rat", DocumentStatus::ACTUAL, { 1 });
+    small_server.AddDocument(2, "funny pet with curly hair", DocumentStatus::ACTUAL, { 2 });
+    const auto query = small_server.CompileQuery("rat pet unknown and pet -hair -missing");
+    ASSERT_EQUAL_HINT(query.GetPlusTermCount(), 2u, "Unknown words, stop words and duplicates must be dropped"s);
+    ASSERT_EQUAL_HINT(query.GetMinusTermCount(), 1u, "Unknown minus words must be dropped"s);
+    const auto [words, status] = small_server.MatchDocument(query, 1);
+    ASSERT_EQUAL_HINT(words.size(), 2u, "Error in compiled query matching"s);
+    ASSERT_EQUAL_HINT(words[0], "pet"s, "Matched words must be sorted"s);
+    ASSERT_EQUAL_HINT(words[1], "rat"s, "Matched words must be sorted"s);
+    ASSERT_HINT(std::get<0>(small_server.MatchDocument(query, 2)).empty(), "Minus word must exclude the document"s);
+    const auto documents = small_server.FindTopDocuments(query);
+    ASSERT_EQUAL_HINT(documents.size(), 1u, "Error in compiled query search"s);
+    ASSERT_EQUAL_HINT(documents.front().id, 1, "Error in compiled query search"s);
+    try {
+        search_server.FindTopDocuments(query);
+        ASSERT_HINT(false, "Query of another server must be rejected"s);
+    }
+    catch (const std::invalid_argument&) {
+    }
+    try {
+        small_server.CompileQuery("rat --pet"s);
+        ASSERT_HINT(false, "Invalid query must be rejected"s);
+    }
+    catch (const std::invalid_argument&) {
+    }
+}
+
+void TestFrozenIndex() {
+    CorpusOptions corpus_options;
+    corpus_options.document_count = 300;
+    corpus_options.vocabulary_size = 200;
+    const CorpusGenerator generator(corpus_options);
+    SearchServer search_server = MakeGeneratedServer(generator);
+    SearchServer frozen_server = MakeGeneratedServer(generator);
+    search_server.RemoveDocument(7);
+    frozen_server.RemoveDocument(7);
+    QueryOptions query_options;
+    query_options.query_count = 100;
+    const auto queries = generator.GenerateQueries(query_options);
+    const auto compiled_query = frozen_server.CompileQuery(queries.front());
+    frozen_server.Freeze();
+    ASSERT_HINT(frozen_server.IsFrozen() && !search_server.IsFrozen(), "Error in frozen state"s);
+    ASSERT_EQUAL_HINT(frozen_server.GetDocumentCount(), search_server.GetDocumentCount(), "Error in frozen document count"s);
+    for (const auto& query : queries) {
+        for (const auto status : { DocumentStatus::ACTUAL, DocumentStatus::BANNED }) {
+            const auto expected = search_server.FindTopDocuments(query, status);
+            const auto actual = frozen_server.FindTopDocuments(query, status);
+            ASSERT_EQUAL_HINT(actual.size(), expected.size(), "Error in frozen search"s);
+            for (size_t i = 0; i < actual.size(); ++i) {
+                ASSERT_EQUAL_HINT(actual[i].id, expected[i].id, "Error in frozen ranking"s);
+                ASSERT_EQUAL_HINT(actual[i].relevance, expected[i].relevance, "Frozen index must score exactly as the mutable one"s);
+                ASSERT_EQUAL_HINT(actual[i].rating, expected[i].rating, "Error in frozen ratings"s);
+            }
+        }
+        ASSERT_EQUAL_HINT(frozen_server.FindTopDocuments(std::execution::par, query).size(),
+                          search_server.FindTopDocuments(query).size(), "Error in frozen parallel search"s);
+        for (const int document_id : { 0, 8, 299 }) {
+            const auto [words, status] = frozen_server.MatchDocument(query, document_id);
+            const auto [expected_words, expected_status] = search_server.MatchDocument(query, document_id);
+            ASSERT_HINT(words == expected_words, "Error in frozen matching"s);
+            ASSERT_HINT(status == expected_status, "Error in frozen matching status"s);
+        }
+    }
+    ASSERT_EQUAL_HINT(frozen_server.FindTopDocuments(compiled_query).size(), search_server.FindTopDocuments(queries.front()).size(),
+                      "Query compiled before freezing must stay valid"s);
+    ASSERT_HINT(frozen_server.FindTopDocuments("nonexistentword"s).empty(), "Unknown word must not be found"s);
+    try {
+        frozen_server.AddDocument(1000, "new document"s, DocumentStatus::ACTUAL, { 1 });
+        ASSERT_HINT(false, "Frozen index must reject new documents"s);
+    }
+    catch (const std::logic_error&) {
+    }
+    try {
+        frozen_server.RemoveDocument(std::execution::par, 0);
+        ASSERT_HINT(false, "Frozen index must reject removal"s);
+    }
+    catch (const std::logic_error&) {
+    }
+    SearchServer empty_server;
+    empty_server.Freeze();
+    ASSERT_HINT(empty_server.FindTopDocuments("cat"s).empty(), "Error in empty frozen index"s);
+
+    std::pmr::vector<std::string_view> keys;
+    for (const auto& word : generator.GetVocabulary()) {
+        keys.push_back(word);
+    }
+    const PerfectHash perfect_hash(keys, std::pmr::get_default_resource());
+    std::vector<bool> is_taken(keys.size(), false);
+    for (std::string_view key : keys) {
+        const size_t slot = perfect_hash(key);
+        ASSERT_HINT(slot < keys.size() && !is_taken[slot], "Perfect hash must map keys onto distinct slots"s);
+        is_taken[slot] = true;
+    }
+}
+
+void TestTermFreqPrecision() {
+    CorpusOptions corpus_options;
+    corpus_options.document_count = 300;
+    corpus_options.vocabulary_size = 200;
+    const CorpusGenerator generator(corpus_options);
+    QueryOptions query_options;
+    query_options.query_count = 100;
+    const auto queries = generator.GenerateQueries(query_options);
+    SearchServer exact_server = MakeGeneratedServer(generator);
+    exact_server.Freeze();
+    for (const auto& [precision, max_level] : { std::pair{ TermFreqPrecision::FLOAT, 16777216.0 },
+                                                std::pair{ TermFreqPrecision::UINT16, 65535.0 },
+                                                std::pair{ TermFreqPrecision::UINT8, 255.0 } }) {
+        SearchServer search_server = MakeGeneratedServer(generator);
+        search_server.Freeze(precision);
+        for (const auto& query : queries) {
+            const auto expected = exact_server.FindTopDocuments(query);
+            const auto actual = search_server.FindTopDocuments(query);
+            ASSERT_EQUAL_HINT(actual.size(), expected.size(), "Quantization must not change matched documents"s);
+            const double tolerance = SplitIntoWords(query).size() * std::log(300.0) / (2 * max_level) + 2 * RELEVANCE_EPSILON;
+            for (size_t i = 0; i < actual.size(); ++i) {
+                ASSERT_HINT(std::abs(actual[i].relevance - expected[i].relevance) <= tolerance,
+                            "Quantized relevance must stay within the documented tolerance"s);
+            }
+            ASSERT_EQUAL_HINT(search_server.FindTopDocuments(std::execution::par, query).size(), expected.size(),
+                              "Error in quantized parallel search"s);
+        }
+
+        SearchServer tie_server;
+        tie_server.AddDocument(1, "white cat white collar"s, DocumentStatus::ACTUAL, { 1 });
+        tie_server.AddDocument(2, "white cat white collar"s, DocumentStatus::ACTUAL, { 5 });
+        tie_server.AddDocument(3, "black dog"s, DocumentStatus::ACTUAL, { 3 });
+        tie_server.Freeze(precision);
+        const auto documents = tie_server.FindTopDocuments("white cat"s);
+        ASSERT_EQUAL_HINT(documents.size(), 2u, "Error in quantized search"s);
+        ASSERT_HINT(documents[0].id == 2 && documents[1].id == 1, "Tied documents must stay ordered by rating"s);
+        ASSERT_EQUAL_HINT(documents[0].relevance, documents[1].relevance, "Equal frequencies must stay equal"s);
+    }
+}
+
+void TestQueryPlanner() {
+    SearchServer search_server("and with"s);
+    search_server.AddDocument(1, "funny pet and nasty rat", DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(2, "funny pet with curly hair", DocumentStatus::ACTUAL, { 2 });
+    search_server.AddDocument(3, "nasty rat with curly hair", DocumentStatus::ACTUAL, { 3 });
+    search_server.AddDocument(4, "funny dog with curly tail", DocumentStatus::BANNED, { 4 });
+
+    const auto plan = search_server.ExplainQuery("curly pet unknown -rat -dog");
+    ASSERT_HINT(plan.strategy == QueryStrategy::DOCUMENT_AT_A_TIME, "Short query must be evaluated document at a time"s);
+    ASSERT_EQUAL_HINT(plan.posting_count, 5u, "Error in planned posting count"s);
+    ASSERT_EQUAL_HINT(plan.terms.size(), 4u, "Unknown words must not be planned"s);
+    ASSERT_HINT(plan.terms[0].is_minus && plan.terms[0].word == "rat"s, "Frequent minus words must come first"s);
+    ASSERT_HINT(plan.terms[1].is_minus && plan.terms[1].word == "dog"s, "Error in minus word order"s);
+    ASSERT_HINT(!plan.terms[2].is_minus && plan.terms[2].word == "pet"s, "Rare plus words must come first"s);
+    ASSERT_EQUAL_HINT(plan.terms[3].document_count, 3u, "Error in planned document frequency"s);
+    std::ostringstream plan_text;
+    plan_text << plan;
+    ASSERT_HINT(plan_text.str().find("DOCUMENT_AT_A_TIME"s) != std::string::npos, "Error in plan output"s);
+
+    ASSERT_HINT(search_server.ExplainQuery("pet -funny").strategy == QueryStrategy::EMPTY,
+                "Minus word covering the candidates must empty the plan"s);
+    ASSERT_HINT(search_server.ExplainQuery(search_server.CompileQuery("pet curly -funny", QueryMode::ALL)).strategy
+                    == QueryStrategy::EMPTY, "Minus word covering a plus word must empty an ALL plan"s);
+    ASSERT_HINT(search_server.FindTopDocuments("pet -funny").empty(), "Error in search with a covered candidate set"s);
+    ASSERT_HINT(search_server.ExplainQuery("pet hair -funny").strategy != QueryStrategy::EMPTY,
+                "Minus word missing from a candidate must not empty the plan"s);
+    const auto empty_plan = search_server.ExplainQuery("nasty rat -curly -funny");
+    ASSERT_HINT(empty_plan.strategy == QueryStrategy::DOCUMENT_AT_A_TIME, "Minus words missing from some documents must not empty the plan"s);
+    search_server.AddDocument(5, "curly nasty rat", DocumentStatus::ACTUAL, { 5 });
+    search_server.AddDocument(6, "funny curly rat", DocumentStatus::ACTUAL, { 6 });
+    search_server.AddDocument(7, "curly funny pet", DocumentStatus::ACTUAL, { 7 });
+    search_server.RemoveDocument(1);
+    ASSERT_HINT(search_server.ExplainQuery("nasty rat -curly").strategy == QueryStrategy::EMPTY,
+                "Minus word found in every document must empty the plan"s);
+    ASSERT_HINT(search_server.FindTopDocuments("nasty rat -curly").empty(), "Error in search with an empty plan"s);
+    ASSERT_HINT(search_server.ExplainQuery("unknown").strategy == QueryStrategy::EMPTY, "Query without postings must be empty"s);
+
+    CorpusOptions corpus_options;
+    corpus_options.document_count = 300;
+    corpus_options.vocabulary_size = 40;
+    const CorpusGenerator generator(corpus_options);
+    SearchServer corpus_server = MakeGeneratedServer(generator);
+    std::string long_query;
+    for (const auto& word : generator.GetVocabulary()) {
+        long_query += word + " "s;
+    }
+    const std::string minus_query = long_query + "-"s + generator.GetVocabulary().back();
+    for (const auto& query : { long_query, minus_query, generator.GetVocabulary().front() }) {
+        const auto expected = corpus_server.FindTopDocuments(std::execution::par, query);
+        const auto actual = corpus_server.FindTopDocuments(query);
+        ASSERT_EQUAL_HINT(actual.size(), expected.size(), "Error in planned search"s);
+        for (size_t i = 0; i < actual.size(); ++i) {
+            ASSERT_HINT(std::abs(actual[i].relevance - expected[i].relevance) < RELEVANCE_EPSILON, "Error in planned relevance"s);
+        }
+    }
+    ASSERT_HINT(corpus_server.ExplainQuery(long_query).strategy == QueryStrategy::DOCUMENT_AT_A_TIME,
+                "Dense query must be evaluated document at a time"s);
+
+    SearchServer sparse_server;
+    std::string sparse_query;
+    for (int i = 0; i < 200; ++i) {
+        sparse_server.AddDocument(i, "word"s + std::to_string(i) + " common"s, DocumentStatus::ACTUAL, { i });
+        sparse_query += "word"s + std::to_string(i) + " "s;
+    }
+    ASSERT_HINT(sparse_server.ExplainQuery(sparse_query).strategy == QueryStrategy::TERM_AT_A_TIME,
+                "Query with many rare terms must be evaluated term at a time"s);
+    const auto sparse_documents = sparse_server.FindTopDocuments(sparse_query + "-word199"s);
+    ASSERT_EQUAL_HINT(sparse_documents.size(), 5u, "Error in term at a time search"s);
+    ASSERT_EQUAL_HINT(sparse_documents.front().id, 198, "Error in term at a time ranking"s);
+    ASSERT_EQUAL_HINT(sparse_server.FindTopDocuments(sparse_query + "common"s).size(), 5u, "Error in term at a time search"s);
+}
+
+void TestPrefixQuery() {
+    SearchServer search_server("in the"s);
+    search_server.AddDocument(1, "run in the park", DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(2, "runner in the city", DocumentStatus::ACTUAL, { 2 });
+    search_server.AddDocument(3, "running late", DocumentStatus::ACTUAL, { 3 });
+    search_server.AddDocument(4, "ran away", DocumentStatus::ACTUAL, { 4 });
+    search_server.AddDocument(5, "rung of the ladder", DocumentStatus::ACTUAL, { 5 });
+    search_server.AddDocument(6, "runway lights", DocumentStatus::ACTUAL, { 6 });
+    search_server.RemoveDocument(6);
+
+    const auto documents = search_server.FindTopDocuments("run*"s);
+    ASSERT_EQUAL_HINT(documents.size(), 4u, "Prefix must match all words starting with it"s);
+    const auto plan = search_server.ExplainQuery("run* -rung"s);
+    ASSERT_EQUAL_HINT(plan.terms.size(), 5u, "Words without documents must not be expanded"s);
+    ASSERT_EQUAL_HINT(search_server.FindTopDocuments("run* -rung"s).size(), 3u, "Error in prefix with minus word"s);
+    ASSERT_EQUAL_HINT(search_server.FindTopDocuments("r* -runn*"s).size(), 3u, "Error in minus prefix"s);
+    ASSERT_EQUAL_HINT(search_server.FindTopDocuments("th*"s).size(), 0u, "Stop words must not be expanded"s);
+    ASSERT_EQUAL_HINT(search_server.FindTopDocuments("city runn*"s).front().id, 2, "Error in prefix relevance"s);
+    const auto [words, status] = search_server.MatchDocument("run* park"s, 1);
+    ASSERT_EQUAL_HINT(words.size(), 2u, "Error in prefix matching"s);
+    ASSERT_EQUAL_HINT(words[0], "park"s, "Error in prefix matching"s);
+    ASSERT_EQUAL_HINT(words[1], "run"s, "Matched words must be the expanded ones"s);
+    for (const std::string& invalid_query : { "*"s, "-*"s, "run --r*"s }) {
+        try {
+            search_server.FindTopDocuments(invalid_query);
+            ASSERT_HINT(false, "Empty prefix must be rejected"s);
+        }
+        catch (const std::invalid_argument&) {
+        }
+    }
+
+    for (size_t i = 0; i < MAX_PREFIX_EXPANSION_COUNT + 10; ++i) {
+        search_server.AddDocument(static_cast<int>(100 + i), "word"s + std::to_string(1000 + i), DocumentStatus::ACTUAL, { 1 });
+    }
+    const auto capped_plan = search_server.ExplainQuery("word*"s);
+    ASSERT_EQUAL_HINT(capped_plan.terms.size(), MAX_PREFIX_EXPANSION_COUNT, "Expansion count must be capped"s);
+    ASSERT_HINT(std::get<0>(search_server.MatchDocument("word*"s, 100)).size() == 1, "First words must be expanded"s);
+    ASSERT_HINT(std::get<0>(search_server.MatchDocument("word*"s, static_cast<int>(100 + MAX_PREFIX_EXPANSION_COUNT))).empty(),
+                "Words beyond the cap must not be expanded"s);
+    const auto compiled_query = search_server.CompileQuery("run* word100*"s);
+    search_server.Freeze();
+    ASSERT_EQUAL_HINT(search_server.FindTopDocuments("run*"s).size(), 4u, "Error in frozen prefix search"s);
+    ASSERT_EQUAL_HINT(search_server.ExplainQuery("word*"s).terms.size(), MAX_PREFIX_EXPANSION_COUNT, "Error in frozen expansion cap"s);
+    ASSERT_EQUAL_HINT(search_server.FindTopDocuments(compiled_query).size(), 5u, "Error in compiled prefix query"s);
+
+    CorpusOptions corpus_options;
+    corpus_options.document_count = 300;
+    corpus_options.vocabulary_size = 500;
+    const CorpusGenerator generator(corpus_options);
+    const SearchServer single_server = MakeGeneratedServer(generator);
+    ShardedSearchServer sharded_server(3, generator.GetStopWordsText());
+    for (const auto& document : generator.GenerateDocuments()) {
+        sharded_server.AddDocument(document.id, document.text, document.status, document.ratings);
+    }
+    for (const auto& query : { "b*"s, "ba* -be*"s, "k* zu*"s }) {
+        const auto expected = single_server.FindTopDocuments(query);
+        const auto actual = sharded_server.FindTopDocuments(query);
+        ASSERT_EQUAL_HINT(actual.size(), expected.size(), "Error in sharded prefix search"s);
+        for (size_t i = 0; i < actual.size(); ++i) {
+            ASSERT_EQUAL_HINT(actual[i].id, expected[i].id, "Error in sharded prefix ranking"s);
+            ASSERT_EQUAL_HINT(actual[i].relevance, expected[i].relevance, "Sharded prefix scores must match the single server"s);
+        }
+    }
+}
+
+void TestWordFrequencies() {
+    SearchServer search_server("and"s);
+    search_server.AddDocument(1, "funny pet and nasty rat rat"s, DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(2, "curly rat"s, DocumentStatus::ACTUAL, { 1 });
+    const std::map<std::string_view, double> expected = { { "funny", 0.2 }, { "pet", 0.2 }, { "nasty", 0.2 }, { "rat", 0.4 } };
+    const auto check = [&expected](const SearchServer& server, const std::string& hint) {
+        const auto word_frequencies = server.GetWordFrequencies(1);
+        ASSERT_EQUAL_HINT(word_frequencies.size(), expected.size(), hint);
+        std::map<std::string_view, double> actual(word_frequencies.begin(), word_frequencies.end());
+        ASSERT_EQUAL_HINT(actual.size(), expected.size(), hint);
+        for (const auto& [word, term_freq] : expected) {
+            ASSERT_HINT(actual.count(word) > 0 && std::abs(actual.at(word) - term_freq) < RELEVANCE_EPSILON, hint);
+        }
+        ASSERT_HINT(server.GetWordFrequencies(3).empty(), "Unknown document must have no words"s);
+    };
+    check(search_server, "Error in word frequencies"s);
+    search_server.RemoveDocument(2);
+    check(search_server, "Removal must not change other documents"s);
+    search_server.Freeze();
+    check(search_server, "Error in frozen word frequencies"s);
+    ASSERT_HINT(search_server.GetWordFrequencies(2).empty(), "Removed document must have no words"s);
+}
+
+void TestCorpusIngestion() {
+    CorpusOptions corpus_options;
+    corpus_options.document_count = 300;
+    corpus_options.vocabulary_size = 200;
+    const CorpusGenerator generator(corpus_options);
+    const auto documents = generator.GenerateDocuments();
+    const SearchServer expected_server = MakeGeneratedServer(generator);
+    std::ostringstream corpus;
+    WriteCorpus(corpus, documents);
+    corpus << "\r\n\n"s;
+    IngestionOptions options;
+    options.tokenizer_count = 3;
+    options.block_size = 100;
+    options.queue_capacity = 2;
+    SearchServer search_server(generator.GetStopWordsText());
+    std::istringstream input(corpus.str());
+    const auto stats = IngestCorpus(search_server, input, options);
+    ASSERT_EQUAL_HINT(stats.document_count, documents.size(), "Error in ingested document count"s);
+    ASSERT_EQUAL_HINT(stats.byte_count, corpus.str().size(), "Error in ingested byte count"s);
+    ASSERT_EQUAL_HINT(search_server.GetDocumentCount(), expected_server.GetDocumentCount(), "Error in corpus ingestion"s);
+    QueryOptions query_options;
+    query_options.query_count = 50;
+    for (const auto& query : generator.GenerateQueries(query_options)) {
+        for (const auto status : { DocumentStatus::ACTUAL, DocumentStatus::BANNED }) {
+            const auto expected = expected_server.FindTopDocuments(query, status);
+            const auto actual = search_server.FindTopDocuments(query, status);
+            ASSERT_EQUAL_HINT(actual.size(), expected.size(), "Error in search over ingested corpus"s);
+            for (size_t i = 0; i < actual.size(); ++i) {
+                ASSERT_EQUAL_HINT(actual[i].id, expected[i].id, "Error in ranking over ingested corpus"s);
+                ASSERT_EQUAL_HINT(actual[i].relevance, expected[i].relevance, "Ingested documents must score as added ones"s);
+                ASSERT_EQUAL_HINT(actual[i].rating, expected[i].rating, "Error in ingested ratings"s);
+            }
+        }
+    }
+
+    for (const std::string& text : { "1\tACTUAL\t1 2\tcat\n2\tUNKNOWN\t\tdog\n"s,
+                                     "1\tACTUAL\tcat\n"s,
+                                     "1\tACTUAL\t\tcat\n1\tBANNED\t\tdog\n"s }) {
+        SearchServer invalid_server;
+        std::istringstream invalid_input(text);
+        try {
+            IngestCorpus(invalid_server, invalid_input, options);
+            ASSERT_HINT(false, "Invalid corpus must be rejected"s);
+        }
+        catch (const std::invalid_argument&) {
+        }
+    }
+    char path[] = "/tmp/search_server_corpusXXXXXX";
+    const int fd = mkstemp(path);
+    ASSERT_HINT(fd >= 0, "Cannot create a temporary corpus file"s);
+    const std::string corpus_text = corpus.str();
+    ASSERT_EQUAL_HINT(write(fd, corpus_text.data(), corpus_text.size()), static_cast<ssize_t>(corpus_text.size()),
+                      "Cannot write the temporary corpus file"s);
+    close(fd);
+    SearchServer file_server(generator.GetStopWordsText());
+    const auto file_stats = IngestCorpus(file_server, std::string(path));
+    unlink(path);
+    ASSERT_EQUAL_HINT(file_stats.document_count, documents.size(), "Error in corpus ingestion from a file"s);
+    ASSERT_EQUAL_HINT(file_server.GetDocumentCount(), expected_server.GetDocumentCount(), "Error in corpus ingestion from a file"s);
+    try {
+        SearchServer missing_server;
+        IngestCorpus(missing_server, "/nonexistent/corpus.tsv"s);
+        ASSERT_HINT(false, "Missing file must be reported"s);
+    }
+    catch (const std::runtime_error&) {
+    }
+}
+
+void TestMutationLog() {
+    CorpusOptions corpus_options;
+    corpus_options.document_count = 200;
+    corpus_options.vocabulary_size = 200;
+    const CorpusGenerator generator(corpus_options);
+    const auto documents = generator.GenerateDocuments();
+    char path[] = "/tmp/search_server_logXXXXXX";
+    const int fd = mkstemp(path);
+    ASSERT_HINT(fd >= 0, "Cannot create a temporary log file"s);
+    close(fd);
+    SearchServer expected_server = MakeGeneratedServer(generator);
+    {
+        MutationLog log(path);
+        const size_t THREAD_COUNT = 4;
+        std::vector<std::thread> writers;
+        for (size_t t = 0; t < THREAD_COUNT; ++t) {
+            writers.emplace_back([&log, &documents, t, THREAD_COUNT]() {
+                for (size_t i = t; i < documents.size(); i += THREAD_COUNT) {
+                    log.LogAddDocument(documents[i].id, documents[i].text, documents[i].status, documents[i].ratings);
+                }
+            });
+        }
+        for (auto& writer : writers) {
+            writer.join();
+        }
+        log.LogRemoveDocument(5);
+        expected_server.RemoveDocument(5);
+        log.LogRemoveDocument(5);
+        log.LogAddDocument(7, "duplicate"s, DocumentStatus::ACTUAL, {});
+        log.LogAddDocument(-1, "negative id"s, DocumentStatus::ACTUAL, {});
+        const auto stats = log.GetStats();
+        ASSERT_EQUAL_HINT(stats.record_count, documents.size() + 4, "Error in logged record count"s);
+        ASSERT_HINT(stats.sync_count > 0 && stats.sync_count <= stats.record_count, "Error in group commit"s);
+    }
+    const auto check_recovery = [&](size_t record_count, const std::string& hint) {
+        SearchServer search_server(generator.GetStopWordsText());
+        const auto stats = MutationLog::Recover(search_server, path);
+        ASSERT_EQUAL_HINT(stats.record_count, record_count, hint);
+        ASSERT_EQUAL_HINT(stats.rejected_count, 3u, hint);
+        ASSERT_EQUAL_HINT(search_server.GetDocumentCount(), expected_server.GetDocumentCount(), hint);
+        QueryOptions query_options;
+        query_options.query_count = 30;
+        for (const auto& query : generator.GenerateQueries(query_options)) {
+            const auto expected = expected_server.FindTopDocuments(query);
+            const auto actual = search_server.FindTopDocuments(query);
+            ASSERT_EQUAL_HINT(actual.size(), expected.size(), hint);
+            for (size_t i = 0; i < actual.size(); ++i) {
+                ASSERT_EQUAL_HINT(actual[i].id, expected[i].id, hint);
+                ASSERT_EQUAL_HINT(actual[i].relevance, expected[i].relevance, hint);
+            }
+        }
+        return stats;
+    };
+    const size_t record_count = documents.size() + 4;
+    ASSERT_EQUAL_HINT(check_recovery(record_count, "Error in log recovery"s).truncated_byte_count, 0u,
+                      "Intact log must not be truncated"s);
+
+    {
+        MutationLog log(path);
+        log.LogAddDocument(1000, "torn record"s, DocumentStatus::ACTUAL, { 1 });
+    }
+    struct stat file_stat {};
+    stat(path, &file_stat);
+    ASSERT_HINT(truncate(path, file_stat.st_size - 3) == 0, "Cannot tear the log"s);
+    const auto torn_stats = check_recovery(record_count, "Error in recovery from a torn log"s);
+    ASSERT_HINT(torn_stats.truncated_byte_count > 0, "Torn tail must be cut"s);
+    stat(path, &file_stat);
+    ASSERT_EQUAL_HINT(static_cast<uint64_t>(file_stat.st_size), torn_stats.valid_byte_count, "Torn tail must be truncated"s);
+
+    {
+        MutationLog log(path);
+        log.LogAddDocument(1001, "corrupted record"s, DocumentStatus::ACTUAL, { 1 });
+    }
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(-2, std::ios::end);
+        file.put('#');
+    }
+    ASSERT_HINT(check_recovery(record_count, "Error in recovery from a corrupted log"s).truncated_byte_count > 0,
+                "Record with a wrong checksum must be cut"s);
+    unlink(path);
+    SearchServer empty_server;
+    ASSERT_EQUAL_HINT(MutationLog::Recover(empty_server, path).record_count, 0u, "Missing log must be empty"s);
+}
+
+void TestConjunctiveQuery() {
+    SearchServer small_server("and with"s);
+    small_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 1 });
+    small_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 2 });
+    small_server.AddDocument(3, "nasty rat with curly hair"s, DocumentStatus::ACTUAL, { 3 });
+    const auto documents = small_server.FindTopDocuments(small_server.CompileQuery("funny pet"s, QueryMode::ALL));
+    ASSERT_EQUAL_HINT(documents.size(), 2u, "Error in ALL query"s);
+    const auto any_documents = small_server.FindTopDocuments("funny pet"s);
+    ASSERT_HINT(documents[0].id == any_documents[0].id && documents[0].relevance == any_documents[0].relevance,
+                "ALL query must score as ANY query"s);
+    const auto curly_rat = small_server.FindTopDocuments(small_server.CompileQuery("curly rat -funny"s, QueryMode::ALL));
+    ASSERT_HINT(curly_rat.size() == 1 && curly_rat[0].id == 3, "Error in ALL query with minus words"s);
+    ASSERT_HINT(small_server.FindTopDocuments(small_server.CompileQuery("funny dog"s, QueryMode::ALL)).empty(),
+                "Unknown plus word must empty an ALL query"s);
+    const auto [words, status] = small_server.MatchDocument(small_server.CompileQuery("curly pet"s, QueryMode::ALL), 3);
+    ASSERT_HINT(words.empty(), "Document without every plus word must not match an ALL query"s);
+    ASSERT_EQUAL_HINT(small_server.ExplainQuery(small_server.CompileQuery("funny pet"s, QueryMode::ALL)).strategy,
+                      QueryStrategy::CONJUNCTIVE, "Error in ALL query plan"s);
+    try {
+        small_server.CompileQuery("fun*"s, QueryMode::ALL);
+        ASSERT_HINT(false, "Prefix words must be rejected in ALL mode"s);
+    }
+    catch (const std::invalid_argument&) {
+    }
+
+    CorpusOptions corpus_options;
+    corpus_options.document_count = 500;
+    corpus_options.vocabulary_size = 200;
+    const CorpusGenerator generator(corpus_options);
+    SearchServer search_server = MakeGeneratedServer(generator);
+    SearchServer frozen_server = MakeGeneratedServer(generator);
+    frozen_server.Freeze();
+    QueryOptions query_options;
+    query_options.query_count = 200;
+    query_options.max_query_length = 3;
+    for (const auto& query : generator.GenerateQueries(query_options)) {
+        for (const SearchServer* server : { &search_server, &frozen_server }) {
+            const auto all_query = server->CompileQuery(query, QueryMode::ALL);
+            const auto any_query = server->CompileQuery(query);
+            std::vector<Document> expected;
+            if (server->ExplainQuery(all_query).strategy != QueryStrategy::EMPTY) {
+                expected = server->FindTopDocuments(any_query, [&](int document_id, DocumentStatus status, int) {
+                    return status == DocumentStatus::ACTUAL
+                        && std::get<0>(server->MatchDocument(any_query, document_id)).size() == any_query.GetPlusTermCount();
+                });
+            }
+            const auto actual = server->FindTopDocuments(all_query);
+            ASSERT_EQUAL_HINT(actual.size(), expected.size(), "Error in ALL query"s);
+            for (size_t i = 0; i < actual.size(); ++i) {
+                ASSERT_EQUAL_HINT(actual[i].id, expected[i].id, "Error in ALL query ranking"s);
+                ASSERT_EQUAL_HINT(actual[i].relevance, expected[i].relevance, "Error in ALL query relevance"s);
+            }
+            ASSERT_EQUAL_HINT(server->FindTopDocuments(std::execution::par, query).size(),
+                              server->FindTopDocuments(query).size(), "Error in parallel search"s);
+        }
+    }
+}
+
+void TestCountMatches() {
+    CorpusOptions corpus_options;
+    corpus_options.document_count = 3000;
+    corpus_options.vocabulary_size = 300;
+    const CorpusGenerator generator(corpus_options);
+    SearchServer search_server = MakeGeneratedServer(generator);
+    SearchServer frozen_server = MakeGeneratedServer(generator);
+    for (int document_id = 0; document_id < 3000; document_id += 3) {
+        search_server.RemoveDocument(document_id);
+        frozen_server.RemoveDocument(document_id);
+    }
+    frozen_server.Freeze();
+    QueryOptions query_options;
+    query_options.query_count = 100;
+    query_options.max_query_length = 3;
+    for (const auto& query : generator.GenerateQueries(query_options)) {
+        for (const SearchServer* server : { &search_server, &frozen_server }) {
+            for (const QueryMode mode : { QueryMode::ANY, QueryMode::ALL }) {
+                const auto compiled_query = server->CompileQuery(query, mode);
+                size_t expected = 0;
+                for (const int document_id : *server) {
+                    const auto [words, status] = server->MatchDocument(compiled_query, document_id);
+                    expected += !words.empty() && status == DocumentStatus::ACTUAL ? 1 : 0;
+                }
+                ASSERT_EQUAL_HINT(server->CountMatches(compiled_query), expected, "Error in exact count"s);
+                const double estimate = static_cast<double>(server->CountMatches(compiled_query, DocumentStatus::ACTUAL,
+                                                                                 CountMode::APPROXIMATE));
+                ASSERT_HINT(std::abs(estimate - expected) <= 0.35 * expected + 10.0, "Error in approximate count"s);
+            }
+        }
+    }
+
+    SearchServer small_server("and with"s);
+    small_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 1 });
+    small_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::BANNED, { 2 });
+    small_server.AddDocument(3, "nasty rat with curly hair"s, DocumentStatus::ACTUAL, { 3 });
+    ASSERT_EQUAL_HINT(small_server.CountMatches("funny rat -hair"s), 1u, "Error in count with minus words"s);
+    ASSERT_EQUAL_HINT(small_server.CountMatches("curly"s, DocumentStatus::BANNED), 1u, "Error in count by status"s);
+    ASSERT_EQUAL_HINT(small_server.CountMatches("pet rat"s, DocumentStatus::ACTUAL, CountMode::APPROXIMATE), 2u,
+                      "Approximate count of rare words must be exact"s);
+    ASSERT_EQUAL_HINT(small_server.CountMatches("dog"s), 0u, "Error in count of unknown word"s);
+}
+
+void TestDocumentOrder() {
+    CorpusOptions corpus_options;
+    corpus_options.document_count = 400;
+    corpus_options.vocabulary_size = 150;
+    const CorpusGenerator generator(corpus_options);
+    const auto build = [&generator]() {
+        SearchServer search_server = MakeGeneratedServer(generator);
+        for (int document_id = 0; document_id < 400; document_id += 4) {
+            search_server.RemoveDocument(document_id);
+        }
+        return search_server;
+    };
+    const auto expected_server = build();
+    QueryOptions query_options;
+    query_options.query_count = 100;
+    query_options.max_query_length = 3;
+    const auto queries = generator.GenerateQueries(query_options);
+    for (const DocumentOrder order : { DocumentOrder::ID, DocumentOrder::RATING, DocumentOrder::SIMILARITY }) {
+        auto search_server = build();
+        search_server.Freeze(TermFreqPrecision::DOUBLE, order);
+        ASSERT_HINT(std::equal(search_server.begin(), search_server.end(), expected_server.begin(), expected_server.end()),
+                    "Reordering must keep document ids"s);
+        for (const auto& query : queries) {
+            for (const QueryMode mode : { QueryMode::ANY, QueryMode::ALL }) {
+                const auto expected = expected_server.FindTopDocuments(expected_server.CompileQuery(query, mode));
+                const auto actual = search_server.FindTopDocuments(search_server.CompileQuery(query, mode));
+                ASSERT_EQUAL_HINT(actual.size(), expected.size(), "Reordering must not change matched documents"s);
+                for (size_t i = 0; i < actual.size(); ++i) {
+                    ASSERT_EQUAL_HINT(actual[i].id, expected[i].id, "Reordering must not change ranking"s);
+                    ASSERT_HINT(actual[i].relevance == expected[i].relevance && actual[i].rating == expected[i].rating,
+                                "Reordering must not change ranking"s);
+                }
+                ASSERT_EQUAL_HINT(search_server.CountMatches(search_server.CompileQuery(query, mode)),
+                                  expected_server.CountMatches(expected_server.CompileQuery(query, mode)),
+                                  "Error in count after reordering"s);
+            }
+            ASSERT_EQUAL_HINT(search_server.FindTopDocuments(std::execution::par, query).size(),
+                              expected_server.FindTopDocuments(query).size(), "Error in parallel search after reordering"s);
+            for (const int document_id : expected_server) {
+                ASSERT_HINT(search_server.MatchDocument(query, document_id) == expected_server.MatchDocument(query, document_id),
+                            "Reordering must not change matched words"s);
+            }
+        }
+        for (const int document_id : expected_server) {
+            const auto actual = search_server.GetWordFrequencies(document_id);
+            const auto expected = expected_server.GetWordFrequencies(document_id);
+            ASSERT_HINT(std::equal(actual.begin(), actual.end(), expected.begin(), expected.end()),
+                        "Reordering must not change word frequencies"s);
+        }
+    }
+
+    for (const DocumentOrder order : { DocumentOrder::ID, DocumentOrder::RATING, DocumentOrder::SIMILARITY }) {
+        SearchServer tied_server;
+        for (int document_id = 1; document_id <= 20; ++document_id) {
+            tied_server.AddDocument(document_id, "cat dog w"s + std::to_string(document_id), DocumentStatus::ACTUAL, { 5 });
+            tied_server.AddDocument(100 + document_id, "bird"s, DocumentStatus::ACTUAL, { 5 });
+        }
+        tied_server.Freeze(TermFreqPrecision::DOUBLE, order);
+        std::vector<int> ids;
+        for (const auto& document : tied_server.FindTopDocuments("cat dog"s)) {
+            ids.push_back(document.id);
+        }
+        ASSERT_EQUAL_HINT(ids, std::vector<int>({ 1, 2, 3, 4, 5 }), "Tied documents must be ranked by id"s);
+    }
+}
+
+void TestTieredPostings() {
+    CorpusOptions corpus_options;
+    corpus_options.document_count = 400;
+    corpus_options.vocabulary_size = 300;
+    const CorpusGenerator generator(corpus_options);
+    SearchServer expected_server = MakeGeneratedServer(generator);
+    SearchServer tiered_server = MakeGeneratedServer(generator);
+    char path[] = "/tmp/search_server_postingsXXXXXX";
+    const int fd = mkstemp(path);
+    ASSERT_HINT(fd >= 0, "Cannot create a temporary postings file"s);
+    close(fd);
+    try {
+        tiered_server.MovePostingsToDisk(path);
+        ASSERT_HINT(false, "Only a frozen index may be tiered"s);
+    }
+    catch (const std::logic_error&) {
+    }
+    expected_server.Freeze(TermFreqPrecision::UINT16);
+    tiered_server.Freeze(TermFreqPrecision::UINT16);
+    TieringOptions options;
+    options.resident_posting_count = 2000;
+    options.cache_byte_count = 4096;
+    tiered_server.MovePostingsToDisk(path, options);
+    QueryOptions query_options;
+    query_options.query_count = 100;
+    query_options.max_query_length = 3;
+    const auto queries = generator.GenerateQueries(query_options);
+    for (const auto& query : queries) {
+        for (const QueryMode mode : { QueryMode::ANY, QueryMode::ALL }) {
+            const auto expected = expected_server.FindTopDocuments(expected_server.CompileQuery(query, mode));
+            const auto actual = tiered_server.FindTopDocuments(tiered_server.CompileQuery(query, mode));
+            ASSERT_EQUAL_HINT(actual.size(), expected.size(), "Error in tiered search"s);
+            for (size_t i = 0; i < actual.size(); ++i) {
+                ASSERT_EQUAL_HINT(actual[i].id, expected[i].id, "Error in tiered ranking"s);
+                ASSERT_EQUAL_HINT(actual[i].relevance, expected[i].relevance, "Tiered index must score as the frozen one"s);
+            }
+        }
+        ASSERT_EQUAL_HINT(tiered_server.CountMatches(query), expected_server.CountMatches(query), "Error in tiered count"s);
+        ASSERT_EQUAL_HINT(tiered_server.FindTopDocuments(std::execution::par, query).size(),
+                          expected_server.FindTopDocuments(query).size(), "Error in tiered parallel search"s);
+    }
+    for (const int document_id : expected_server) {
+        const auto actual = tiered_server.GetWordFrequencies(document_id);
+        const auto expected = expected_server.GetWordFrequencies(document_id);
+        ASSERT_HINT(std::equal(actual.begin(), actual.end(), expected.begin(), expected.end()),
+                    "Error in tiered word frequencies"s);
+    }
+    const auto stats = tiered_server.GetPostingCacheStats();
+    ASSERT_HINT(stats.miss_count > 0 && stats.hit_count > 0 && stats.eviction_count > 0,
+                "Cold postings must go through the cache"s);
+    ASSERT_HINT(stats.cached_byte_count <= options.cache_byte_count, "Cache must stay within its capacity"s);
+
+    SearchServer warm_server = MakeGeneratedServer(generator);
+    warm_server.Freeze();
+    options.resident_posting_count = 0;
+    options.cache_byte_count = 1 << 20;
+    warm_server.MovePostingsToDisk(path, options);
+    warm_server.WarmUp(queries);
+    const auto warm_stats = warm_server.GetPostingCacheStats();
+    ASSERT_HINT(warm_stats.miss_count > 0 && warm_stats.promotion_count > 0, "Warm-up must load and promote postings"s);
+    warm_server.FindTopDocuments(queries.front());
+    ASSERT_EQUAL_HINT(warm_server.GetPostingCacheStats().miss_count, warm_stats.miss_count,
+                      "Warmed-up words must be served from the cache"s);
+
+    off_t previous_file_size = 0;
+    for (const auto precision : { TermFreqPrecision::UINT8, TermFreqPrecision::UINT16, TermFreqPrecision::FLOAT,
+                                  TermFreqPrecision::DOUBLE }) {
+        SearchServer hot_server = MakeGeneratedServer(generator);
+        SearchServer cold_server = MakeGeneratedServer(generator);
+        hot_server.Freeze(precision);
+        cold_server.Freeze(precision);
+        cold_server.MovePostingsToDisk(path, options);
+        for (const auto& word : generator.GetVocabulary()) {
+            const auto expected = hot_server.FindTopDocuments(word);
+            const auto actual = cold_server.FindTopDocuments(word);
+            ASSERT_EQUAL_HINT(actual.size(), expected.size(), "Error in cold search"s);
+            for (size_t i = 0; i < actual.size(); ++i) {
+                ASSERT_EQUAL_HINT(actual[i].id, expected[i].id, "Error in cold ranking"s);
+                ASSERT_EQUAL_HINT(actual[i].relevance, expected[i].relevance, "Cold postings must score as resident ones"s);
+            }
+        }
+        struct stat file_stat {};
+        stat(path, &file_stat);
+        ASSERT_HINT(file_stat.st_size > previous_file_size, "Cold postings must be stored in the index precision"s);
+        previous_file_size = file_stat.st_size;
+    }
+    unlink(path);
+}
+
+void TestCommonWords() {
+    SearchServer search_server("and with"s);
+    search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+    search_server.AddDocument(3, "pet with curly tail"s, DocumentStatus::ACTUAL, { 3 });
+    search_server.AddDocument(4, "big pet"s, DocumentStatus::ACTUAL, { 5 });
+    for (const double ratio : { 0.0, -1.0, 1.5 }) {
+        try {
+            search_server.SetCommonWordRatio(ratio);
+            ASSERT_HINT(false, "Ratio out of (0, 1] must be rejected"s);
+        }
+        catch (const std::invalid_argument&) {
+        }
+    }
+    const auto expected_curly = search_server.FindTopDocuments("curly"s);
+    ASSERT_EQUAL_HINT(search_server.FindTopDocuments("pet curly"s).size(), 4u, "All words must be scored by default"s);
+    search_server.SetCommonWordRatio(0.5);
+    for (int pass = 0; pass < 2; ++pass) {
+        const auto actual = search_server.FindTopDocuments("pet curly"s);
+        ASSERT_EQUAL_HINT(actual.size(), expected_curly.size(), "Common word must not be scored"s);
+        for (size_t i = 0; i < actual.size(); ++i) {
+            ASSERT_EQUAL_HINT(actual[i].id, expected_curly[i].id, "Error in ranking without common word"s);
+            ASSERT_EQUAL_HINT(actual[i].relevance, expected_curly[i].relevance, "Error in relevance without common word"s);
+        }
+        ASSERT_EQUAL_HINT(search_server.FindTopDocuments(std::execution::par, "pet curly"s).size(), expected_curly.size(),
+                          "Common word must not be scored in parallel"s);
+        ASSERT_EQUAL_HINT(search_server.CountMatches("pet curly"s), 2u, "Common word must not be counted"s);
+        ASSERT_EQUAL_HINT(search_server.FindTopDocuments("pet"s).size(), 4u, "A query of common words must be scored"s);
+        ASSERT_EQUAL_HINT(search_server.FindTopDocuments("pet -curly"s).size(), 2u, "Error in common word with minus word"s);
+        ASSERT_EQUAL_HINT(search_server.FindTopDocuments("curly -pet"s).size(), 0u, "Common minus word must exclude"s);
+        ASSERT_EQUAL_HINT(search_server.FindTopDocuments(search_server.CompileQuery("pet curly"s, QueryMode::ALL)).size(), 2u,
+                          "ALL query must keep common words"s);
+        const auto plan = search_server.ExplainQuery("pet curly"s);
+        ASSERT_EQUAL_HINT(plan.terms.size(), 2u, "Ignored word must be in the plan"s);
+        ASSERT_HINT(plan.terms.back().word == "pet"s && plan.terms.back().is_ignored, "Ignored word must come last"s);
+        ASSERT_EQUAL_HINT(plan.posting_count, 2u, "Error in planned postings"s);
+        ASSERT_EQUAL_HINT(plan.skipped_posting_count, 4u, "Error in skipped postings"s);
+        search_server.Freeze();
+    }
+}
+
+void TestScoringKernel() {
+    const uint32_t document_count = 1000;
+    std::vector<uint32_t> documents;
+    std::vector<double> term_freqs;
+    std::vector<uint8_t> mask;
+    for (uint32_t document = 0; document < document_count; document += 1 + document % 3) {
+        documents.push_back(document);
+        term_freqs.push_back(1.0 / (1 + document % 7));
+        mask.push_back(document % 5 != 0);
+    }
+    const uint32_t posting_count = static_cast<uint32_t>(documents.size()) - 1;
+    std::vector<double> expected_relevances(document_count, 0.25);
+    for (uint32_t i = 0; i < posting_count; ++i) {
+        if (mask[i]) {
+            expected_relevances[documents[i]] += term_freqs[i] * 0.7;
+        }
+    }
+    for (const ScoringKernel kernel : { ScoringKernel::SCALAR, GetScoringKernel() }) {
+        std::vector<double> relevances(document_count, 0.25);
+        std::vector<uint8_t> matched(document_count, 0);
+        AccumulateRelevance(kernel, documents.data(), term_freqs.data(), mask.data(), posting_count, 0.7,
+                            relevances.data(), matched.data());
+        ASSERT_HINT(relevances == expected_relevances, "Kernel must sum as the plain loop"s);
+        for (uint32_t i = 0; i < posting_count; ++i) {
+            ASSERT_EQUAL_HINT(matched[documents[i]], mask[i], "Kernel must mark the documents passing the predicate"s);
+        }
+        ASSERT_EQUAL_HINT(std::accumulate(matched.begin(), matched.end(), 0),
+                          std::accumulate(mask.begin(), mask.begin() + posting_count, 0), "Error in matched documents"s);
+    }
+
+    CorpusOptions corpus_options;
+    corpus_options.document_count = 500;
+    corpus_options.vocabulary_size = 60;
+    const CorpusGenerator generator(corpus_options);
+    SearchServer expected_server = MakeGeneratedServer(generator);
+    SearchServer frozen_server = MakeGeneratedServer(generator);
+    frozen_server.Freeze(TermFreqPrecision::UINT8, DocumentOrder::RATING);
+    std::string long_query;
+    for (const auto& word : generator.GetVocabulary()) {
+        long_query += word + " "s;
+    }
+    const std::string minus_query = long_query + "-"s + generator.GetVocabulary()[5];
+    ASSERT_HINT(frozen_server.ExplainQuery(long_query).strategy == QueryStrategy::TERM_AT_A_TIME,
+                "Dense query over a frozen index must be summed term at a time"s);
+    const auto predicate = [](int document_id, DocumentStatus, int rating) {
+        return document_id % 3 != 0 && rating > 0;
+    };
+    for (const auto& query : { long_query, minus_query }) {
+        const auto expected = frozen_server.FindTopDocuments(std::execution::par, query, predicate);
+        const auto actual = frozen_server.FindTopDocuments(query, predicate);
+        ASSERT_EQUAL_HINT(actual.size(), expected.size(), "Error in dense search"s);
+        for (size_t i = 0; i < actual.size(); ++i) {
+            ASSERT_EQUAL_HINT(actual[i].id, expected[i].id, "Error in dense ranking"s);
+            ASSERT_HINT(std::abs(actual[i].relevance - expected[i].relevance) < RELEVANCE_EPSILON, "Error in dense relevance"s);
+        }
+        ASSERT_EQUAL_HINT(actual.size(), expected_server.FindTopDocuments(query, predicate).size(),
+                          "Frozen index must match as the mutable one"s);
+    }
+}
+
 void TestSearchServer() {
     RUN_TEST(TestExcludeStopWordsFromAddedDocumentContent);
     RUN_TEST(TestExcludeDocumentsWithMinusWords);
@@ -273,6 +1687,32 @@ void TestSearchServer() {
     RUN_TEST(TestQueryQueue);
     RUN_TEST(TestRemoveDocument);
     RUN_TEST(TestRemoveDuplicates);
+    RUN_TEST(TestWordFrequencies);
     RUN_TEST(TestProcessQueries);
     RUN_TEST(TestFindingDocumentsWithPolicy);
+    RUN_TEST(TestLatencyHistogram);
+    RUN_TEST(TestMetricsSnapshot);
+    RUN_TEST(TestSortedIntersection);
+    RUN_TEST(TestMatchDocuments);
+    RUN_TEST(TestLazyPaginator);
+    RUN_TEST(TestPagedSearch);
+    RUN_TEST(TestThreadPool);
+    RUN_TEST(TestAsyncSearchServer);
+    RUN_TEST(TestRequestStats);
+    RUN_TEST(TestShardedSearchServer);
+    RUN_TEST(TestShardServer);
+    RUN_TEST(TestMemoryResources);
+    RUN_TEST(TestCompiledQuery);
+    RUN_TEST(TestFrozenIndex);
+    RUN_TEST(TestTermFreqPrecision);
+    RUN_TEST(TestQueryPlanner);
+    RUN_TEST(TestPrefixQuery);
+    RUN_TEST(TestCorpusIngestion);
+    RUN_TEST(TestMutationLog);
+    RUN_TEST(TestConjunctiveQuery);
+    RUN_TEST(TestCountMatches);
+    RUN_TEST(TestDocumentOrder);
+    RUN_TEST(TestTieredPostings);
+    RUN_TEST(TestCommonWords);
+    RUN_TEST(TestScoringKernel);
 }
\ No newline at end of file
@@ -3,7 +3,17 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <atomic>
 #include <cstdlib>
+#include <numeric>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <unistd.h>
+#include <sstream>
+#include <fstream>
+#include <thread>
+#include <sys/stat.h>
 
 #include "search_server.h"
 #include "document.h"
@@ -11,6 +21,18 @@
 #include "request_queue.h"
 #include "remove_duplicates.h"
 #include "process_queries.h"
+#include "metrics.h"
+#include "async_search_server.h"
+#include "bounded_queue.h"
+#include "thread_pool.h"
+#include "request_stats.h"
+#include "sharded_search_server.h"
+#include "corpus_generator.h"
+#include "corpus_ingestion.h"
+#include "mutation_log.h"
+#include "shard_server.h"
+#include "shard_aggregator.h"
+#include "scratch_arena.h"
 
 template<typename Element1, typename Element2>
 std::ostream& operator<<(std::ostream& out, const std::pair<Element1, Element2>& container);
@@ -113,6 +135,7 @@ std::ostream& operator<<(std::ostream& out, const std::map<Element1, Element2>&
 }
 
 std::vector<std::string_view> VectStringToVectStringView(const std::vector<std::string>&);
+SearchServer MakeGeneratedServer(const CorpusGenerator&);
 
 void TestExcludeStopWordsFromAddedDocumentContent();
 void TestExcludeDocumentsWithMinusWords();
@@ -128,4 +151,16 @@ void TestSearchServer();
 void TestRemoveDocument();
 void TestRemoveDuplicates();
 void TestProcessQueries();
-void TestFindingDocumentsWithPolicy();
\ No newline at end of file
+void TestFindingDocumentsWithPolicy();
+void TestLatencyHistogram();
+void TestMetricsSnapshot();
+void TestSortedIntersection();
+void TestMatchDocuments();
+void TestLazyPaginator();
+void TestPagedSearch();
+void TestThreadPool();
+void TestAsyncSearchServer();
+void TestRequestStats();
+void TestShardedSearchServer();
+void TestShardServer();
+void TestMemoryResources();
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+thread_local const ThreadPool* ThreadPool::current_pool_ = nullptr;
+thread_local size_t ThreadPool::current_worker_ = 0;
+
+ThreadPool::ThreadPool(size_t thread_count) {
+    thread_count = std::max<size_t>(1, thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        threads_.emplace_back([this, i]() { Run(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard(sleep_mutex_);
+        is_stopping_ = true;
+    }
+    wake_up_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+    const size_t index = current_pool_ == this
+        ? current_worker_
+        : next_worker_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+    // Counted before it is queued, so that a worker taking it cannot decrement first.
+    pending_.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> guard(workers_[index]->m);
+        workers_[index]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> guard(sleep_mutex_);
+    }
+    wake_up_.notify_one();
+}
+
+size_t ThreadPool::GetThreadCount() const {
+    return workers_.size();
+}
+
+bool ThreadPool::TryTake(size_t index, std::function<void()>& task) {
+    {
+        Worker& own = *workers_[index];
+        std::lock_guard<std::mutex> guard(own.m);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t shift = 1; shift < workers_.size(); ++shift) {
+        Worker& victim = *workers_[(index + shift) % workers_.size()];
+        std::lock_guard<std::mutex> guard(victim.m);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::Run(size_t index) {
+    current_pool_ = this;
+    current_worker_ = index;
+    std::function<void()> task;
+    while (true) {
+        if (TryTake(index, task)) {
+            pending_.fetch_sub(1);
+            task();
+            task = nullptr;
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        wake_up_.wait(lock, [this]() { return is_stopping_ || pending_.load() > 0; });
+        if (is_stopping_ && pending_.load() == 0) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed-size work-stealing pool. Every worker owns a deque: it takes its own tasks
+// from the back and, when idle, steals the oldest tasks of the other workers.
+// Tasks submitted from a worker stay on that worker's deque.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    void Submit(std::function<void()>);
+    template <typename Func>
+    std::future<std::invoke_result_t<Func>> Async(Func);
+    size_t GetThreadCount() const;
+
+private:
+    struct Worker {
+        std::mutex m;
+        std::deque<std::function<void()>> tasks;
+    };
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_up_;
+    std::atomic<size_t> pending_{0};
+    std::atomic<size_t> next_worker_{0};
+    bool is_stopping_ = false;
+
+    static thread_local const ThreadPool* current_pool_;
+    static thread_local size_t current_worker_;
+
+    bool TryTake(size_t, std::function<void()>&);
+    void Run(size_t);
+};
+
+template <typename Func>
+std::future<std::invoke_result_t<Func>> ThreadPool::Async(Func func) {
+    auto task = std::make_shared<std::packaged_task<std::invoke_result_t<Func>()>>(std::move(func));
+    auto result = task->get_future();
+    Submit([task]() { (*task)(); });
+    return result;
+}
@@ -0,0 +1,54 @@
+#include "word_frequencies.h"
+#include "search_server.h"
+
+WordFrequencies::Iterator::Iterator(const SearchServer* server, int document_id, const int* term)
+    : server_(server)
+    , document_id_(document_id)
+    , term_(term) {
+}
+
+WordFrequencies::Iterator::value_type WordFrequencies::Iterator::operator*() const {
+    return { server_->term_id_to_word_[*term_], server_->GetDocumentTermFreq(*term_, document_id_) };
+}
+
+WordFrequencies::Iterator& WordFrequencies::Iterator::operator++() {
+    ++term_;
+    return *this;
+}
+
+WordFrequencies::Iterator WordFrequencies::Iterator::operator++(int) {
+    Iterator previous = *this;
+    ++term_;
+    return previous;
+}
+
+bool WordFrequencies::Iterator::operator==(const Iterator& other) const {
+    return term_ == other.term_;
+}
+
+bool WordFrequencies::Iterator::operator!=(const Iterator& other) const {
+    return term_ != other.term_;
+}
+
+WordFrequencies::WordFrequencies(const SearchServer* server, int document_id, const int* terms_begin, const int* terms_end)
+    : server_(server)
+    , document_id_(document_id)
+    , terms_begin_(terms_begin)
+    , terms_end_(terms_end) {
+}
+
+WordFrequencies::Iterator WordFrequencies::begin() const {
+    return Iterator(server_, document_id_, terms_begin_);
+}
+
+WordFrequencies::Iterator WordFrequencies::end() const {
+    return Iterator(server_, document_id_, terms_end_);
+}
+
+size_t WordFrequencies::size() const {
+    return terms_end_ - terms_begin_;
+}
+
+bool WordFrequencies::empty() const {
+    return terms_begin_ == terms_end_;
+}
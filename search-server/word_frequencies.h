@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <string_view>
+#include <utility>
+
+class SearchServer;
+
+// Term frequencies of one document, looked up in the postings on demand, so
+// the server keeps only the sorted term ids of each document. Words come in
+// the order of their term ids; a frozen quantized index yields the stored,
+// quantized frequencies. The view is valid until the document is removed or
+// the server is frozen, since Freeze moves the term ids into its own arrays.
+// Dereferencing looks up the postings of the word: in a tiered index the
+// postings of a cold word may have to be read from disk, one read per word.
+class WordFrequencies {
+    friend class SearchServer;
+
+public:
+    class Iterator {
+        friend class WordFrequencies;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<std::string_view, double>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        value_type operator*() const;
+        Iterator& operator++();
+        Iterator operator++(int);
+        bool operator==(const Iterator&) const;
+        bool operator!=(const Iterator&) const;
+
+    private:
+        Iterator(const SearchServer*, int, const int*);
+
+        const SearchServer* server_;
+        int document_id_;
+        const int* term_;
+    };
+
+    Iterator begin() const;
+    Iterator end() const;
+    size_t size() const;
+    bool empty() const;
+
+private:
+    WordFrequencies(const SearchServer*, int, const int*, const int*);
+
+    const SearchServer* server_;
+    int document_id_;
+    const int* terms_begin_;
+    const int* terms_end_;
+};